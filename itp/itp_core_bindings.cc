@@ -9,11 +9,107 @@
 #include <itp_core/Predictor.h>
 #include <itp_core/Selector.h>
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <stdexcept>
+
 namespace py = pybind11;
 
+namespace
+{
+
+using DoubleArray = py::array_t<double, py::array::c_style>;
+using SymbolArray = py::array_t<itp::Symbol, py::array::c_style>;
+
+/**
+ * Copies the buffer of a one-dimensional array at once instead of converting its elements one by one.
+ */
+template<typename T>
+std::vector<T> ToVector(const py::array_t<T, py::array::c_style>& array)
+{
+	if (array.ndim() != 1)
+	{
+		throw std::invalid_argument("The time series should be a one-dimensional array");
+	}
+
+	return {array.data(), array.data() + array.size()};
+}
+
+/**
+ * Copies the rows of a two-dimensional array, each row is a series.
+ */
+std::vector<std::vector<double>> ToVectors(const DoubleArray& array)
+{
+	if (array.ndim() != 2)
+	{
+		throw std::invalid_argument("The vector time series should be a two-dimensional array");
+	}
+
+	std::vector<std::vector<double>> to_return;
+	for (py::ssize_t row = 0; row < array.shape(0); ++row)
+	{
+		to_return.emplace_back(array.data(row, 0), array.data(row, 0) + array.shape(1));
+	}
+
+	return to_return;
+}
+
+/**
+ * Returns an array viewing the buffer of the values, the array owns the values.
+ */
+py::array_t<double> ToArray(std::vector<double>&& values)
+{
+	auto* const owned = new std::vector<double>(std::move(values));
+	py::capsule owner(owned, [](void* vector) { delete static_cast<std::vector<double>*>(vector); });
+
+	return py::array_t<double>(static_cast<py::ssize_t>(owned->size()), owned->data(), owner);
+}
+
+/**
+ * Returns a two-dimensional array, which rows are the series.
+ */
+py::array_t<double> ToArray(std::vector<std::vector<double>>&& series)
+{
+	const auto rows = static_cast<py::ssize_t>(series.size());
+	const auto columns = static_cast<py::ssize_t>(series.empty() ? 0 : series.front().size());
+	std::vector<double> values;
+	values.reserve(rows * columns);
+	for (const auto& row : series)
+	{
+		values.insert(values.end(), row.cbegin(), row.cend());
+	}
+
+	auto* const owned = new std::vector<double>(std::move(values));
+	py::capsule owner(owned, [](void* vector) { delete static_cast<std::vector<double>*>(vector); });
+
+	return py::array_t<double>({rows, columns}, owned->data(), owner);
+}
+
+/**
+ * Calls the forecasting without the GIL and returns the forecasts of the groups as arrays.
+ */
+template<typename Forecasting>
+py::dict ForecastToArrays(Forecasting forecasting)
+{
+	decltype(forecasting()) forecasts;
+	{
+		py::gil_scoped_release release;
+		forecasts = forecasting();
+	}
+
+	py::dict to_return;
+	for (auto& [group, forecast] : forecasts)
+	{
+		to_return[py::str(group)] = ToArray(std::move(forecast));
+	}
+
+	return to_return;
+}
+
+} // namespace
+
 class PyINonCompressionAlgorithm : public itp::INonCompressionAlgorithm
 {
 public:
@@ -21,6 +117,8 @@ public:
 
 	Guess GiveNextPrediction(const unsigned char* data, size_t size) final
 	{
+		// Forecasting methods release the GIL, but the bytes object can be created only while holding it.
+		py::gil_scoped_acquire gil;
 		return PyGiveNextPrediction({reinterpret_cast<const char*>(data), size});
 	}
 };
@@ -67,6 +165,10 @@ PYBIND11_MODULE(itp_core_bindings, m)
 		.value("CONFIDENT", itp::ConfidenceLevel::Confident)
 		.value("NOT_CONFIDENT", itp::ConfidenceLevel::NotConfident);
 
+	py::enum_<itp::NumericBackend>(m, "NumericBackend")
+		.value("HIGH_PRECISION", itp::NumericBackend::HighPrecision)
+		.value("LOG_DOMAIN", itp::NumericBackend::LogDomain);
+
 	py::class_<itp::INonCompressionAlgorithm, INonCompressionAlgorithm_>(m, "INonCompressionAlgorithm")
 		.def(py::init<>())
 		.def("GiveNextPrediction", &itp::INonCompressionAlgorithm::GiveNextPrediction)
@@ -80,40 +182,128 @@ PYBIND11_MODULE(itp_core_bindings, m)
 
 	py::class_<itp::InformationTheoreticPredictor>(m, "InformationTheoreticPredictor")
 		.def(py::init<>())
+		// The overloads for NumPy arrays are tried first. They take the arrays of the exact type only and return
+		// arrays, other sequences are taken by the next overloads, which return lists.
+		.def(
+			"forecast_real",
+			[](itp::InformationTheoreticPredictor& predictor,
+			   const DoubleArray& time_series,
+			   const itp::ConcatenatedCompressorNamesVec& groups,
+			   size_t h,
+			   size_t difference,
+			   size_t quants_count,
+			   int sparse) {
+				const auto history = ToVector(time_series);
+				return ForecastToArrays([&] {
+					return predictor.ForecastReal(history, groups, h, difference, quants_count, sparse);
+				});
+			},
+			"Forecast real-valued time series with single partition on discretization",
+			py::arg("time_series").noconvert(),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("quants_count") = 8,
+			py::arg("sparse") = -1)
 		.def(
 			"forecast_real",
 			&itp::InformationTheoreticPredictor::ForecastReal,
 			"Forecast real-valued time series with single partition on discretization",
+			py::call_guard<py::gil_scoped_release>(),
 			py::arg("time_series"),
 			py::arg("groups"),
 			py::arg("h") = 1,
 			py::arg("difference") = 0,
 			py::arg("quants_count") = 8,
 			py::arg("sparse") = -1)
+		.def(
+			"forecast_multialphabet",
+			[](itp::InformationTheoreticPredictor& predictor,
+			   const DoubleArray& time_series,
+			   const itp::ConcatenatedCompressorNamesVec& groups,
+			   size_t h,
+			   size_t difference,
+			   size_t max_quants_count,
+			   int sparse) {
+				const auto history = ToVector(time_series);
+				return ForecastToArrays([&] {
+					return predictor.ForecastMultialphabet(history, groups, h, difference, max_quants_count, sparse);
+				});
+			},
+			"Make forecast with multiple partitions for real-valued time series",
+			py::arg("time_series").noconvert(),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("max_quants_count") = 8,
+			py::arg("sparse") = -1)
 		.def(
 			"forecast_multialphabet",
 			&itp::InformationTheoreticPredictor::ForecastMultialphabet,
 			"Make forecast with multiple partitions for real-valued time series",
+			py::call_guard<py::gil_scoped_release>(),
 			py::arg("time_series"),
 			py::arg("groups"),
 			py::arg("h") = 1,
 			py::arg("difference") = 0,
 			py::arg("max_quants_count") = 8,
 			py::arg("sparse") = -1)
+		.def(
+			"forecast_multialphabet_vec",
+			[](itp::InformationTheoreticPredictor& predictor,
+			   const DoubleArray& time_series,
+			   const itp::ConcatenatedCompressorNamesVec& groups,
+			   size_t h,
+			   size_t difference,
+			   size_t max_quants_count,
+			   int sparse) {
+				const auto history = ToVectors(time_series);
+				return ForecastToArrays([&] {
+					return predictor.ForecastMultialphabetVec(history, groups, h, difference, max_quants_count, sparse);
+				});
+			},
+			"Make forecast with multiple partitions for real-valued vector time series",
+			py::arg("time_series").noconvert(),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("max_quants_count") = 8,
+			py::arg("sparse") = -1)
 		.def(
 			"forecast_multialphabet_vec",
 			&itp::InformationTheoreticPredictor::ForecastMultialphabetVec,
 			"Make forecast with multiple partitions for real-valued vector time series",
+			py::call_guard<py::gil_scoped_release>(),
 			py::arg("time_series"),
 			py::arg("groups"),
 			py::arg("h") = 1,
 			py::arg("difference") = 0,
 			py::arg("max_quants_count") = 8,
 			py::arg("sparse") = -1)
+		.def(
+			"forecast_discrete",
+			[](itp::InformationTheoreticPredictor& predictor,
+			   const SymbolArray& time_series,
+			   const itp::ConcatenatedCompressorNamesVec& groups,
+			   size_t h,
+			   size_t difference,
+			   int sparse) {
+				const auto history = ToVector(time_series);
+				return ForecastToArrays([&] {
+					return predictor.ForecastDiscrete(history, groups, h, difference, sparse);
+				});
+			},
+			"Make forecast without quantization for discrete time series",
+			py::arg("time_series").noconvert(),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("sparse") = -1)
 		.def(
 			"forecast_discrete",
 			&itp::InformationTheoreticPredictor::ForecastDiscrete,
 			"Make forecast without quantization for discrete time series",
+			py::call_guard<py::gil_scoped_release>(),
 			py::arg("time_series"),
 			py::arg("groups"),
 			py::arg("h") = 1,
@@ -123,17 +313,80 @@ PYBIND11_MODULE(itp_core_bindings, m)
 			"forecast_discrete_vec",
 			&itp::InformationTheoreticPredictor::ForecastDiscreteVec,
 			"Make forecast without quantization for discrete vector time series",
+			py::call_guard<py::gil_scoped_release>(),
 			py::arg("time_series"),
 			py::arg("groups"),
 			py::arg("h") = 1,
 			py::arg("difference") = 0,
 			py::arg("sparse") = -1)
+		.def(
+			"forecast_real_batch",
+			&itp::InformationTheoreticPredictor::ForecastRealBatch,
+			"Forecast each real-valued time series of the batch with single partition on discretization, the series "
+			"are spread among the threads set by set_threads_count",
+			py::call_guard<py::gil_scoped_release>(),
+			py::arg("batch"),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("quants_count") = 8,
+			py::arg("sparse") = -1)
+		.def(
+			"forecast_multialphabet_batch",
+			&itp::InformationTheoreticPredictor::ForecastMultialphabetBatch,
+			"Make forecasts with multiple partitions for each real-valued time series of the batch, the series are "
+			"spread among the threads set by set_threads_count",
+			py::call_guard<py::gil_scoped_release>(),
+			py::arg("batch"),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("max_quants_count") = 8,
+			py::arg("sparse") = -1)
+		.def(
+			"forecast_discrete_batch",
+			&itp::InformationTheoreticPredictor::ForecastDiscreteBatch,
+			"Make forecasts without quantization for each discrete time series of the batch, the series are spread "
+			"among the threads set by set_threads_count",
+			py::call_guard<py::gil_scoped_release>(),
+			py::arg("batch"),
+			py::arg("groups"),
+			py::arg("h") = 1,
+			py::arg("difference") = 0,
+			py::arg("sparse") = -1)
 		.def(
 			"register_non_compression_algorithm",
 			&itp::InformationTheoreticPredictor::RegisterNonCompressionAlgorithm,
 			"Adds an algorithm written in Python to the set of available algorithms",
 			py::arg("name"),
-			py::arg("algorithm"));
+			py::arg("algorithm"))
+		.def(
+			"set_threads_count",
+			&itp::InformationTheoreticPredictor::SetThreadsCount,
+			"Sets the number of threads used to compress possible continuations of a series",
+			py::arg("threads_count"))
+		.def(
+			"set_numeric_backend",
+			&itp::InformationTheoreticPredictor::SetNumericBackend,
+			"Sets the numeric type used for code lengths and probabilities of continuations",
+			py::arg("numeric_backend"))
+		.def(
+			"set_pruning_slack",
+			&itp::InformationTheoreticPredictor::SetPruningSlack,
+			"Enables pruning of continuations, which code length exceeds the minimal one by more than slack_in_bits; "
+			"None disables pruning",
+			py::arg("slack_in_bits"))
+		.def(
+			"get_discarded_probability_bound",
+			&itp::InformationTheoreticPredictor::GetDiscardedProbabilityBound,
+			"Returns an upper bound of the share of probability discarded by pruning during the last forecasting")
+		.def(
+			"set_monte_carlo_sampling",
+			&itp::InformationTheoreticPredictor::SetMonteCarloSampling,
+			"Draws samples_count continuations for each compressor instead of enumerating all of them; None disables "
+			"sampling",
+			py::arg("samples_count"),
+			py::arg("seed") = 0);
 
 	m.def(
 		"select_best_compressors_multialphabet",
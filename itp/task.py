@@ -10,6 +10,8 @@ from .transformators import ITimeSeriesTransformator, EmptyTimeSeriesTransformat
 
 from typing import Dict, List, Type
 
+import numpy as np
+
 
 class IElementaryTask:
     """
@@ -68,22 +70,38 @@ class ItpAccessor:
     A wrapper for itp predictor functions to enable mocking.
     """
 
+    @staticmethod
+    def _to_reals(time_series: TimeSeries) -> np.ndarray:
+        """
+        The data of the series as an array, which the predictor takes without converting its elements one by one.
+        """
+        return np.ascontiguousarray(time_series.to_numpy(), dtype=np.float64)
+
+    @staticmethod
+    def _to_symbols(time_series: TimeSeries) -> np.ndarray:
+        data = time_series.to_numpy()
+        if data.size and (data.min() < 0 or data.max() > 255):
+            raise ValueError("Values of a discrete time series should be in the range [0, 255]")
+        if np.any(data != np.round(data)):
+            raise ValueError("Values of a discrete time series should be integers")
+        return np.ascontiguousarray(data, dtype=np.uint8)
+
     def forecast_multialphabet_vec(self, time_series: TimeSeries, compressors: List[ConcatenatedCompressorGroup],
                                    horizon: int, difference: int, max_quanta_count: int, sparse: int) \
             -> Dict[ConcatenatedCompressorGroup, MultivariateTimeSeries]:
-        result = self._itp.forecast_multialphabet_vec(time_series.to_list(), compressors, horizon, difference,
+        result = self._itp.forecast_multialphabet_vec(self._to_reals(time_series), compressors, horizon, difference,
                                                       max_quanta_count, sparse)
         return {key: MultivariateTimeSeries(value, time_series.frequency(), time_series.dtype())
                 for key, value in result.items()}
 
     def forecast_discrete(self, time_series, compressors, horizon, difference, sparse) -> Dict[str, TimeSeries]:
-        result = self._itp.forecast_discrete(time_series.to_list(), compressors, horizon, difference, sparse)
+        result = self._itp.forecast_discrete(self._to_symbols(time_series), compressors, horizon, difference, sparse)
         return {key: TimeSeries([round(x) for x in value], time_series.frequency(), time_series.dtype()) for key, value
                 in result.items()}
 
     def forecast_multialphabet(self, time_series, compressors, horizon, difference, max_quanta_count,
                                sparse) -> Dict[str, TimeSeries]:
-        result = self._itp.forecast_multialphabet(time_series.to_list(), compressors, horizon, difference,
+        result = self._itp.forecast_multialphabet(self._to_reals(time_series), compressors, horizon, difference,
                                                   max_quanta_count, sparse)
         return {key: TimeSeries(value, time_series.frequency(), time_series.dtype()) for key, value in result.items()}
 
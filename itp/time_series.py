@@ -62,6 +62,9 @@ class TimeSeries:
     def to_list(self):
         return list(self._data)
 
+    def to_numpy(self):
+        return self._data
+
     def dtype(self):
         return self._dtype
 
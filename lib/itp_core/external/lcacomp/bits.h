@@ -47,6 +47,12 @@ typedef struct bit_output {
 } BITOUT;
 
 
+//counts the written bits instead of storing them
+typedef struct bit_counter {
+  ulong bitlen;
+} BITCOUNT;
+
+
 BITIN *createBitin(std::stringstream &input);
 uint readBits(BITIN *bitin, uint readBitLen);
 
@@ -55,6 +61,11 @@ void writeBits(BITOUT *bitout, uint symbol, uint writeBitLen);
 void flushBitout(BITOUT *bitout);
 void deleteBitout(BITOUT *bitout);
 
+inline void writeBits(BITCOUNT *bitcount, uint symbol, uint writeBitLen)
+{
+  bitcount->bitlen += writeBitLen;
+}
+
 /*
 //upper bits mask for uint
 static const uint UBM[] = {
@@ -21,11 +21,14 @@
 
 #define INLINE __inline
 
-static void encodeCFG_rec(CODE code, EDICT *ed, BITOUT *output);
+template <typename BITSINK>
+static void encodeCFG_rec(CODE code, EDICT *ed, BITSINK *output);
 
-static void putLeaf(uint num_code, CODE lv_code, BITOUT *output);
+template <typename BITSINK>
+static void putLeaf(uint num_code, CODE lv_code, BITSINK *output);
 
-static void putParen(uchar b, BITOUT *output);
+template <typename BITSINK>
+static void putParen(uchar b, BITSINK *output);
 
 static INLINE
 uint bits(uint n) {
@@ -37,14 +40,16 @@ uint bits(uint n) {
     return b;
 }
 
+template <typename BITSINK>
 static INLINE
-void putLeaf(uint num_code, uint lvcode, BITOUT *output) {
+void putLeaf(uint num_code, uint lvcode, BITSINK *output) {
     uint bits_len = bits(num_code);
     writeBits(output, lvcode, bits_len);
 }
 
+template <typename BITSINK>
 static INLINE
-void putParen(uchar b, BITOUT *output) {
+void putParen(uchar b, BITSINK *output) {
     if (b == OP) {
         writeBits(output, OP, 1);
     } else {
@@ -52,8 +57,9 @@ void putParen(uchar b, BITOUT *output) {
     }
 }
 
+template <typename BITSINK>
 static
-void encodeCFG_rec(uint code, EDICT *ed, BITOUT *output) {
+void encodeCFG_rec(uint code, EDICT *ed, BITSINK *output) {
     if (ed->tcode[code] == DUMMY_CODE) {
         encodeCFG_rec(ed->rule[code].left, ed, output);
         encodeCFG_rec(ed->rule[code].right, ed, output);
@@ -85,6 +91,15 @@ void EncodeCFG(EDICT *ed, std::stringstream &ost) {
     //printf("Done!\n");
 }
 
+ulong EncodedCFGSize(EDICT *ed) {
+    BITCOUNT bitcount = {0};
+    ed->newcode = CHAR_SIZE;
+    encodeCFG_rec(ed->start, ed, &bitcount);
+    putParen(CP, &bitcount);
+    //the header and the bits padded to whole words, as written by EncodeCFG
+    return 2 * sizeof(uint) + sizeof(uint) * ((bitcount.bitlen + 8 * sizeof(uint) - 1) / (8 * sizeof(uint)));
+}
+
 EDICT *ReadCFG(std::stringstream &ist) {
     uint i;
     uint num_rules, txt_len;
@@ -40,6 +40,7 @@ typedef struct EncodeDictionary
 
 EDICT *ReadCFG(std::stringstream &ist);
 void EncodeCFG(EDICT *dict, std::stringstream &ost);
+ulong EncodedCFGSize(EDICT *dict);
 void DestructEDict(EDICT *dict);
 
 #endif /* CFG2ENC_H */
@@ -1,13 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sstream>
 #include "txt2cfg_online.h"
 #include "cfg2enc.h"
 #include "lcacomp.h"
 
-EDICT *convertDict(DICT *dict) {
-    EDICT *edict = new EDICT;
+// The encoder takes the rules of the dictionary and reuses its h_list array for the new codes of the rules.
+static void convertDict(DICT *dict, EDICT *edict) {
     uint i;
     edict->txt_len = dict->txt_len;
     edict->start = dict->num_rules - 1;
@@ -22,30 +21,28 @@ EDICT *convertDict(DICT *dict) {
     for (i = CHAR_SIZE + 1; i < dict->num_rules; i++) {
         edict->tcode[i] = DUMMY_CODE;
     }
-
-    delete[] dict->h_entry;
-    delete dict;
-    return edict;
 }
 
-int compression(std::stringstream &ist, std::stringstream &ost) {
-    DICT *dict;
-    EDICT *edict;
+Lcacomp::workspace::workspace() : dict(CreateDict()) {
+}
 
-    dict = GrammarTrans_LCA(ist);
-    edict = convertDict(dict);
+Lcacomp::workspace::~workspace() {
+    DestructDict(dict);
+}
 
-    EncodeCFG(edict, ost);
-    DestructEDict(edict);
+size_t Lcacomp::lcacomp_compress(const unsigned char *src, size_t size) {
+    workspace ws;
 
-    return 1;
+    return lcacomp_compress(src, size, ws);
 }
 
-size_t Lcacomp::lcacomp_compress(const unsigned char *src, size_t size) {
-    std::stringstream ist(std::ios_base::in | std::ios_base::out | std::ios::binary);
-    ist.write(reinterpret_cast<const char *>(src), size);
-    std::stringstream ost;
-    compression(ist, ost);
+size_t Lcacomp::lcacomp_compress(const unsigned char *src, size_t size, workspace &ws) {
+    EDICT edict;
+
+    ResetDict(ws.dict);
+    GrammarTrans_LCA(ws.dict, src, size);
+    convertDict(ws.dict, &edict);
 
-    return ost.str().size();
-}
\ No newline at end of file
+    // Only the size of the encoded grammar is needed, so the bits are counted, not written.
+    return EncodedCFGSize(&edict);
+}
@@ -5,10 +5,33 @@
 #ifndef PREDICTOR_LCACOMP_H
 #define PREDICTOR_LCACOMP_H
 
+#include <cstddef>
 #include <iostream>
 
+struct Dictionary;
+
 namespace Lcacomp {
+    /*
+     * The dictionary of the grammar. Passing the same workspace to many calls of lcacomp_compress
+     * reuses its rule and hash arrays instead of allocating them for every text.
+     */
+    class workspace {
+    public:
+        workspace();
+        ~workspace();
+
+    private:
+        workspace(const workspace &);
+        workspace &operator=(const workspace &);
+
+        friend size_t lcacomp_compress(const unsigned char *, size_t, workspace &);
+
+        Dictionary *dict;
+    };
+
     size_t lcacomp_compress(const unsigned char *src, size_t size);
+
+    size_t lcacomp_compress(const unsigned char *src, size_t size, workspace &ws);
 }
 
 #endif //PREDICTOR_LCACOMP_H
@@ -26,7 +26,6 @@
 #define RLBUF_RESIZE_FACTOR (1.5) //resize factor of buffer for rule[].
 #define INIT_PRIMES_INDEX (13) //initial value of primes[].
 #define HASH_LOAD_FACTOR (1.0) //load factor of hash entry.
-#define INPUT_BUFFER_SIZE (32*1024)   // size of input buffer.
 #define MAX_LEN_QUE (8)   // maximum length of queue.
 #define MOD(X) ((X) % MAX_LEN_QUE) //compute index of que[].
 #define hash_val(BUF_LEN, A, B) (((A)*(B))%BUF_LEN)
@@ -57,7 +56,6 @@ static void rehash             (DICT *d);
 static CODE addRule2Dictionary (DICT *d, CODE left, CODE right);
 static CODE searchRule         (DICT *d, CODE left, CODE right);
 static CODE reverseAccess      (DICT *d, CODE left, CODE right);
-static DICT *createDictionary  ();
 static void grammarTrans_rec   (DICT *d, QU *q, CODE c);
 
 static
@@ -302,8 +300,10 @@ CODE reverseAccess(DICT *d, CODE left, CODE right)
   return R;
 }
 
-static
-DICT *createDictionary()
+/*
+ * The arrays are allocated with malloc, since they grow with realloc.
+ */
+DICT *CreateDict()
 {
   uint i;
   DICT *d;
@@ -313,23 +313,23 @@ DICT *createDictionary()
   d->p_idx = INIT_PRIMES_INDEX;
   d->hebuf_len = primes[d->p_idx];
 
-  d->rule = new RULE[d->rlbuf_len]();
+  d->rule = (RULE*)calloc(d->rlbuf_len, sizeof(RULE));
   if (d->rule == NULL) {
-    puts("Memory allocate error (rule) at createDictionary.");
+    puts("Memory allocate error (rule) at CreateDict.");
     exit(1);
   }
-  d->h_entry = new CODE[d->hebuf_len]();
+  d->h_entry = (CODE*)malloc(d->hebuf_len*sizeof(CODE));
   if (d->h_entry == NULL) {
-    puts("Memory allocate error (h_entry) at createDictionary.");
+    puts("Memory allocate error (h_entry) at CreateDict.");
     exit(1);
   }
   for (i = 0; i < d->hebuf_len; i++) {
     d->h_entry[i] = DUMMY_CODE;
   }
 
-  d->h_list = new CODE[d->rlbuf_len];
+  d->h_list = (CODE*)malloc(d->rlbuf_len*sizeof(CODE));
   if (d->h_list == NULL) {
-    puts("Memory allocate error (h_list) at createDictionary.");
+    puts("Memory allocate error (h_list) at CreateDict.");
     exit(1);
   }
   for (i = 0; i < d->rlbuf_len; i++) {
@@ -342,6 +342,24 @@ DICT *createDictionary()
   return d;
 }
 
+/*
+ * Removes the generated rules, so the dictionary is the same as a new one,
+ * but keeps its buffers. Only the used hash entries are cleared, the hash
+ * table may stay larger than in a new dictionary, which does not change
+ * the generated rules.
+ * h_list is not cleared: an entry is written whenever a rule is added.
+ */
+void ResetDict(DICT *d)
+{
+  uint i;
+
+  for (i = CHAR_SIZE+1; i < d->num_rules; i++) {
+    d->h_entry[hash_val(d->hebuf_len, d->rule[i].left, d->rule[i].right)] = DUMMY_CODE;
+  }
+  d->num_rules = CHAR_SIZE+1;
+  d->txt_len = 0;
+}
+
 static INLINE
 void grammarTrans_rec(DICT *d, QU *p, CODE c)
 {
@@ -374,36 +392,19 @@ void grammarTrans_rec(DICT *d, QU *p, CODE c)
   }
 }
 
-DICT *GrammarTrans_LCA(std::stringstream &ist)
+void GrammarTrans_LCA(DICT *d, const uchar *txt, uint txt_len)
 {
-  uchar *w, *w_top;
-  uint lg;
+  uint i;
   QU *dummy_que, *que;
   CODE v, x1, x2;
-  DICT *d;
-  long cnt = 0;
 
   dummy_que = createQueue();
-  d = createDictionary();
 
   //printf("Grammar Transforming ...\n");
-  w_top = new uchar[INPUT_BUFFER_SIZE];
-  while (true) {
-    ist.read(reinterpret_cast<char *>(w_top), sizeof(uchar)*INPUT_BUFFER_SIZE);
-    lg = ist.gcount();
-    if (!(lg > 0)) {
-      break;
-    }
-    cnt += lg;
-    w = w_top;
-    do {
-      grammarTrans_rec(d, dummy_que, *w++);
-    } while (--lg > 0);
-    //printf("\r");
-    //printf("[ %12ld ] bytes -> [ %10d ] rules.", cnt, d->num_rules);
-    //fflush(stdout);
+  for (i = 0; i < txt_len; i++) {
+    grammarTrans_rec(d, dummy_que, txt[i]);
   }
-  d->txt_len = cnt;
+  d->txt_len = txt_len;
 
   que = dummy_que->next;
   while (que->next != NULL || que->num > 2) {
@@ -422,9 +423,7 @@ DICT *GrammarTrans_LCA(std::stringstream &ist)
 
   //printf("\r");
   //printf("[ %12ld ] bytes -> [ %10d ] rules.\n", cnt, d->num_rules);
-  delete[] w_top;
   destructQueues(dummy_que);
-  return d;
 }
 
 void OutputGeneratedCFG(DICT *d, FILE *output)
@@ -438,8 +437,8 @@ void OutputGeneratedCFG(DICT *d, FILE *output)
 void DestructDict(DICT *d)
 {
   if (d == NULL) return;
-  if (d->rule    != NULL) delete[] d->rule;
-  if (d->h_entry != NULL) delete[] d->h_entry;
-  if (d->h_list  != NULL) delete[] d->h_list;
+  free(d->rule);
+  free(d->h_entry);
+  free(d->h_list);
   delete d;
 }
@@ -25,7 +25,6 @@
 #include <string.h>
 #include <math.h>
 #include <iostream>
-#include <sstream>
 #include "lcacommon.h"
 
 typedef struct Dictionary {
@@ -40,7 +39,9 @@ typedef struct Dictionary {
 } DICT;
 
 // function prototype declarations
-DICT *GrammarTrans_LCA  (std::stringstream &ist);
+DICT *CreateDict        ();
+void ResetDict          (DICT *d);
+void GrammarTrans_LCA   (DICT *d, const uchar *txt, uint txt_len);
 void OutputGeneratedCFG (DICT *d, FILE *output);
 void DestructDict       (DICT *d);
 
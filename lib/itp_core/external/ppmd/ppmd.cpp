@@ -1,9 +1,13 @@
+// Before the library, which changes the packing of structures.
+#include "ppmd.h"
+
 #include "common.inc"
 #include "coro2b.inc"
 #include "libpmd.inc"
-#include "ppmd.h"
 
 #include <cmath>
+#include <cstdint>
+#include <new>
 
 size_t Ppmd::compress_bound(size_t size) {
   // because often short sequences should be compressed, extra space is added
@@ -29,3 +33,96 @@ size_t Ppmd::ppmd_compress(unsigned char *dst, size_t dst_size,
     delete[] src;
     return result;
 }
+
+namespace {
+    enum { max_order = 12, memory_mb = 256, cut_off = 1 };
+
+    // The output is only counted, so it is written to the same place after each symbol.
+    thread_local byte scratch[1 << 16];
+
+    template <typename T>
+    void rebase(T *&p, const byte *from, byte *to) {
+        p = reinterpret_cast<T *>(reinterpret_cast<uintptr_t>(to) + (reinterpret_cast<uintptr_t>(p) -
+                                                                     reinterpret_cast<uintptr_t>(from)));
+    }
+}
+
+struct Ppmd::encoder_state::model : pmd_codec::EncWrap {
+    size_t take_output() {
+        size_t size = getoutsize();
+        addout(scratch, sizeof(scratch));
+        return size;
+    }
+};
+
+Ppmd::encoder_state::encoder_state(const unsigned char *data, size_t size)
+        : model_(new model), written_(0) {
+    model_->coro_init();
+    if (model_->Init(max_order, memory_mb, cut_off, static_cast<uint>(size))) {
+        delete model_;
+        throw std::bad_alloc();
+    }
+    model_->addout(scratch, sizeof(scratch));
+
+    // The size of the data in the header.
+    written_ = 4;
+    model_->rc_Init();
+    append(data, size);
+}
+
+Ppmd::encoder_state::encoder_state(const encoder_state &other)
+        : model_(new model(*other.model_)), written_(other.written_) {
+    // All links inside the memory of the model are offsets from its start, so only the used parts of it are copied
+    // and the pointers of the model are moved to the new memory.
+    byte *from = other.model_->HeapStart;
+    byte *to = new (std::nothrow) byte[model_->SubAllocatorSize];
+    if (to == nullptr) {
+        delete model_;
+        throw std::bad_alloc();
+    }
+    memcpy(to, from, model_->pText - from);
+    memcpy(to + (model_->UnitsStart - from), model_->UnitsStart, model_->LoUnit - model_->UnitsStart);
+    memcpy(to + (model_->HiUnit - from), model_->HiUnit, from + model_->SubAllocatorSize - model_->HiUnit);
+
+    model_->HeapStart = to;
+    rebase(model_->pText, from, to);
+    rebase(model_->UnitsStart, from, to);
+    rebase(model_->LoUnit, from, to);
+    rebase(model_->HiUnit, from, to);
+    rebase(model_->AuxUnit, from, to);
+    rebase(model_->FoundState, from, to);
+    rebase(model_->MaxContext, from, to);
+    rebase(model_->saved_pc, from, to);
+}
+
+Ppmd::encoder_state::~encoder_state() {
+    model_->Quit();
+    delete model_;
+}
+
+void Ppmd::encoder_state::append(const unsigned char *data, size_t size) {
+    model_->addout(scratch, sizeof(scratch));
+    for (size_t i = 0; i < size; ++i) {
+        model_->ProcessByte(data[i]);
+        written_ += model_->take_output();
+    }
+}
+
+size_t Ppmd::encoder_state::compressed_size() const {
+    // Flushing changes only the state of the range coder, which is restored then.
+    const qword lowc = model_->lowc;
+    const uint ff_num = model_->FFNum;
+    const uint cache = model_->Cache;
+    const uint range = model_->range;
+
+    model_->addout(scratch, sizeof(scratch));
+    model_->rc_Quit();
+    const size_t result = written_ + model_->take_output();
+
+    model_->lowc = lowc;
+    model_->FFNum = ff_num;
+    model_->Cache = cache;
+    model_->range = range;
+
+    return result;
+}
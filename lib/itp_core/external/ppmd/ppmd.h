@@ -10,6 +10,27 @@
 namespace Ppmd {
     size_t compress_bound(size_t);
     size_t ppmd_compress(unsigned char *dst, size_t dst_size, const unsigned char *data, size_t size);
+
+    // The state of the encoder after some data. A copy of the state continues the encoding independently of the
+    // original, so different endings of the data can be compressed without processing the data again.
+    class encoder_state {
+    public:
+        encoder_state(const unsigned char *data, size_t size);
+        encoder_state(const encoder_state &other);
+        encoder_state &operator=(const encoder_state &) = delete;
+        ~encoder_state();
+
+        void append(const unsigned char *data, size_t size);
+
+        // The same as ppmd_compress returns for all the data passed to the state.
+        size_t compressed_size() const;
+
+    private:
+        struct model;
+
+        model *model_;
+        size_t written_;
+    };
 }
 
 #endif //PREDICTOR_PPMD_H
@@ -79,6 +79,9 @@ public:
 
 	}
 
+	/*
+	 * empty the queue. The memory of the previous queue is reused
+	 */
 	void init(itype max_alphabet_size, itype min_freq) {
 
 		assert(min_freq>1);
@@ -86,6 +89,10 @@ public:
 		this->min_freq = min_freq;
 
 		H.init(max_alphabet_size, triple_t());
+		pairs_in_hash.clear();
+
+		current_size = 0;
+		peak_size = 0;
 
 	}
 
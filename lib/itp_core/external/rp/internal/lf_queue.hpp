@@ -99,6 +99,15 @@ public:
 
 	lf_queue(itype max_freq) {
 
+		init(max_freq);
+
+	}
+
+	/*
+	 * empty the queue. The memory of the previous queue is reused
+	 */
+	void init(itype max_freq) {
+
 		assert(max_freq>0);
 
 		this->max_freq = max_freq;
@@ -106,10 +115,16 @@ public:
 		this->max_size = ~(itype(0)); //for now, unlimited max size
 
 		//F = vector<ll_type>(max_freq+1);
-		F = vector<vector<cpair> >(max_freq+1,vector<cpair>(0));
-		F_idx = vector<itype>(max_freq+1,0);
-		F_size = vector<itype>(max_freq+1,0);
-		is_sorted = vector<bool>(max_freq+1,false);
+		F.resize(max_freq+1);
+		for(auto & list : F) list.clear();
+		F_idx.assign(max_freq+1,0);
+		F_size.assign(max_freq+1,0);
+		is_sorted.assign(max_freq+1,false);
+
+		H.clear();
+
+		current_size = 0;
+		peak_size = 0;
 
 		MAX = max_freq;
 
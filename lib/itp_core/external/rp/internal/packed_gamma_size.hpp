@@ -0,0 +1,232 @@
+/*
+ * packed_gamma_size.hpp
+ *
+ *  size in bytes of the output of packed_gamma_file3, computed without
+ *  materializing the bits: integers are streamed in with push_back and
+ *  close() returns the number of bytes that packed_gamma_file3 would write
+ *
+ */
+
+#ifndef INTERNAL_PACKED_GAMMA_SIZE_HPP_
+#define INTERNAL_PACKED_GAMMA_SIZE_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace Rp
+{
+using namespace std;
+
+template<typename itype = uint32_t, uint64_t block_size = 6>
+class packed_gamma_size{
+
+public:
+
+	/*
+	 * append integer x. As in packed_gamma_file3, x is truncated to itype
+	 */
+	void push_back(uint64_t x){
+
+		uint8_t w = wd(itype(x));
+
+		block_bitsize = std::max(block_bitsize,w);
+
+		if(++n%block_size == 0) close_block(block_size);
+
+	}
+
+	/*
+	 * number of bytes of the file storing all pushed integers
+	 */
+	uint64_t close(){
+
+		if(n%block_size != 0) close_block(n%block_size);
+
+		//flush the last runs
+		if(R_length > 0) close_R_run();
+		if(R2_length > 0) close_R2_run();
+
+		uint64_t bits = gamma_bits(n);
+
+		bits += gamma_bits(R_runs) + R_heads_bits;
+		bits += gamma_bits(R2_runs) + R2_bits;
+		bits += payload_bits;
+
+		return bits/8 + (bits%8 != 0);
+
+	}
+
+	/*
+	 * input: alphabet encoding A, grammar G and compressed text T
+	 *
+	 * return the number of bytes packed_gamma_file3::compress_and_store(A,G,T) outputs
+	 *
+	 */
+	uint64_t compressed_size(const vector<itype> & A, const vector<pair<itype,itype> > & G, const vector<itype> & T){
+
+		push_back(A.size());
+		for(auto a : A) push_back(a);
+
+		//the maximums of G's pairs are split in increasing sequences: count them first
+		uint64_t n_deltas = 0;
+		uint64_t last_max = 0;
+
+		for(auto ab : G){
+
+			uint64_t max = std::max(ab.first,ab.second);
+			n_deltas += max>=last_max;
+			last_max = max;
+
+		}
+
+		push_back(n_deltas);
+		last_max = 0;
+
+		for(auto ab : G){
+
+			uint64_t max = std::max(ab.first,ab.second);
+			if(max>=last_max) push_back(max-last_max);
+			last_max = max;
+
+		}
+
+		push_back(G.size()-n_deltas);
+		last_max = 0;
+
+		for(auto ab : G){
+
+			uint64_t max = std::max(ab.first,ab.second);
+			if(max<last_max) push_back(max);
+			last_max = max;
+
+		}
+
+		push_back(G.size()-n_deltas);
+		last_max = 0;
+
+		uint64_t last_incr_seq = 0;
+
+		for(uint64_t i = 0;i<G.size();++i){
+
+			uint64_t max = std::max(G[i].first,G[i].second);
+
+			if(max<last_max){
+
+				push_back(i-last_incr_seq);
+				last_incr_seq = i;
+
+			}
+
+			last_max = max;
+
+		}
+
+		push_back(G.size());
+		for(auto ab : G) push_back(std::max(ab.first,ab.second) - std::min(ab.first,ab.second));
+
+		push_back(G.size());
+		for(auto ab : G) push_back(ab.first >= ab.second);
+
+		push_back(T.size());
+		for(auto a : T) push_back(a);
+
+		return close();
+
+	}
+
+private:
+
+	/*
+	 * the bitsize of the block of the last m integers is known: delta-encode it
+	 * and feed the delta to the run-length encoders
+	 */
+	void close_block(uint64_t m){
+
+		payload_bits += m*block_bitsize;
+
+		itype delta = f(int(block_bitsize)-last_block_bitsize);
+		last_block_bitsize = block_bitsize;
+		block_bitsize = 0;
+
+		if(R_length > 0 && delta != R_head) close_R_run();
+
+		R_head = delta;
+		R_length++;
+
+	}
+
+	void close_R_run(){
+
+		R_runs++;
+		R_heads_bits += gamma_bits(R_head);
+
+		//R's run lengths are run-length encoded again
+		if(R2_length > 0 && R_length != R2_head) close_R2_run();
+
+		R2_head = R_length;
+		R2_length++;
+
+		R_length = 0;
+
+	}
+
+	void close_R2_run(){
+
+		R2_runs++;
+		R2_bits += gamma_bits(R2_length) + gamma_bits(R2_head);
+
+		R2_length = 0;
+
+	}
+
+	/*
+	 * bit-width of x
+	 */
+	static uint8_t wd(uint64_t x){
+
+		auto w = 64 - __builtin_clzll(uint64_t(x));
+
+		return x == 0 ? 1 : w;
+
+	}
+
+	static uint64_t gamma_bits(uint64_t x){
+
+		return 2*wd(x)-1;
+
+	}
+
+	/*
+	 * same mapping of signed deltas to unsigned integers as packed_gamma_file3
+	 */
+	static uint16_t f(int x){
+
+		return x>=0 ? 2*x+1 : (-x)*2;
+
+	}
+
+	uint64_t n = 0;//number of pushed integers
+
+	uint8_t block_bitsize = 0;//bitsize of the largest integer in the current block
+	int last_block_bitsize = 0;
+
+	uint64_t payload_bits = 0;
+
+	//current run of the delta-encoded bitsizes and the runs closed so far
+	itype R_head = 0;
+	itype R_length = 0;
+	uint64_t R_runs = 0;
+	uint64_t R_heads_bits = 0;
+
+	//current run of R's run lengths and the runs closed so far
+	itype R2_head = 0;
+	itype R2_length = 0;
+	uint64_t R2_runs = 0;
+	uint64_t R2_bits = 0;
+
+};
+
+} // of Rp
+
+#endif /* INTERNAL_PACKED_GAMMA_SIZE_HPP_ */
@@ -48,17 +48,19 @@ public:
 	 */
 	pair_hash(itype max_alphabet_size, el_type null_el){
 
-		this->null = null_el;
-
-		H = vector<vector<el_type> >(max_alphabet_size,vector<el_type>(max_alphabet_size,null_el));
+		init(max_alphabet_size, null_el);
 
 	}
 
+	/*
+	 * (re)build the hash. The memory of the previous hash is reused if it is large enough
+	 */
 	void init(itype max_alphabet_size, el_type null_el){
 
 		this->null = null_el;
+		this->alphabet_size = max_alphabet_size;
 
-		H = vector<vector<el_type> >(max_alphabet_size,vector<el_type>(max_alphabet_size,null_el));
+		H.assign(uint64_t(max_alphabet_size)*max_alphabet_size,null_el);
 
 	}
 
@@ -66,7 +68,7 @@ public:
 
 		assert(H.size()>0);
 		assert(contains(ab));
-		return H[ab.first][ab.second];
+		return H[index(ab)];
 
 	}
 
@@ -83,10 +85,10 @@ public:
 
 		if(ab==nullpair) return false;
 
-		assert(ab.first < H.size());
-		assert(ab.second < H.size());
+		assert(ab.first < alphabet_size);
+		assert(ab.second < alphabet_size);
 
-		return H[ab.first][ab.second] != null;
+		return H[index(ab)] != null;
 
 	}
 
@@ -100,10 +102,10 @@ public:
 		assert(ab != nullpair);
 
 		assert(not contains(ab));
-		assert(ab.first < H.size());
-		assert(ab.second < H.size());
+		assert(ab.first < alphabet_size);
+		assert(ab.second < alphabet_size);
 
-		H[ab.first][ab.second] = i;
+		H[index(ab)] = i;
 
 	}
 
@@ -117,10 +119,10 @@ public:
 		assert(ab != nullpair);
 
 		assert(contains(ab));
-		assert(ab.first < H.size());
-		assert(ab.second < H.size());
+		assert(ab.first < alphabet_size);
+		assert(ab.second < alphabet_size);
 
-		H[ab.first][ab.second] = i;
+		H[index(ab)] = i;
 
 	}
 
@@ -129,7 +131,7 @@ public:
 		assert(H.size()>0);
 		assert(contains(ab));
 
-		H[ab.first][ab.second] = null;
+		H[index(ab)] = null;
 
 	}
 
@@ -139,12 +141,20 @@ public:
 
 private:
 
+	uint64_t index(cpair ab){
+
+		return uint64_t(ab.first)*alphabet_size + ab.second;
+
+	}
+
 	el_type null = el_type();
 	const ctype blank = ~itype(0);
 
 	const cpair nullpair = {blank,blank};
 
-	vector<vector<el_type> > H;
+	//H[a*alphabet_size+b] is the element of pair ab
+	itype alphabet_size = 0;
+	vector<el_type> H;
 
 
 };
@@ -43,6 +43,8 @@ public:
 	using char_type = ctype;
 	using cpair = pair<ctype,ctype>;
 
+	skippable_text(){}
+
 	/*
 	 * initialize new empty text (filled with charcter 0).
 	 * The size of each character is max(8, bitsize(n))
@@ -50,12 +52,22 @@ public:
 	 */
 	skippable_text(itype n){
 
+		init(n);
+
+	}
+
+	/*
+	 * (re)initialize the text. The memory of the previous text is reused
+	 */
+	void init(itype n){
+
 	  assert(n>0);
 
 		this->n = n;
 		non_blank_characters = n;
+		max_symbol = 0;
 
-		non_blank = vector<uint64_t>(n/64+(n%64!=0),~uint64_t(0));//init all '1'
+		non_blank.assign(n/64+(n%64!=0),~uint64_t(0));//init all '1'
 		//non_blank[non_blank.size()] = 0;
 
 		if(n%64 != 0){//set to 0 bits in the right padding
@@ -66,10 +78,10 @@ public:
 		}
 
 		//vector storing length of skips. Init with all 0
-		skips = vector<uint64_t>(n/64+(n%64!=0),0);
+		skips.assign(n/64+(n%64!=0),0);
 
 		//T = int_vector<>(n, 0, width);
-		T = vector<uint16_t>(n, 0); width = 16;
+		T.assign(n, 0); width = 16;
 
 	}
 
@@ -53,20 +53,34 @@ public:
 	 * pair sorting.
 	 *
 	 */
+	text_positions(){}
+
 	text_positions(skippable_text<itype,ctype> * T, itype min_freq){
 
+		init(T, min_freq);
+
+	}
+
+	/*
+	 * as the constructor, but reuses the memory of the previous array
+	 */
+	void init(skippable_text<itype,ctype> * T, itype min_freq){
+
 		//hash will be of size maxd*maxd words
 		uint64_t maxd = std::max(uint64_t(std::pow(  T->size(), 0.4  )),uint64_t(T->get_max_symbol()+1));
 
 		//hash to accelerate pair sorting
-		H = vector<vector<ipair> >(maxd,vector<ipair>(maxd,{0,0}));
+		H_size = maxd;
+		H.assign(maxd*maxd,{0,0});
 
 		this->T = T;
 
 		assert(T->size()>1);
 
-		//frequency of every possible ASCII pair
-		auto F = vector<vector<itype> >(256,vector<itype>(256,0));
+		//frequency of every pair of symbols up to the largest one in the text
+		itype sigma = T->get_max_symbol()+1;
+		assert(sigma<=256);
+		F.assign(sigma*sigma,0);
 
 		//count frequencies
 		for(itype i = 0;i<T->size()-1;++i){
@@ -77,10 +91,10 @@ public:
 
 			assert(p != T->blank_pair());
 
-			assert(a<256);
-			assert(b<256);
+			assert(a<sigma);
+			assert(b<sigma);
 
-			F[a][b]++;
+			F[a*sigma+b]++;
 
 		}
 
@@ -88,19 +102,19 @@ public:
 
 		itype hf_pairs = 0;
 
-		for(ctype a = 0;a<256;++a){
+		for(ctype a = 0;a<sigma;++a){
 
-			for(ctype b = 0;b<256;++b){
+			for(ctype b = 0;b<sigma;++b){
 
-				itype t = F[a][b];
+				itype t = F[a*sigma+b];
 
-				if(F[a][b] < min_freq){
+				if(F[a*sigma+b] < min_freq){
 
-					F[a][b] = null;
+					F[a*sigma+b] = null;
 
 				}else{
 
-					F[a][b] = hf_pairs;
+					F[a*sigma+b] = hf_pairs;
 					hf_pairs += t;
 
 				}
@@ -110,7 +124,7 @@ public:
 		}
 
 		//TP = int_vector<>(hf_pairs,0,width);
-		TP = vector<itype>(hf_pairs,0);
+		TP.assign(hf_pairs,0);
 
 		//fill TP: cluster high-freq pairs
 		for(itype i = 0;i<T->size()-1;++i){
@@ -119,15 +133,15 @@ public:
 			ctype a = p.first;
 			ctype b = p.second;
 
-			assert(a<256);
-			assert(b<256);
+			assert(a<sigma);
+			assert(b<sigma);
 
-			if(F[a][b] != null){//if ab is a high-freq pair
+			if(F[a*sigma+b] != null){//if ab is a high-freq pair
 
-				assert(F[a][b] < TP.size());
+				assert(F[a*sigma+b] < TP.size());
 
 				//store i at position F[a][b], increment F[a][b]
-				TP[ F[a][b]++ ] = i;
+				TP[ F[a*sigma+b]++ ] = i;
 
 			}
 
@@ -145,10 +159,8 @@ public:
 
 		assert(T->number_of_non_blank_characters() > 1);
 
-		TP = vector<itype>(0);//free memory
-
 		//TP.resize(T->number_of_non_blank_characters()-1);
-		TP = vector<itype>(T->number_of_non_blank_characters()-1);
+		TP.assign(T->number_of_non_blank_characters()-1,0);
 
 		itype j=0;
 		for(itype i = 0;i<T->size();++i){
@@ -189,7 +201,7 @@ public:
 		 * if the largest symbol in the text is too big for the hash,
 		 * just apply slow comparison-sort
 		 */
-		if(T->get_max_symbol() >= H.size()){
+		if(T->get_max_symbol() >= H_size){
 
 			cluster1(i,j);
 			//nlogn_sort(i,j);
@@ -203,7 +215,7 @@ public:
 		assert(i<j);
 
 		//mark in a bitvector only one position per distinct pair
-		auto distinct_pair_positions = vector<bool>(j-i,false);
+		distinct_pair_positions.assign(j-i,false);
 
 		//first step: count frequencies
 		for(itype k = i; k<j; ++k){
@@ -216,13 +228,13 @@ public:
 
 				if(ab != nullpair ){
 
-					assert(a<H.size());
-					assert(b<H.size());
+					assert(a<H_size);
+					assert(b<H_size);
 
 					//write a '1' iff this is the first time we see this pair
-					distinct_pair_positions[k-i] = (H[a][b].first==0);
+					distinct_pair_positions[k-i] = (H[a*H_size+b].first==0);
 
-					H[a][b].first++;
+					H[a*H_size+b].first++;
 
 				}
 
@@ -243,13 +255,13 @@ public:
 
 				assert(ab != nullpair);
 
-				assert(a<H.size());
-				assert(b<H.size());
+				assert(a<H_size);
+				assert(b<H_size);
 
-				itype temp = H[a][b].first;
+				itype temp = H[a*H_size+b].first;
 
-				H[a][b].first = t;
-				H[a][b].second = t;
+				H[a*H_size+b].first = t;
+				H[a*H_size+b].second = t;
 
 				t += temp;
 
@@ -286,8 +298,8 @@ public:
 
 			}else{
 
-				ab_start = H[a][b].first;
-				ab_end = H[a][b].second;
+				ab_start = H[a*H_size+b].first;
+				ab_end = H[a*H_size+b].second;
 
 			}
 
@@ -309,7 +321,7 @@ public:
 				}else{
 
 					//if k is exactly next ab position, increment next ab position
-					H[a][b].second += (ab_end == k);
+					H[a*H_size+b].second += (ab_end == k);
 
 				}
 
@@ -327,7 +339,7 @@ public:
 				}else{
 
 					//move forward ab_end since we inserted an ab on top of the list of ab's
-					H[a][b].second++;
+					H[a*H_size+b].second++;
 
 				}
 
@@ -346,7 +358,7 @@ public:
 
 				assert(ab!=nullpair);
 
-				H[a][b] = {0,0};
+				H[a*H_size+b] = {0,0};
 
 			}
 
@@ -371,7 +383,7 @@ public:
 		assert(i<j);
 
 		//mark in a bitvector only one position per distinct pair
-		auto distinct_pair_positions = vector<bool>(j-i,false);
+		distinct_pair_positions.assign(j-i,false);
 
 		//first step: count frequencies
 		for(itype k = i; k<j; ++k){
@@ -596,7 +608,12 @@ private:
 	skippable_text<itype,ctype> * T;
 
 	//hash to speed-up pair sorting (to linear time)
-	vector<vector<ipair> > H; //H[a][b] = <begin, end>. end = next position where to store ab
+	vector<ipair> H; //H[a*H_size+b] = <begin, end>. end = next position where to store ab
+	uint64_t H_size = 0;
+
+	//pair frequencies and per-cluster marks, kept between calls to reuse their memory
+	vector<itype> F;
+	vector<bool> distinct_pair_positions;
 
 	//the array of text positions
 	//int_vector<> TP;
@@ -35,7 +35,7 @@
 #include <fstream>
 #include <memory.h>
 
-#include "internal/packed_gamma_file3.hpp"
+#include "internal/packed_gamma_size.hpp"
 #include "internal/skippable_text.hpp"
 #include "internal/text_positions.hpp"
 #include "internal/hf_queue.hpp"
@@ -63,6 +63,12 @@ namespace Rp {
         vector<itype> A; //alphabet (mapping int->ascii)
         vector<pair<itype, itype> > G; //grammar
         vector<itype> T_vec;// compressed text
+
+        // Working structures, kept here to reuse their memory when the structure compresses several texts.
+        text_t T;
+        TP_t TP;
+        hf_q_t HFQ;
+        lf_q_t LFQ;
     };
 
     void new_high_frequency_queue(hf_q_t &, TP_t &, text_t &, uint64_t);
@@ -89,6 +95,8 @@ namespace Rp {
     void decompress(vector<itype> &, vector<pair<itype, itype> > &, vector<itype> &, ofstream &);
 
     size_t rp_compress(const unsigned char *, size_t);
+
+    size_t rp_compress(const unsigned char *, size_t, workspace &);
 } // of Rp
 
 /*
@@ -125,8 +133,9 @@ void Rp::new_high_frequency_queue(hf_q_t &Q, TP_t &TP, text_t &T, uint64_t min_f
         j++;
     }
 
-    //largest possible dictionary symbol
-    itype max_d = 256 + T.size() / min_freq;
+    //largest possible dictionary symbol: the symbols of the text are followed by at most one new symbol
+    //per min_freq text positions
+    itype max_d = T.get_max_symbol() + 1 + T.size() / min_freq;
 
     //create new queue. Capacity is number of pairs / min_frequency
     Q.init(max_d, min_freq);
@@ -431,7 +440,8 @@ void Rp::compute_repair(const unsigned char *ifs, itype n, std::unique_ptr<Globa
     itype max_d = 256 + n / min_high_frequency;
 
     //initialize text and text positions
-    text_t T(n);
+    text_t &T = g->T;
+    T.init(n);
 
     itype j = 0;
 
@@ -452,12 +462,13 @@ void Rp::compute_repair(const unsigned char *ifs, itype n, std::unique_ptr<Globa
 
     }
 
-    TP_t TP(&T, min_high_frequency);
+    TP_t &TP = g->TP;
+    TP.init(&T, min_high_frequency);
 
     //next free dictionary symbol = sigma
     g->X = sigma;
 
-    hf_q_t HFQ;
+    hf_q_t &HFQ = g->HFQ;
     new_high_frequency_queue(HFQ, TP, T, min_high_frequency);
 
     int last_perc = -1;
@@ -511,7 +522,8 @@ void Rp::compute_repair(const unsigned char *ifs, itype n, std::unique_ptr<Globa
         }
     }
 
-    lf_q_t LFQ(min_high_frequency - 1);
+    lf_q_t &LFQ = g->LFQ;
+    LFQ.init(min_high_frequency - 1);
 
     f = 1;
 
@@ -614,12 +626,31 @@ void Rp::decompress(vector<itype> &A, vector<pair<itype, itype> > &G, vector<ity
 
 }
 
+Rp::workspace::workspace() : g(new Globals) {
+}
+
+Rp::workspace::~workspace() = default;
+
 size_t Rp::rp_compress(const unsigned char *src, size_t size) {
-    std::unique_ptr<Globals> g(new Globals);
+    workspace ws;
+
+    return rp_compress(src, size, ws);
+}
+
+size_t Rp::rp_compress(const unsigned char *src, size_t size, workspace &ws) {
+    std::unique_ptr<Globals> &g = ws.g;
+
+    g->X = 0;
+    g->last_freq = 0;
+    g->n_distinct_freqs = 0;
+    g->A.clear();
+    g->G.clear();
+    g->T_vec.clear();
 
     compute_repair(src, size, g);
 
-    packed_gamma_file3<> out_file;
+    // Only the size of the output is needed, so it is computed without packing the bits.
+    packed_gamma_size<> out_size;
 
-    return out_file.compress_and_store(g->A, g->G, g->T_vec);
+    return out_size.compressed_size(g->A, g->G, g->T_vec);
 }
@@ -5,8 +5,33 @@
 #ifndef PREDICTOR_RP_H
 #define PREDICTOR_RP_H
 
+#include <cstddef>
+#include <memory>
+
 namespace Rp {
+    struct Globals;
+
+    /*
+     * The text, its positions and the queues of the compressor. Passing the same workspace to many
+     * calls of rp_compress reuses their memory instead of allocating it for every text.
+     */
+    class workspace {
+    public:
+        workspace();
+        ~workspace();
+
+        workspace(const workspace &) = delete;
+        workspace &operator=(const workspace &) = delete;
+
+    private:
+        friend size_t rp_compress(const unsigned char *, size_t, workspace &);
+
+        std::unique_ptr<Globals> g;
+    };
+
     size_t rp_compress(const unsigned char *src, size_t size);
+
+    size_t rp_compress(const unsigned char *src, size_t size, workspace &ws);
 }
 
 #endif //PREDICTOR_RP_H
@@ -0,0 +1,368 @@
+#include "sequitur.h"
+
+#include <cmath>
+
+namespace Sequitur
+{
+
+namespace
+{
+
+const int nil = -1;
+
+/*
+ * log2 of the gamma function of a positive x by the Stirling series (std::lgamma is not required to be thread-safe).
+ */
+double log2_gamma(double x)
+{
+	double shift = 0;
+	for (; x < 8; x += 1) {
+		shift += std::log(x);
+	}
+
+	double inv = 1 / x;
+	double inv2 = inv * inv;
+	double result = (x - 0.5) * std::log(x) - x + 0.91893853320467274178
+		+ inv * (1.0 / 12 - inv2 * (1.0 / 360 - inv2 / 1260));
+
+	return (result - shift) / std::log(2.0);
+}
+
+} // namespace
+
+grammar::grammar()
+{
+	clear();
+}
+
+void grammar::clear()
+{
+	next.clear();
+	prev.clear();
+	value.clear();
+	guard.assign(1, nil);
+	count.assign(1, 0);
+	digrams.clear();
+	kinds.clear();
+	total = 0;
+	distinct = 0;
+	kinds_bits = 0;
+	changes.clear();
+	marks.clear();
+
+	new_rule();
+}
+
+void grammar::append(uint32_t terminal)
+{
+	const int sequence = 1;
+
+	insert_after(last(sequence), new_symbol(2 * int(terminal) + 1));
+	check(prev[last(sequence)]);
+}
+
+void grammar::push()
+{
+	marks.push_back({changes.size(), next.size(), guard.size(), kinds.size(), total, distinct, kinds_bits});
+}
+
+void grammar::pop()
+{
+	const mark &saved = marks.back();
+
+	for (; changes.size() > saved.changes; changes.pop_back()) {
+		const change &c = changes.back();
+		if (c.array) {
+			(this->*c.array)[c.index] = c.old_value;
+		} else if (c.old_value == nil) {
+			digrams.erase(c.index);
+		} else {
+			digrams[c.index] = c.old_value;
+		}
+	}
+
+	next.resize(saved.symbols);
+	prev.resize(saved.symbols);
+	value.resize(saved.symbols);
+	guard.resize(saved.rules);
+	count.resize(saved.rules);
+	kinds.resize(saved.kinds);
+	total = saved.total;
+	distinct = saved.distinct;
+	kinds_bits = saved.kinds_bits;
+
+	marks.pop_back();
+}
+
+size_t grammar::depth() const
+{
+	return marks.size();
+}
+
+double grammar::encoded_size() const
+{
+	double half_distinct = distinct / 2.0;
+	return log2_gamma(total + half_distinct) - log2_gamma(half_distinct) - kinds_bits;
+}
+
+/*
+ * All changes of the grammar, except the elements appended to the arrays, are made here to be undone by pop.
+ */
+void grammar::set(std::vector<int> grammar::*array, int index, int new_value)
+{
+	if (!marks.empty()) {
+		changes.push_back({array, uint64_t(index), (this->*array)[index]});
+	}
+	(this->*array)[index] = new_value;
+}
+
+int grammar::find_digram(uint64_t key) const
+{
+	auto found = digrams.find(key);
+	return found == digrams.end() ? nil : found->second;
+}
+
+void grammar::put_digram(uint64_t key, int symbol)
+{
+	if (!marks.empty()) {
+		changes.push_back({nullptr, key, find_digram(key)});
+	}
+	digrams[key] = symbol;
+}
+
+void grammar::erase_digram(uint64_t key)
+{
+	if (!marks.empty()) {
+		changes.push_back({nullptr, key, find_digram(key)});
+	}
+	digrams.erase(key);
+}
+
+void grammar::count_kind(int kind, int delta)
+{
+	if (size_t(kind) >= kinds.size()) {
+		kinds.resize(kind + 1, 0);
+	}
+
+	int n = kinds[kind];
+	if (delta > 0) {
+		kinds_bits += std::log2(n + 0.5);
+		distinct += n == 0;
+		++total;
+	} else {
+		kinds_bits -= std::log2(n - 0.5);
+		distinct -= n == 1;
+		--total;
+	}
+	set(&grammar::kinds, kind, n + delta);
+}
+
+int grammar::new_guard(int rule)
+{
+	int symbol = int(next.size());
+	next.push_back(symbol);
+	prev.push_back(symbol);
+	value.push_back(2 * rule);
+
+	return symbol;
+}
+
+int grammar::new_symbol(int symbol_value)
+{
+	int symbol = int(next.size());
+	next.push_back(nil);
+	prev.push_back(nil);
+	value.push_back(symbol_value);
+
+	if (symbol_value % 2 == 0) {
+		set(&grammar::count, symbol_value / 2, count[symbol_value / 2] + 1);
+	}
+	count_kind(symbol_value, 1);
+
+	return symbol;
+}
+
+/*
+ * The symbols are never reused, so the deleted ones are read as in c++/classes.cc.
+ */
+void grammar::delete_symbol(int symbol)
+{
+	join(prev[symbol], next[symbol]);
+	if (!is_guard(symbol)) {
+		delete_digram(symbol);
+		if (non_terminal(symbol)) {
+			set(&grammar::count, value[symbol] / 2, count[value[symbol] / 2] - 1);
+		}
+		if (value[symbol] != 0) {
+			count_kind(value[symbol], -1);
+		}
+	}
+}
+
+int grammar::new_rule()
+{
+	int rule = int(guard.size());
+	guard.push_back(new_guard(rule));
+	count.push_back(0);
+	count_kind(0, 1);
+
+	return rule;
+}
+
+void grammar::delete_rule(int rule)
+{
+	delete_symbol(guard[rule]);
+	count_kind(0, -1);
+}
+
+bool grammar::non_terminal(int symbol) const
+{
+	return value[symbol] % 2 == 0 && value[symbol] != 0;
+}
+
+bool grammar::is_guard(int symbol) const
+{
+	return non_terminal(symbol) && guard[value[symbol] / 2] == symbol;
+}
+
+uint64_t grammar::digram(int symbol) const
+{
+	return uint64_t(uint32_t(value[symbol])) << 32 | uint32_t(value[next[symbol]]);
+}
+
+int grammar::first(int rule) const
+{
+	return next[guard[rule]];
+}
+
+int grammar::last(int rule) const
+{
+	return prev[guard[rule]];
+}
+
+void grammar::join(int left, int right)
+{
+	if (next[left] != nil) {
+		delete_digram(left);
+
+		// Only the second pair of overlapping digrams of a triple is in the table, so the first one is put there
+		// when the second one is deleted.
+		if (prev[right] != nil && next[right] != nil &&
+			value[right] == value[prev[right]] && value[right] == value[next[right]]) {
+			put_digram(digram(right), right);
+		}
+
+		if (prev[left] != nil && next[left] != nil &&
+			value[left] == value[next[left]] && value[left] == value[prev[left]]) {
+			put_digram(digram(prev[left]), prev[left]);
+		}
+	}
+
+	set(&grammar::next, left, right);
+	set(&grammar::prev, right, left);
+}
+
+void grammar::insert_after(int symbol, int inserted)
+{
+	join(inserted, next[symbol]);
+	join(symbol, inserted);
+}
+
+void grammar::delete_digram(int symbol)
+{
+	if (is_guard(symbol) || is_guard(next[symbol])) {
+		return;
+	}
+
+	uint64_t key = digram(symbol);
+	if (find_digram(key) == symbol) {
+		erase_digram(key);
+	}
+}
+
+/*
+ * Enforces the constraints of Sequitur on the digram starting with the symbol. Returns true if the grammar was changed.
+ */
+bool grammar::check(int symbol)
+{
+	if (is_guard(symbol) || is_guard(next[symbol])) {
+		return false;
+	}
+
+	uint64_t key = digram(symbol);
+	int found = find_digram(key);
+	if (found == nil) {
+		put_digram(key, symbol);
+		return false;
+	}
+
+	if (next[found] == symbol || next[symbol] == found) {
+		return false;
+	}
+
+	int rule;
+	if (is_guard(prev[found]) && is_guard(next[next[found]])) {
+		rule = value[prev[found]] / 2;
+		substitute(symbol, rule);
+	} else {
+		rule = new_rule();
+		insert_after(last(rule), new_symbol(value[symbol]));
+		insert_after(last(rule), new_symbol(value[next[symbol]]));
+
+		substitute(found, rule);
+		put_digram(key, first(rule));
+		substitute(symbol, rule);
+	}
+
+	int head = first(rule);
+	if (non_terminal(head) && count[value[head] / 2] == 1) {
+		expand(head);
+	}
+
+	return true;
+}
+
+void grammar::substitute(int symbol, int rule)
+{
+	int before = prev[symbol];
+
+	delete_symbol(next[before]);
+	delete_symbol(next[before]);
+
+	insert_after(before, new_symbol(2 * rule));
+
+	if (!check(before)) {
+		check(next[before]);
+	}
+}
+
+/*
+ * Replaces the last reference to a rule by the right hand of the rule.
+ */
+void grammar::expand(int symbol)
+{
+	int left = prev[symbol];
+	int right = next[symbol];
+	int rule = value[symbol] / 2;
+	int head = first(rule);
+	int tail = last(rule);
+
+	uint64_t key = digram(symbol);
+	delete_rule(rule);
+
+	if (find_digram(key) == symbol) {
+		erase_digram(key);
+	}
+
+	// The symbol must not decrement the count of the deleted rule.
+	count_kind(value[symbol], -1);
+	set(&grammar::value, symbol, 0);
+	delete_symbol(symbol);
+
+	join(left, head);
+	join(tail, right);
+
+	put_digram(digram(tail), tail);
+}
+
+} // namespace Sequitur
@@ -1,10 +1,121 @@
 #ifndef ITP_SEQUITUR_H
 #define ITP_SEQUITUR_H
 
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
 namespace Sequitur
 {
 
-size_t sequitur_compress(const unsigned char *src, size_t size);
+/*
+ * The grammar which Sequitur builds for a sequence, extended by one terminal at a time. The algorithm is the one of
+ * c++/classes.cc (a rule is made of every repeated digram, K = 1, no delimiters), but the state is not global and the
+ * symbols and the rules are kept in arrays and referred to by indexes. That makes every change of the grammar an
+ * assignment of an array element, so the changes are logged while a state is saved by push and undone by pop.
+ *
+ * The encoded size is the code length, by the Krichevsky-Trofimov estimator, of the right hands of all rules, each one
+ * ended with a marker. It depends only on the counts of the symbols, so it is updated on each change of the grammar
+ * instead of serialising the grammar.
+ */
+class grammar
+{
+public:
+	grammar();
+
+	/*
+	 * Makes the grammar empty and forgets the saved states.
+	 */
+	void clear();
+
+	/*
+	 * Appends a terminal, which is less than 2^30, to the sequence.
+	 */
+	void append(uint32_t terminal);
+
+	/*
+	 * Saves the state of the grammar.
+	 */
+	void push();
+
+	/*
+	 * Restores the last saved state of the grammar.
+	 */
+	void pop();
+
+	/*
+	 * The number of saved states.
+	 */
+	size_t depth() const;
+
+	/*
+	 * The encoded size of the grammar in bits.
+	 */
+	double encoded_size() const;
+
+private:
+	struct change {
+		std::vector<int> grammar::*array; // nullptr for the table of digrams
+		uint64_t index;
+		int old_value;           // -1 for an absent digram
+	};
+
+	struct mark {
+		size_t changes;
+		size_t symbols;
+		size_t rules;
+		size_t kinds;
+		uint64_t total;
+		uint64_t distinct;
+		double kinds_bits;
+	};
+
+	void set(std::vector<int> grammar::*array, int index, int new_value);
+	int find_digram(uint64_t key) const;
+	void put_digram(uint64_t key, int symbol);
+	void erase_digram(uint64_t key);
+	void count_kind(int kind, int delta);
+
+	int new_guard(int rule);
+	int new_symbol(int symbol_value);
+	void delete_symbol(int symbol);
+	int new_rule();
+	void delete_rule(int rule);
+
+	bool non_terminal(int symbol) const;
+	bool is_guard(int symbol) const;
+	uint64_t digram(int symbol) const;
+	int first(int rule) const;
+	int last(int rule) const;
+
+	void join(int left, int right);
+	void insert_after(int symbol, int inserted);
+	void delete_digram(int symbol);
+	bool check(int symbol);
+	void substitute(int symbol, int rule);
+	void expand(int symbol);
+
+	// Symbols: a terminal t has value 2t + 1, a non-terminal and the guard of rule r have value 2r.
+	std::vector<int> next;
+	std::vector<int> prev;
+	std::vector<int> value;
+
+	// Rules: rule 0 is unused, rule 1 is the sequence itself.
+	std::vector<int> guard;
+	std::vector<int> count;
+
+	std::unordered_map<uint64_t, int> digrams;
+
+	// Occurrences of each symbol value in the right hands of the rules, kinds[0] counts the end markers.
+	std::vector<int> kinds;
+	uint64_t total = 0;    // occurrences of all values
+	uint64_t distinct = 0; // values occurring at least once
+	double kinds_bits = 0; // sum of log2(Gamma(n + 1/2) / Gamma(1/2)) over the numbers of occurrences n
+
+	std::vector<change> changes;
+	std::vector<mark> marks;
+};
 
 } // namespace Sequitur
 
@@ -27,6 +27,7 @@ See libzpaq.h for additional documentation.
 #include <string>
 #include <vector>
 #include <stdio.h>
+#include <math.h>
 
 #ifdef unix
 #ifndef NOJIT
@@ -1712,6 +1713,7 @@ Predictor::Predictor(ZPAQL& zr):
   assert(sizeof(int)==4);
   pcode=0;
   pcode_size=0;
+  undo=0;
   initTables=false;
 }
 
@@ -1719,8 +1721,9 @@ Predictor::~Predictor() {
   allocx(pcode, pcode_size, 0);  // free executable memory
 }
 
-// Initialize the predictor with a new model in z
-void Predictor::init() {
+// Initialize the predictor with a new model in z. If reuse then z has
+// the same model as before and its memory is zeroed instead of freed.
+void Predictor::init(bool reuse) {
 
   // Clear old JIT code if any
   allocx(pcode, pcode_size, 0);
@@ -1765,8 +1768,11 @@ void Predictor::init() {
   for (int i=0; i<256; ++i) h[i]=p[i]=0;
 
   // Initialize components
-  for (int i=0; i<256; ++i)  // clear old model
-    comp[i].init();
+  for (int i=0; i<256; ++i) {  // clear old model
+    Component& cr=comp[i];
+    if (reuse) cr.limit=cr.cxt=cr.a=cr.b=cr.c=0;
+    else cr.init();
+  }
   int n=z.header[6]; // hsize[0..1] hh hm ph pm n (comp)[n] END 0[128] (hcomp) END
   const U8* cp=&z.header[7];  // start of component list
   for (int i=0; i<n; ++i) {
@@ -1850,6 +1856,68 @@ void Predictor::init() {
   }
 }
 
+// Values of the model saved before they change, so that Model can
+// restore its saved states. Changes are logged 4 bytes at a time.
+class UndoLog {
+public:
+  struct Change {
+    char* p;  // changed address
+    U32 x;    // old value of p[0..n-1]
+    int n;    // 1..4
+  };
+  std::vector<Change> changes;
+
+  // State of a Model saved by push(), except the logged values
+  struct State {
+    size_t changes;            // size of changes at push()
+    int c8, hmap4;             // Predictor state
+    std::vector<int> p;
+    std::vector<U32> h;
+    std::vector<size_t> comp;  // limit, cxt, a, b, c of each component
+    U32 a, b, c, d;            // ZPAQL state
+    int f, pc;
+    std::vector<U8> m;
+    std::vector<U32> zh, r;
+  };
+  std::vector<State> states;  // [0..depth-1] are saved
+  int depth;
+  std::string config;         // of the model
+
+  UndoLog(): depth(0) {}
+
+  // Save x of 1, 2 or 4 bytes
+  template <typename T> void save(T& x) {
+    Change ch;
+    ch.p=(char*)&x;
+    ch.x=U32(x);
+    ch.n=sizeof(T);
+    changes.push_back(ch);
+  }
+
+  // Save p[0..n-1], n a multiple of 4
+  void save(void* p, int n) {
+    assert(n%4==0);
+    for (int i=0; i<n; i+=4)
+      save(((U32*)p)[i/4]);
+  }
+
+  // Undo changes[n...]
+  void undo(size_t n) {
+    assert(n<=changes.size());
+    while (changes.size()>n) {
+      const Change& ch=changes.back();
+      if (ch.n==4) *(U32*)ch.p=ch.x;
+      else if (ch.n==2) *(U16*)ch.p=ch.x;
+      else *(U8*)ch.p=ch.x;
+      changes.pop_back();
+    }
+  }
+};
+
+template <typename T> void Predictor::save(T& x) {
+  if (undo) undo->save(x);
+}
+
 // Return next bit prediction using interpreted COMP code
 int Predictor::predict0() {
   assert(initTables);
@@ -1968,11 +2036,14 @@ void Predictor::update0(int y) {
       case CONS:  // c
         break;
       case CM:  // sizebits limit
+        save(cr.cm(cr.cxt));
         train(cr, y);
         break;
       case ICM: { // sizebits: cxt=ht[b]=bh, ht[c][0..15]=bh row, cxt=bh
+        save(cr.ht[cr.c+(hmap4&15)]);
         cr.ht[cr.c+(hmap4&15)]=st.next(cr.ht[cr.c+(hmap4&15)], y);
         U32& pn=cr.cm(cr.cxt);
+        save(pn);
         pn+=int(y*32767-(pn>>8))>>2;
       }
         break;
@@ -1987,6 +2058,7 @@ void Predictor::update0(int y) {
         assert(cr.ht.size()==(size_t(1)<<cp[2]));
         assert(cr.limit<cr.ht.size());
         if (int(cr.c)!=y) cr.a=0;  // mismatch?
+        save(cr.ht(cr.limit));
         cr.ht(cr.limit)+=cr.ht(cr.limit)+y;
         if (++cr.cxt==8) {
           cr.cxt=0;
@@ -2000,6 +2072,7 @@ void Predictor::update0(int y) {
                 ++cr.a;
           }
           else cr.a+=cr.a<255;
+          save(cr.cm(h[i]));
           cr.cm(h[i])=cr.limit;
         }
       }
@@ -2015,6 +2088,7 @@ void Predictor::update0(int y) {
         w+=(err*(p[cp[2]]-p[cp[3]])+(1<<12))>>13;
         if (w<0) w=0;
         if (w>65535) w=65535;
+        save(cr.a16[cr.cxt]);
         cr.a16[cr.cxt]=w;
       }
         break;
@@ -2026,6 +2100,7 @@ void Predictor::update0(int y) {
         assert(cr.cxt+m<=cr.cm.size());
         int err=(y*32767-squash(p[i]))*cp[4]>>4;
         int* wt=(int*)&cr.cm[cr.cxt];
+        if (undo) undo->save(wt, m*4);
         for (int j=0; j<m; ++j)
           wt[j]=clamp512k(wt[j]+((err*p[cp[2]+j]+(1<<12))>>13));
       }
@@ -2034,12 +2109,15 @@ void Predictor::update0(int y) {
         assert(cr.cxt==cr.ht[cr.c+(hmap4&15)]);
         int err=y*32767-squash(p[i]);
         int *wt=(int*)&cr.cm[cr.cxt*2];
+        if (undo) undo->save(wt, 8);
         wt[0]=clamp512k(wt[0]+((err*p[cp[2]]+(1<<12))>>13));
         wt[1]=clamp512k(wt[1]+((err+16)>>5));
+        save(cr.ht[cr.c+(hmap4&15)]);
         cr.ht[cr.c+(hmap4&15)]=st.next(cr.cxt, y);
       }
         break;
       case SSE:  // sizebits j start limit
+        save(cr.cm(cr.cxt));
         train(cr, y);
         break;
       default:
@@ -2079,12 +2157,11 @@ size_t Predictor::find(Array<U8>& ht, int sizebits, U32 cxt) {
   if (ht[h1]==chk) return h1;
   size_t h2=h0^32;
   if (ht[h2]==chk) return h2;
-  if (ht[h0+1]<=ht[h1+1] && ht[h0+1]<=ht[h2+1])
-    return memset(&ht[h0], 0, 16), ht[h0]=chk, h0;
-  else if (ht[h1+1]<ht[h2+1])
-    return memset(&ht[h1], 0, 16), ht[h1]=chk, h1;
-  else
-    return memset(&ht[h2], 0, 16), ht[h2]=chk, h2;
+  size_t hr=h2;  // row to replace
+  if (ht[h0+1]<=ht[h1+1] && ht[h0+1]<=ht[h2+1]) hr=h0;
+  else if (ht[h1+1]<ht[h2+1]) hr=h1;
+  if (undo) undo->save(&ht[hr], 16);
+  return memset(&ht[hr], 0, 16), ht[hr]=chk, hr;
 }
 
 /////////////////////// Decoder ///////////////////////
@@ -7534,22 +7611,14 @@ std::string makeConfig(const char* method, int args[]) {
   return hdr+itos(ncomp)+"\n"+comp+hcomp+"halt\n"+pcomp;
 }
 
-// Compress from in to out in 1 segment in 1 block using the algorithm
-// descried in method. If method begins with a digit then choose
-// a method depending on type. Save filename and comment
-// in the segment header. If comment is 0 then the default is the input size
-// as a decimal string, plus " jDC\x01" for a journaling method (method[0]
-// is not 's'). Write the generated method to methodOut if not 0.
-void compressBlock(StringBuffer* in, Writer* out, const char* method_,
-                   const char* filename, const char* comment, bool dosha1) {
-  assert(in);
-  assert(out);
+// Return method with a default method (beginning with a digit) replaced
+// by the method that compressBlock() uses for data p[0..n-1]
+static std::string expandMethod(const char* method_, const unsigned char* p,
+                                unsigned n) {
   assert(method_);
   assert(method_[0]);
   std::string method=method_;
-  const unsigned n=in->size();  // input size
   const int arg0=MAX(lg(n+4095)-20, 0);  // block size
-  assert((1u<<(arg0+20))>=n+4096);
 
   // Get type from method "LB,R,t" where L is level 0..5, B is block
   // size 0..11, R is redundancy 0..255, t = 0..3 = binary, text, exe, both.
@@ -7564,18 +7633,6 @@ void compressBlock(StringBuffer* in, Writer* out, const char* method_,
     else type=arg[1]*4+arg[2];
   }
 
-  // Get hash of input
-  libzpaq::SHA1 sha1;
-  const char* sha1ptr=0;
-#ifdef DEBUG
-  if (true) {
-#else
-  if (dosha1) {
-#endif
-    sha1.write(in->c_str(), n);
-    sha1ptr=sha1.result();
-  }
-
   // Expand default methods
   if (isdigit(method[0])) {
     const int level=method[0]-'0';
@@ -7656,7 +7713,6 @@ void compressBlock(StringBuffer* in, Writer* out, const char* method_,
       const int NR=1<<12;
       int pt[256]={0};  // position of last occurrence
       int r[NR]={0};    // count repetition gaps of length r
-      const unsigned char* p=in->data();
       if (level>0) {
         for (unsigned i=0; i<n; ++i) {
           const int k=i-pt[p[i]];
@@ -7690,6 +7746,35 @@ void compressBlock(StringBuffer* in, Writer* out, const char* method_,
     }
   }
 
+  return method;
+}
+
+// Compress from in to out in 1 segment in 1 block using the algorithm
+// descried in method. If method begins with a digit then choose
+// a method depending on type. Save filename and comment
+// in the segment header. If comment is 0 then the default is the input size
+// as a decimal string, plus " jDC\x01" for a journaling method (method[0]
+// is not 's'). Write the generated method to methodOut if not 0.
+void compressBlock(StringBuffer* in, Writer* out, const char* method_,
+                   const char* filename, const char* comment, bool dosha1) {
+  assert(in);
+  assert(out);
+  const unsigned n=in->size();  // input size
+  assert((1u<<(MAX(lg(n+4095)-20, 0)+20))>=n+4096);
+  const std::string method=expandMethod(method_, in->data(), n);
+
+  // Get hash of input
+  libzpaq::SHA1 sha1;
+  const char* sha1ptr=0;
+#ifdef DEBUG
+  if (true) {
+#else
+  if (dosha1) {
+#endif
+    sha1.write(in->c_str(), n);
+    sha1ptr=sha1.result();
+  }
+
   // Compress
   std::string config;
   int args[9]={0};
@@ -7730,4 +7815,150 @@ void compressBlock(StringBuffer* in, Writer* out, const char* method_,
   co.endBlock();
 }
 
+
+//////////////////////////// Model ///////////////////////////
+
+// Changes logged while no state but the initial one is saved are
+// discarded above this limit. Then init() builds the model again.
+static const size_t MAX_FRESH_CHANGES=1<<21;
+
+Model::Model(): z(), pr(z), undo(new UndoLog), fresh(false), bits0(0) {
+  pr.undo=undo;
+}
+
+Model::~Model() {
+  delete undo;
+}
+
+// Build the model of compressBlock() for method and data[0..n-1]. If it
+// is already built then reset it and return false.
+bool Model::init(const char* method, const char* data, size_t n) {
+  if (n>(0x100000u<<11)-4096) error("Model input too big");
+  int args[9]={0};
+  const std::string config=makeConfig(
+      expandMethod(method, (const unsigned char*)data, unsigned(n)).c_str(),
+      args);
+  if (args[1]!=0) error("Model does not support preprocessing");
+  if (config==undo->config) {
+    reset();
+    return false;
+  }
+  undo->config="";
+  ZPAQL pz;
+  Compiler(config.c_str(), args, z, pz, 0);
+  if (!pr.isModeled()) error("Model needs a model");
+  pr.init();
+  undo->config=config;
+  fresh=true;
+  undo->changes.clear();
+  undo->depth=0;
+  push();
+  bits0=code(0);  // no postprocessor
+  return true;
+}
+
+// Go to the state after init()
+void Model::reset() {
+  assert(undo->depth>0);
+  undo->depth=1;
+  if (fresh)
+    pop();
+  else {
+    undo->changes.clear();
+    undo->depth=0;
+    pr.init(true);
+    fresh=true;
+  }
+  assert(undo->depth==0);
+  push();
+  bits0=code(0);
+}
+
+// Model byte c like Encoder::compress() and return its cost in bits
+double Model::code(int c) {
+  assert(undo->depth>0);
+  assert(c>=0 && c<=255);
+  pr.undo=fresh || undo->depth>1 ? undo : 0;  // log only what can be undone
+  double bits=0;
+  for (int i=7; i>=0; --i) {
+    const int p=pr.predict0()*2+1;  // of a 1 out of 64K
+    assert(p>0 && p<65536);
+    const int y=c>>i&1;
+    bits-=log2((y ? p : 65536-p)/65536.0);
+    pr.update0(y);
+  }
+  if (undo->depth==1 && undo->changes.size()>MAX_FRESH_CHANGES) {
+    undo->changes.clear();
+    fresh=false;
+  }
+  return bits;
+}
+
+// Save the state. Arrays of the model are saved by logging their changes,
+// the rest is copied.
+void Model::push() {
+  if (undo->depth==int(undo->states.size()))
+    undo->states.push_back(UndoLog::State());
+  UndoLog::State& s=undo->states[undo->depth++];
+  const int n=z.header[6];
+  s.changes=undo->changes.size();
+  s.c8=pr.c8;
+  s.hmap4=pr.hmap4;
+  s.p.assign(pr.p, pr.p+n);
+  s.h.assign(pr.h, pr.h+n);
+  s.comp.resize(n*5);
+  for (int i=0; i<n; ++i) {
+    const Component& cr=pr.comp[i];
+    s.comp[i*5]=cr.limit;
+    s.comp[i*5+1]=cr.cxt;
+    s.comp[i*5+2]=cr.a;
+    s.comp[i*5+3]=cr.b;
+    s.comp[i*5+4]=cr.c;
+  }
+  s.a=z.a, s.b=z.b, s.c=z.c, s.d=z.d, s.f=z.f, s.pc=z.pc;
+  s.m.assign(&z.m[0], &z.m[0]+z.m.size());
+  s.zh.assign(&z.h[0], &z.h[0]+z.h.size());
+  s.r.assign(&z.r[0], &z.r[0]+z.r.size());
+}
+
+// Restore the last saved state and discard it
+void Model::pop() {
+  assert(undo->depth>0);
+  const UndoLog::State& s=undo->states[--undo->depth];
+  const int n=z.header[6];
+  undo->undo(s.changes);
+  pr.c8=s.c8;
+  pr.hmap4=s.hmap4;
+  std::copy(s.p.begin(), s.p.end(), pr.p);
+  std::copy(s.h.begin(), s.h.end(), pr.h);
+  for (int i=0; i<n; ++i) {
+    Component& cr=pr.comp[i];
+    cr.limit=s.comp[i*5];
+    cr.cxt=s.comp[i*5+1];
+    cr.a=s.comp[i*5+2];
+    cr.b=s.comp[i*5+3];
+    cr.c=s.comp[i*5+4];
+  }
+  z.a=s.a, z.b=s.b, z.c=s.c, z.d=s.d, z.f=s.f, z.pc=s.pc;
+  std::copy(s.m.begin(), s.m.end(), &z.m[0]);
+  std::copy(s.zh.begin(), s.zh.end(), &z.h[0]);
+  std::copy(s.r.begin(), s.r.end(), &z.r[0]);
+}
+
+// Number of states saved by push() and not restored
+int Model::depth() const {
+  return undo->depth-1;
+}
+
+// Size in bytes of compressBlock() output for n bytes costing bits in
+// total. The arithmetic code is not rounded to bytes.
+double Model::size(int64_t n, double bits) const {
+  int digits=1;  // of the size in the segment comment
+  for (int64_t x=n; x>=10; x/=10) ++digits;
+  return 13+5+z.cend+z.hend-z.hbegin  // tag, block header, COMP, HCOMP
+      +4+digits                         // segment header
+      +(bits0+bits)/8+4                 // arithmetic code and its flush
+      +4+21+1;                          // end of segment, SHA-1, end of block
+}
+
 }  // end namespace libzpaq
@@ -350,6 +350,39 @@ swap() swaps 2 StringBuffers efficiently, but does not change their
 initial allocations.
 
 
+MODEL
+
+A Model computes how well compressBlock() would compress data without
+coding it. It is not a part of the ZPAQ standard.
+
+  class Model {
+  public:
+    bool init(const char* method, const char* data, size_t n);
+    double code(int c);           // model byte c, return its cost in bits
+    void push();                  // save the state of the model
+    void pop();                   // restore the last saved state
+    int depth() const;            // number of saved states
+    double size(int64_t n, double bits) const;
+  };
+
+init() builds the model that compressBlock() selects to compress
+data[0..n-1] with method and returns true. If the same model was
+already built, then it is reset to its initial state instead, which is
+faster, and init() returns false. Methods with preprocessing (LZ77,
+BWT, E8E9) are not supported.
+
+code() returns -log2 of the probability of byte c, which is the
+number of bits the arithmetic coder would spend on it.
+
+push() and pop() save and restore the state of the model. A saved
+state is not a copy of the model, which may take hundreds of MB.
+Instead, the changes made after push() are logged and pop() undoes them.
+
+size() returns the size in bytes of the block compressBlock() would
+write for n bytes costing bits bits in total, counting the headers and
+the checksum. The arithmetic code is not rounded to whole bytes.
+
+
 DECOMPRESSER
 
 decompress() will decompress any valid ZPAQ stream, which may contain
@@ -910,6 +943,10 @@ void Array<T>::resize(size_t sz, int ex) {
     if (sz>sz*2) error("Array too big");
     sz*=2, --ex;
   }
+  if (n>0 && n==sz) {  // same size: reuse memory
+    memset(data, 0, n*sizeof(T));
+    return;
+  }
   if (n>0) {
     assert(offset>0 && offset<=64);
     assert((char*)data-offset);
@@ -1072,6 +1109,7 @@ private:
   void swap(U32& x) {a^=x; x^=a; a^=x;}
   void swap(U8& x)  {a^=x; x^=a; a^=x;}
   void err();  // exit with run time error
+  friend class Model;
 };
 
 ///////////////////////// Component //////////////////////////
@@ -1112,12 +1150,14 @@ public:
 
 ///////////////////////// Predictor //////////////////////////
 
+class UndoLog;
+
 // A predictor guesses the next bit
 class Predictor {
 public:
   Predictor(ZPAQL&);
   ~Predictor();
-  void init();          // build model
+  void init(bool reuse=false);  // build model, reuse memory of the last one
   int predict();        // probability that next bit is a 1 (0..4095)
   void update(int y);   // train on bit y (0..1)
   int stat(int);        // Defined externally
@@ -1146,6 +1186,9 @@ private:
   StateTable st;        // next, cminit functions
   U8* pcode;            // JIT code for predict() and update()
   int pcode_size;       // length of pcode
+  UndoLog* undo;        // if not 0 then save values before changing them
+  template <typename T> void save(T& x);  // save x in undo
+  friend class Model;
 
   // reduce prediction error in cr.cm
   void train(Component& cr, int y) {
@@ -1493,6 +1536,33 @@ public:
   }
 };
 
+//////////////////////////// Model ///////////////////////////
+
+// For computing the compressed size of data without coding it. The
+// state can be saved and restored by logging the changes of the model.
+class Model {
+public:
+  Model();
+  ~Model();
+  bool init(const char* method, const char* data, size_t n);
+  double code(int c);   // model byte c, return -log2 of its probability
+  void push();          // save the state
+  void pop();           // restore the last saved state
+  int depth() const;    // number of saved states
+  double size(int64_t n, double bits) const;  // block size in bytes
+private:
+  ZPAQL z;              // computes contexts
+  Predictor pr;         // the model
+  UndoLog* undo;        // changes since the saved states
+  bool fresh;           // can state 0 of undo be restored?
+  double bits0;         // cost of the initial state
+  void reset();         // go to the initial state
+
+  // No assignment or copy
+  void operator=(const Model&);
+  Model(const Model&);
+};
+
 /////////////////////////// compress() ///////////////////////
 
 // Compress in to out in multiple blocks. Default method is "14,128,0"
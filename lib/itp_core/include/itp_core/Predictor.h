@@ -5,12 +5,21 @@
 #include "INonCompressionAlgorithm.h"
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 namespace itp
 {
 
-class CompressorsFacade;
+class CompressorsLeasingPool;
 
+/**
+ * Forecasts series by compression. The methods can be called concurrently: each forecasting leases its own facade of
+ * compressors from a pool and takes the settings, which are current at its start. The algorithms registered with
+ * RegisterNonCompressionAlgorithm are shared, each call to them is given the alphabet of its own series.
+ */
 class InformationTheoreticPredictor
 {
 public:
@@ -53,12 +62,117 @@ public:
 		size_t difference,
 		int sparse);
 
+	/**
+	 * Forecasts each series of the batch like ForecastReal. The series are spread among the threads set by
+	 * SetThreadsCount, each thread forecasts its series sequentially and keeps its compressors and forecasting
+	 * algorithm for all of them.
+	 *
+	 * \return Forecasts of the series in the order of the batch.
+	 */
+	std::vector<std::map<std::string, std::vector<itp::Double>>> ForecastRealBatch(
+		const std::vector<std::vector<itp::Double>>& batch,
+		const itp::ConcatenatedCompressorNamesVec& concatenated_compressor_groups,
+		size_t horizon,
+		size_t difference,
+		size_t quanta_count,
+		int sparse);
+
+	/**
+	 * Forecasts each series of the batch like ForecastMultialphabet (see ForecastRealBatch for the threads).
+	 */
+	std::vector<std::map<std::string, std::vector<itp::Double>>> ForecastMultialphabetBatch(
+		const std::vector<std::vector<double>>& batch,
+		const itp::ConcatenatedCompressorNamesVec& concatenated_compressor_groups,
+		size_t horizon,
+		size_t difference,
+		size_t max_quanta_count,
+		int sparse);
+
+	/**
+	 * Forecasts each series of the batch like ForecastDiscrete (see ForecastRealBatch for the threads).
+	 */
+	std::vector<std::map<std::string, std::vector<itp::Double>>> ForecastDiscreteBatch(
+		const std::vector<std::vector<itp::Symbol>>& batch,
+		const ConcatenatedCompressorNamesVec& concatenated_compressor_groups,
+		size_t horizon,
+		size_t difference,
+		int sparse);
+
 	void RegisterNonCompressionAlgorithm(
 		const std::string& name,
 		itp::INonCompressionAlgorithm* non_compression_algorithm);
 
+	/**
+	 * Sets the number of threads used to compress possible continuations of a series. Algorithms registered with
+	 * RegisterNonCompressionAlgorithm are not duplicated among threads, calls to them are serialized.
+	 *
+	 * \param[in] threads_count Number of threads, values 0 and 1 mean the sequential computation.
+	 */
+	void SetThreadsCount(size_t threads_count);
+
+	/**
+	 * Sets the numeric type used for code lengths and probabilities of continuations.
+	 *
+	 * \param[in] numeric_backend The backend to use.
+	 */
+	void SetNumericBackend(NumericBackend numeric_backend);
+
+	/**
+	 * Enables the branch-and-bound evaluation of continuations: a prefix of continuations, which code length exceeds
+	 * the minimal one by more than the slack, is not expanded and its continuations are discarded. It is used only by
+	 * the compressors, which can save their state and which code lengths don't decrease when data is appended:
+	 * automaton, kt, ctw and the ones registered with RegisterNonCompressionAlgorithm.
+	 *
+	 * \param[in] slack_in_bits The slack or std::nullopt to evaluate all the continuations.
+	 */
+	void SetPruningSlack(std::optional<size_t> slack_in_bits);
+
+	/**
+	 * \return Upper bound of the share of probability discarded by pruning during the last forecasting finished by the
+	 * calling thread, so the concurrent forecastings of other threads don't overwrite it.
+	 */
+	Double GetDiscardedProbabilityBound() const;
+
+	/**
+	 * Switches to the Monte Carlo estimation of forecasts: instead of enumerating all A^h continuations, samples_count
+	 * continuations are drawn for each compressor, so the running time is linear in the number of samples rather than
+	 * exponential in the horizon. The multialphabet forecasting doesn't support the estimation.
+	 *
+	 * \param[in] samples_count Number of continuations to draw or std::nullopt to enumerate all the continuations.
+	 * \param[in] seed Seed of the pseudorandom generator, forecasts with the same seed are equal.
+	 */
+	void SetMonteCarloSampling(std::optional<size_t> samples_count, size_t seed = 0);
+
 private:
-	std::shared_ptr<CompressorsFacade> compressors_;
+	/**
+	 * Passes the current settings to the forecasting algorithm.
+	 */
+	template<typename ForecastingAlgorithm>
+	void Configure(ForecastingAlgorithm& forecasting_algorithm) const;
+
+	/**
+	 * Remembers the bound for the calling thread, see GetDiscardedProbabilityBound().
+	 */
+	void SetDiscardedProbabilityBound(Double bound);
+
+	/**
+	 * Forecasts the series of the batch in the threads set by SetThreadsCount.
+	 *
+	 * \param[in] batch The series.
+	 * \param[in] make_algorithm Creates a configured forecasting algorithm, it is called once per thread.
+	 * \param[in] forecast Forecasts a series by the algorithm of the thread.
+	 */
+	template<typename Series, typename MakeAlgorithm, typename Forecast>
+	auto ForecastBatch(const std::vector<Series>& batch, MakeAlgorithm make_algorithm, Forecast forecast);
+
+	std::shared_ptr<CompressorsLeasingPool> compressors_;
+	mutable std::mutex mutex_; // Guards the settings and the discarded probability bounds.
+	size_t threads_count_ = 1;
+	NumericBackend numeric_backend_;
+	std::optional<size_t> pruning_slack_ = std::nullopt;
+	std::map<std::thread::id, Double> discarded_probability_bounds_;
+	std::optional<size_t> monte_carlo_samples_count_ = std::nullopt;
+	size_t monte_carlo_seed_ = 0;
 };
 
 } // namespace itp
@@ -2,25 +2,34 @@
 
 #include "ItpExceptions.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itp
 {
 
 AutomatonWord::AutomatonWord(const PlainTimeSeries<Symbol>& time_series)
-	: time_series_(begin(time_series), end(time_series))
+	: prefix_{std::make_shared<const PlainTimeSeries<Symbol>>(time_series)}
+	, prefix_size_{static_cast<ssize_t>(time_series.size())}
 {
 	// DO NOTHING
 }
 
+void AutomatonWord::Append(const Symbol* data, size_t size)
+{
+	suffix_.insert(end(suffix_), data, data + size);
+}
+
 ssize_t AutomatonWord::size() const
 {
-	return time_series_.size();
+	return prefix_size_ + suffix_.size();
 }
 
-const AutomatonWord::Ext_symbol_t& AutomatonWord::operator[](ssize_t n) const
+AutomatonWord::Ext_symbol_t AutomatonWord::operator[](ssize_t n) const
 {
 	if (0 <= n)
 	{
-		return time_series_[n];
+		return (n < prefix_size_) ? (*prefix_)[n] : suffix_[n - prefix_size_];
 	}
 
 	if (n != -1)
@@ -42,9 +51,24 @@ void PredictionAutomaton::SetMaxSymbol(Symbol)
 	// DO NOTHING
 }
 
-HighPrecDouble KrichevskyPredictor(Symbol sym, size_t sym_freq, size_t total_freq, size_t alphabet_size)
+AutomatonProbability KrichevskyPredictor::operator()(size_t sym_freq, size_t total_freq, size_t alphabet_size)
+{
+	return AutomatonProbability::FromLog2(Log2(2 * sym_freq + 1) - Log2(2 * total_freq + alphabet_size));
+}
+
+long double KrichevskyPredictor::Log2(size_t n)
 {
-	return (HighPrecDouble(sym_freq) + 1. / 2) / (HighPrecDouble(total_freq) + alphabet_size / 2.);
+	if (log2_.size() <= n)
+	{
+		auto new_size = std::max(n + 1, 2 * log2_.size());
+		log2_.reserve(new_size);
+		while (log2_.size() < new_size)
+		{
+			log2_.push_back(std::log2(static_cast<long double>(log2_.size())));
+		}
+	}
+
+	return log2_[n];
 }
 
 } // namespace itp
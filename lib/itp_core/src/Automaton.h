@@ -17,23 +17,48 @@
 #include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace itp
 {
 
+/**
+ * Probabilities of words are very small, so they are accumulated as sums of logarithms. The extended precision keeps
+ * the accumulated error far below the precision of double for words of any practical length.
+ */
+using AutomatonProbability = bignums::LogNumber<long double>;
+
 /**
  * Evaluates the probability of the given symbol of a word.
  * For more details, see
  * Krichevsky R. (1968) A relation between the plausibility of information about a source and encoding redundancy.
  *   Problems Inform. Transmission. Vol. 4 pp. 48-57.
  *
- * \param[in] sym the symbol which probability is needed to evaluate;
- * \param[in] sym_freq how many times sym was encountered in the word;
- * \param[in] total_freq is the position of sym in the word;
- * \param[in] alphabet_size is the number of all possible symbols which may be found in the word.
+ * The estimate (f + 1/2) / (t + A/2) equals (2f + 1) / (2t + A), so its logarithm is a difference of two values from
+ * the table of logarithms of integers. The table is extended on demand and may be shared by several automata.
  */
-HighPrecDouble KrichevskyPredictor(Symbol sym, size_t sym_freq, size_t total_freq, size_t alphabet_size);
+class KrichevskyPredictor
+{
+public:
+	/**
+	 * \param[in] sym_freq how many times the symbol was encountered in the word;
+	 * \param[in] total_freq is the position of the symbol in the word;
+	 * \param[in] alphabet_size is the number of all possible symbols which may be found in the word.
+	 *
+	 * \return The estimated probability of the symbol.
+	 */
+	AutomatonProbability operator()(size_t sym_freq, size_t total_freq, size_t alphabet_size);
 
+private:
+	long double Log2(size_t n);
+
+	std::vector<long double> log2_;
+};
+
+/**
+ * The word, which is read by an automaton. Copies of the word share the symbols it was constructed from, the appended
+ * symbols are owned by each copy.
+ */
 class AutomatonWord
 {
 public:
@@ -45,14 +70,18 @@ public:
 	// Intentionally made implicit.
 	AutomatonWord(const PlainTimeSeries<Symbol>& time_series);
 
+	void Append(const Symbol* data, size_t size);
+
 	ssize_t size() const;
 
 	// -1 is allowed! All other negative indexes are prohibited.
 	// Made in such a way to be close to the paper.
-	const Ext_symbol_t& operator[](ssize_t n) const;
+	Ext_symbol_t operator[](ssize_t n) const;
 
 private:
-	PlainTimeSeries<Ext_symbol_t> time_series_;
+	std::shared_ptr<const PlainTimeSeries<Symbol>> prefix_;
+	PlainTimeSeries<Symbol> suffix_;
+	ssize_t prefix_size_ = 0;
 };
 
 /**
@@ -68,7 +97,25 @@ public:
 	 *
 	 * \return Evaluated probability of the word.
 	 */
-	virtual HighPrecDouble EvalProbability(const PlainTimeSeries<Symbol>& w) = 0;
+	virtual AutomatonProbability EvalProbability(const PlainTimeSeries<Symbol>& w) = 0;
+
+	/**
+	 * Appends symbols to the last evaluated word and estimates probability of the extended word. The automaton is
+	 * suspended at the end of the word, so only the appended symbols are processed.
+	 *
+	 * \param[in] data Symbols to append.
+	 * \param[in] size Count of the symbols.
+	 *
+	 * \return Evaluated probability of the extended word.
+	 */
+	virtual AutomatonProbability EvalProbabilityOfExtended(const Symbol* data, size_t size) = 0;
+
+	/**
+	 * Copies the automaton together with the state of the evaluation, so the copy and the original can extend the
+	 * word independently.
+	 */
+	virtual std::unique_ptr<PredictionAutomaton> Clone() const = 0;
+
 	virtual ~PredictionAutomaton() = default;
 
 	/**
@@ -103,7 +150,8 @@ public:
 
 	MultiheadAutomaton(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol);
 
-	HighPrecDouble EvalProbability(const PlainTimeSeries<Symbol>& w) override final;
+	AutomatonProbability EvalProbability(const PlainTimeSeries<Symbol>& w) override final;
+	AutomatonProbability EvalProbabilityOfExtended(const Symbol* data, size_t size) override final;
 
 	/**
 	 * Assuming that heads of an automaton are (somehow) numbered, allows
@@ -163,7 +211,8 @@ protected:
 	virtual void Init();
 
 	/**
-	 * Run main prediction procedure.
+	 * Run main prediction procedure. When a head reaches the end of the word, the procedure is suspended, and the
+	 * next call resumes it from the same point.
 	 *
 	 */
 	virtual void Run() = 0;
@@ -184,8 +233,9 @@ private:
 	Symbol alphabet_min_symbol_;
 	Symbol alphabet_max_symbol_;
 
-	HighPrecDouble evaluated_probability_;
+	AutomatonProbability evaluated_probability_;
 	size_t confident_estimations_series_len_;
+	std::shared_ptr<KrichevskyPredictor> predictor_ = std::make_shared<KrichevskyPredictor>();
 
 	std::vector<size_t> letters_freq_;
 	std::vector<size_t> confident_guess_freq_;
@@ -209,7 +259,7 @@ itp::MultiheadAutomaton<N>::MultiheadAutomaton(Symbol alphabet_min_symbol, Symbo
 }
 
 template<size_t N>
-itp::HighPrecDouble itp::MultiheadAutomaton<N>::EvalProbability(const PlainTimeSeries<Symbol>& w)
+itp::AutomatonProbability itp::MultiheadAutomaton<N>::EvalProbability(const PlainTimeSeries<Symbol>& w)
 {
 	a = w;
 
@@ -219,6 +269,15 @@ itp::HighPrecDouble itp::MultiheadAutomaton<N>::EvalProbability(const PlainTimeS
 	return evaluated_probability_;
 }
 
+template<size_t N>
+itp::AutomatonProbability itp::MultiheadAutomaton<N>::EvalProbabilityOfExtended(const Symbol* data, size_t size)
+{
+	a.Append(data, size);
+	Run();
+
+	return evaluated_probability_;
+}
+
 template<size_t N>
 const itp::Head& itp::MultiheadAutomaton<N>::h(size_t head_num) const
 {
@@ -236,7 +295,6 @@ template<size_t N>
 void itp::MultiheadAutomaton<N>::Guess(Symbol guessed_symbol, IsPredictionConfident confidence)
 {
 	size_t total_freq;
-	HighPrecDouble sym_probability;
 	if (h(num_of_rightmost_head_) < a.size() - 1)
 	{
 		OnGuess(guessed_symbol);
@@ -247,24 +305,17 @@ void itp::MultiheadAutomaton<N>::Guess(Symbol guessed_symbol, IsPredictionConfid
 			++confident_estimations_series_len_;
 			total_freq = confident_estimations_series_len_;
 			confident_guess_freq_[guessed_symbol] = confident_estimations_series_len_;
-			sym_probability = KrichevskyPredictor(
-				observed_symbol,
+			evaluated_probability_ *= (*predictor_)(
 				confident_guess_freq_[observed_symbol],
 				total_freq,
 				GetAlphabetRange());
-			evaluated_probability_ *= sym_probability;
 			confident_guess_freq_[guessed_symbol] = 0;
 			break;
 		case IsPredictionConfident::No:
 			confident_estimations_series_len_ = 0;
 			auto position_in_word = h(num_of_rightmost_head_);
 			total_freq = position_in_word + 1;
-			sym_probability = KrichevskyPredictor(
-				observed_symbol,
-				letters_freq_[observed_symbol],
-				total_freq,
-				GetAlphabetRange());
-			evaluated_probability_ *= sym_probability;
+			evaluated_probability_ *= (*predictor_)(letters_freq_[observed_symbol], total_freq, GetAlphabetRange());
 		}
 	}
 }
@@ -12,9 +12,15 @@
 
 #include "../include/itp_core/INonCompressionAlgorithm.h"
 #include "CompressionPrediction.h"
+#include "MarginalPrediction.h"
+#include "MonteCarloPrediction.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 
 template<typename OutType, typename InType>
 class ForecastingAlgorithm
@@ -22,7 +28,10 @@ class ForecastingAlgorithm
 	// static_assert(std::is_arithmetic<T>::value, "T should be an arithmetic type");
 
 public:
-	explicit ForecastingAlgorithm(itp::CompressorsFacadePtr compressors);
+	/**
+	 * \param[in] compressors The pool, which the compressors of each thread are leased from for a forecasting.
+	 */
+	explicit ForecastingAlgorithm(std::shared_ptr<itp::CompressorsLeasingPool> compressors);
 
 	std::map<std::string, std::vector<OutType>> operator()(
 		const std::vector<InType>& time_series,
@@ -31,20 +40,95 @@ public:
 		size_t difference,
 		int sparse);
 
+	/**
+	 * Sets the number of threads to compress continuations with.
+	 *
+	 * \param[in] threads_count Number of threads, values 0 and 1 mean the sequential computation.
+	 */
+	void SetThreadsCount(size_t threads_count);
+
+	/**
+	 * Sets the numeric type used for code lengths and probabilities of continuations.
+	 *
+	 * \param[in] numeric_backend The backend to use.
+	 */
+	void SetNumericBackend(itp::NumericBackend numeric_backend);
+
+	/**
+	 * Enables the branch-and-bound evaluation of continuations (see CodeLengthsComputer::SetPruningSlack).
+	 *
+	 * \param[in] slack_in_bits The slack or std::nullopt to evaluate all the continuations.
+	 */
+	void SetPruningSlack(std::optional<size_t> slack_in_bits);
+
+	/**
+	 * \return Upper bound of the share of probability discarded by pruning during the last forecasting.
+	 */
+	itp::Double GetDiscardedProbabilityBound() const;
+
+	/**
+	 * Switches to the Monte Carlo estimation of forecasts: instead of enumerating all the continuations, a fixed number
+	 * of them is drawn for each compressor (see MonteCarloPredictor).
+	 *
+	 * \param[in] samples_count Number of continuations to draw or std::nullopt to enumerate all the continuations.
+	 * \param[in] seed Seed of the pseudorandom generator.
+	 */
+	void SetMonteCarloSampling(std::optional<size_t> samples_count, size_t seed);
+
 protected:
 	/**
 	 * Factory method.
 	 */
 	virtual itp::PointwisePredictorPtr<OutType, InType> MakePredictor(
-		itp::CodeLengthsComputerPtr<OutType> computer,
+		itp::CodeLengthsComputerPtr<OutType, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<InType> sampler,
 		size_t difference) const = 0;
 
-	itp::CompressorsFacadePtr compressors_;
+	/**
+	 * Factory method for the log-domain numeric backend.
+	 */
+	virtual itp::PointwisePredictorPtr<OutType, InType> MakePredictor(
+		itp::CodeLengthsComputerPtr<OutType, bignums::LogDouble> computer,
+		itp::SamplerPtr<InType> sampler,
+		size_t difference) const = 0;
+
+	/**
+	 * Factory method for the Monte Carlo estimation. The importance weights are kept as logarithms, so the numeric
+	 * backend doesn't matter. Throws std::invalid_argument if the algorithm doesn't support the estimation.
+	 */
+	virtual itp::PointwisePredictorPtr<OutType, InType> MakeMonteCarloPredictor(
+		itp::CodeLengthsComputerPtr<OutType, itp::HighPrecDouble> computer,
+		itp::SamplerPtr<InType> sampler,
+		size_t difference) const;
+
+	std::shared_ptr<itp::CompressorsLeasingPool> compressors_;
+	size_t threads_count_ = 1;
+	itp::NumericBackend numeric_backend_ = itp::kDefaultNumericBackend;
+	std::optional<size_t> pruning_slack_ = std::nullopt;
+	std::optional<size_t> monte_carlo_samples_count_ = std::nullopt;
+	size_t monte_carlo_seed_ = 0;
+
+private:
+	/**
+	 * Creates the predictor, which uses the compressors of the threads and does not share a state with the other
+	 * created ones.
+	 */
+	itp::PointwisePredictorPtr<OutType, InType> MakePointwisePredictor(
+		std::vector<itp::CompressorsFacadePtr> workers_compressors,
+		size_t difference);
+
+	/**
+	 * Creates the computer and remembers it to report the discarded probability after the forecasting.
+	 */
+	template<typename Real>
+	itp::CodeLengthsComputerPtr<OutType, Real> MakeComputer(std::vector<itp::CompressorsFacadePtr> workers_compressors);
+
+	std::vector<std::function<itp::Double()>> discarded_probability_bounds_;
+	itp::Double discarded_probability_bound_ = 0.;
 };
 
 template<typename OutType, typename InType>
-ForecastingAlgorithm<OutType, InType>::ForecastingAlgorithm(itp::CompressorsFacadePtr compressors)
+ForecastingAlgorithm<OutType, InType>::ForecastingAlgorithm(std::shared_ptr<itp::CompressorsLeasingPool> compressors)
 	: compressors_{std::move(compressors)}
 {
 	// DO NOTHING
@@ -58,19 +142,49 @@ std::map<std::string, std::vector<OutType>> ForecastingAlgorithm<OutType, InType
 	size_t difference,
 	int sparse)
 {
-	auto computer = std::make_shared<itp::CodeLengthsComputer<OutType>>(compressors_);
-	auto sampler = std::make_shared<itp::Sampler<InType>>();
 	const auto compressor_groups = itp::SplitConcatenatedNames(concatenated_compressor_groups);
-	itp::PointwisePredictorPtr<OutType, InType> pointwise_predictor = MakePredictor(computer, sampler, difference);
+	discarded_probability_bounds_.clear();
+	itp::PointwisePredictorPtr<OutType, InType> pointwise_predictor;
 	if (sparse > 0)
 	{
-		pointwise_predictor = std::make_shared<itp::SparsePredictor<OutType, InType>>(pointwise_predictor, sparse);
+		// The passes of the sparse forecasting are independent, so the threads are shared among them first. The
+		// compressors, which cannot be cloned, are shared by the workers, but each pool gives them the alphabet of its
+		// own sub-series (see CompressorsPool).
+		const size_t passes_count = itp::SparsePredictor<OutType, InType>::CountPasses(sparse, horizon);
+		const size_t workers_count = std::clamp<size_t>(threads_count_, 1, passes_count);
+		const size_t threads_per_worker = std::max<size_t>(threads_count_ / workers_count, 1);
+		auto leased_compressors = compressors_->Lease(workers_count * threads_per_worker);
+		std::vector<itp::PointwisePredictorPtr<OutType, InType>> pointwise_predictors;
+		for (size_t i = 0; i < workers_count; ++i)
+		{
+			const auto first = std::begin(leased_compressors) + i * threads_per_worker;
+			pointwise_predictors.push_back(MakePointwisePredictor({first, first + threads_per_worker}, difference));
+		}
+		pointwise_predictor = std::make_shared<itp::SparsePredictor<OutType, InType>>(
+			std::move(pointwise_predictors),
+			sparse);
+	}
+	else
+	{
+		pointwise_predictor = MakePointwisePredictor(
+			compressors_->Lease(std::max<size_t>(threads_count_, 1)),
+			difference);
 	}
 
 	itp::Forecast<OutType> res = pointwise_predictor->Predict(
 		itp::InitPreprocessedTs(time_series),
 		horizon,
 		compressor_groups);
+
+	// The computers keep the leased compressors, so they are dropped to return the compressors to the pool.
+	discarded_probability_bound_ = 0.;
+	for (const auto& discarded_probability_bound : discarded_probability_bounds_)
+	{
+		discarded_probability_bound_ = std::max(discarded_probability_bound_, discarded_probability_bound());
+	}
+	discarded_probability_bounds_.clear();
+	pointwise_predictor.reset();
+
 	std::map<std::string, std::vector<OutType>> ret;
 	for (const auto& compressor : res.GetIndex())
 	{
@@ -84,6 +198,77 @@ std::map<std::string, std::vector<OutType>> ForecastingAlgorithm<OutType, InType
 	return ret;
 }
 
+template<typename OutType, typename InType>
+void ForecastingAlgorithm<OutType, InType>::SetThreadsCount(size_t threads_count)
+{
+	threads_count_ = threads_count;
+}
+
+template<typename OutType, typename InType>
+void ForecastingAlgorithm<OutType, InType>::SetNumericBackend(itp::NumericBackend numeric_backend)
+{
+	numeric_backend_ = numeric_backend;
+}
+
+template<typename OutType, typename InType>
+void ForecastingAlgorithm<OutType, InType>::SetPruningSlack(std::optional<size_t> slack_in_bits)
+{
+	pruning_slack_ = slack_in_bits;
+}
+
+template<typename OutType, typename InType>
+itp::Double ForecastingAlgorithm<OutType, InType>::GetDiscardedProbabilityBound() const
+{
+	return discarded_probability_bound_;
+}
+
+template<typename OutType, typename InType>
+void ForecastingAlgorithm<OutType, InType>::SetMonteCarloSampling(std::optional<size_t> samples_count, size_t seed)
+{
+	monte_carlo_samples_count_ = samples_count;
+	monte_carlo_seed_ = seed;
+}
+
+template<typename OutType, typename InType>
+itp::PointwisePredictorPtr<OutType, InType> ForecastingAlgorithm<OutType, InType>::MakeMonteCarloPredictor(
+	itp::CodeLengthsComputerPtr<OutType, itp::HighPrecDouble>,
+	itp::SamplerPtr<InType>,
+	size_t) const
+{
+	throw std::invalid_argument("Monte Carlo estimation is not supported by the forecasting algorithm");
+}
+
+template<typename OutType, typename InType>
+itp::PointwisePredictorPtr<OutType, InType> ForecastingAlgorithm<OutType, InType>::MakePointwisePredictor(
+	std::vector<itp::CompressorsFacadePtr> workers_compressors,
+	size_t difference)
+{
+	auto sampler = std::make_shared<itp::Sampler<InType>>();
+	if (monte_carlo_samples_count_)
+	{
+		return MakeMonteCarloPredictor(
+			MakeComputer<itp::HighPrecDouble>(std::move(workers_compressors)),
+			sampler,
+			difference);
+	}
+
+	return numeric_backend_ == itp::NumericBackend::LogDomain
+		? MakePredictor(MakeComputer<bignums::LogDouble>(std::move(workers_compressors)), sampler, difference)
+		: MakePredictor(MakeComputer<itp::HighPrecDouble>(std::move(workers_compressors)), sampler, difference);
+}
+
+template<typename OutType, typename InType>
+template<typename Real>
+itp::CodeLengthsComputerPtr<OutType, Real> ForecastingAlgorithm<OutType, InType>::MakeComputer(
+	std::vector<itp::CompressorsFacadePtr> workers_compressors)
+{
+	auto computer = std::make_shared<itp::CodeLengthsComputer<OutType, Real>>(std::move(workers_compressors));
+	computer->SetPruningSlack(pruning_slack_);
+	discarded_probability_bounds_.push_back([computer] { return computer->GetDiscardedProbabilityBound(); });
+
+	return computer;
+}
+
 /**
  * Forecast originally discrete time series.
  */
@@ -95,9 +280,32 @@ public:
 
 protected:
 	itp::PointwisePredictorPtr<DoubleT, SymbolT> MakePredictor(
-		itp::CodeLengthsComputerPtr<DoubleT> computer,
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
+		itp::SamplerPtr<SymbolT> sampler,
+		size_t difference) const override
+	{
+		return MakePredictorFor(computer, sampler, difference);
+	}
+
+	itp::PointwisePredictorPtr<DoubleT, SymbolT> MakePredictor(
+		itp::CodeLengthsComputerPtr<DoubleT, bignums::LogDouble> computer,
+		itp::SamplerPtr<SymbolT> sampler,
+		size_t difference) const override
+	{
+		return MakePredictorFor(computer, sampler, difference);
+	}
+
+	itp::PointwisePredictorPtr<DoubleT, SymbolT> MakeMonteCarloPredictor(
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<SymbolT> sampler,
 		size_t difference) const override;
+
+private:
+	template<typename Real>
+	itp::PointwisePredictorPtr<DoubleT, SymbolT> MakePredictorFor(
+		itp::CodeLengthsComputerPtr<DoubleT, Real> computer,
+		itp::SamplerPtr<SymbolT> sampler,
+		size_t difference) const;
 };
 
 template<typename DoubleT, typename SymbolT>
@@ -108,7 +316,7 @@ public:
 
 protected:
 	itp::PointwisePredictorPtr<DoubleT, SymbolT> MakePredictor(
-		itp::CodeLengthsComputerPtr<DoubleT> computer,
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<SymbolT> sampler,
 		size_t difference) const override;
 };
@@ -128,12 +336,35 @@ public:
 
 protected:
 	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictor(
-		itp::CodeLengthsComputerPtr<DoubleT> computer,
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
+		itp::SamplerPtr<DoubleT> sampler,
+		size_t difference) const override
+	{
+		return MakePredictorFor(computer, sampler, difference);
+	}
+
+	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictor(
+		itp::CodeLengthsComputerPtr<DoubleT, bignums::LogDouble> computer,
+		itp::SamplerPtr<DoubleT> sampler,
+		size_t difference) const override
+	{
+		return MakePredictorFor(computer, sampler, difference);
+	}
+
+	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakeMonteCarloPredictor(
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<DoubleT> sampler,
 		size_t difference) const override;
 
 protected:
 	size_t quanta_count_;
+
+private:
+	template<typename Real>
+	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictorFor(
+		itp::CodeLengthsComputerPtr<DoubleT, Real> computer,
+		itp::SamplerPtr<DoubleT> sampler,
+		size_t difference) const;
 };
 
 template<typename DoubleT>
@@ -144,7 +375,7 @@ public:
 
 protected:
 	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictor(
-		itp::CodeLengthsComputerPtr<DoubleT> computer,
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<DoubleT> sampler,
 		size_t difference) const override;
 };
@@ -157,9 +388,38 @@ public:
 
 protected:
 	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictor(
-		itp::CodeLengthsComputerPtr<DoubleT> computer,
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<DoubleT> sampler,
-		size_t difference) const override;
+		size_t difference) const override
+	{
+		return MakePredictorFor(computer, sampler, difference);
+	}
+
+	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictor(
+		itp::CodeLengthsComputerPtr<DoubleT, bignums::LogDouble> computer,
+		itp::SamplerPtr<DoubleT> sampler,
+		size_t difference) const override
+	{
+		return MakePredictorFor(computer, sampler, difference);
+	}
+
+	/**
+	 * Merging of distributions over different alphabets is not implemented for samples.
+	 */
+	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakeMonteCarloPredictor(
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
+		itp::SamplerPtr<DoubleT> sampler,
+		size_t difference) const override
+	{
+		return ForecastingAlgorithm<DoubleT, DoubleT>::MakeMonteCarloPredictor(computer, sampler, difference);
+	}
+
+private:
+	template<typename Real>
+	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictorFor(
+		itp::CodeLengthsComputerPtr<DoubleT, Real> computer,
+		itp::SamplerPtr<DoubleT> sampler,
+		size_t difference) const;
 };
 
 template<typename DoubleT>
@@ -170,22 +430,34 @@ public:
 
 protected:
 	itp::PointwisePredictorPtr<DoubleT, DoubleT> MakePredictor(
-		itp::CodeLengthsComputerPtr<DoubleT> computer,
+		itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
 		itp::SamplerPtr<DoubleT> sampler,
 		size_t difference) const override;
 };
 
 template<typename DoubleT, typename SymbolT>
-itp::PointwisePredictorPtr<DoubleT, SymbolT> ForecastingAlgorithmDiscrete<DoubleT, SymbolT>::MakePredictor(
-	itp::CodeLengthsComputerPtr<DoubleT> computer,
+template<typename Real>
+itp::PointwisePredictorPtr<DoubleT, SymbolT> ForecastingAlgorithmDiscrete<DoubleT, SymbolT>::MakePredictorFor(
+	itp::CodeLengthsComputerPtr<DoubleT, Real> computer,
 	itp::SamplerPtr<SymbolT> sampler,
-	size_t difference) const
+	size_t) const
+{
+	// The single-alphabet predictors have never applied the difference (see SingleAlphabetDistributionPredictor).
+	return std::make_shared<itp::DiscreteMarginalPointwisePredictor<DoubleT, SymbolT, Real>>(computer, sampler);
+}
+
+template<typename DoubleT, typename SymbolT>
+itp::PointwisePredictorPtr<DoubleT, SymbolT> ForecastingAlgorithmDiscrete<DoubleT, SymbolT>::MakeMonteCarloPredictor(
+	itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
+	itp::SamplerPtr<SymbolT> sampler,
+	size_t) const
 {
-	auto dpredictor = std::make_shared<itp::DiscreteDistributionPredictor<DoubleT, SymbolT>>(
+	// Estimates the same distribution as MakePredictorFor, so the difference is not applied either.
+	return std::make_shared<itp::DiscreteMonteCarloPredictor<DoubleT, SymbolT, itp::HighPrecDouble>>(
 		computer,
 		sampler,
-		difference);
-	return std::make_shared<itp::BasicPointwisePredictor<DoubleT, SymbolT>>(dpredictor);
+		*this->monte_carlo_samples_count_,
+		this->monte_carlo_seed_);
 }
 
 template<typename DoubleT>
@@ -195,31 +467,44 @@ void ForecastingAlgorithmReal<DoubleT>::SetQuantaCount(size_t n)
 }
 
 template<typename DoubleT>
-itp::PointwisePredictorPtr<DoubleT, DoubleT> ForecastingAlgorithmReal<DoubleT>::MakePredictor(
-	itp::CodeLengthsComputerPtr<DoubleT> computer,
+template<typename Real>
+itp::PointwisePredictorPtr<DoubleT, DoubleT> ForecastingAlgorithmReal<DoubleT>::MakePredictorFor(
+	itp::CodeLengthsComputerPtr<DoubleT, Real> computer,
 	itp::SamplerPtr<DoubleT> sampler,
-	size_t difference) const
+	size_t) const
+{
+	// The single-alphabet predictors have never applied the difference (see SingleAlphabetDistributionPredictor).
+	return std::make_shared<itp::RealMarginalPointwisePredictor<DoubleT, Real>>(computer, sampler, quanta_count_);
+}
+
+template<typename DoubleT>
+itp::PointwisePredictorPtr<DoubleT, DoubleT> ForecastingAlgorithmReal<DoubleT>::MakeMonteCarloPredictor(
+	itp::CodeLengthsComputerPtr<DoubleT, itp::HighPrecDouble> computer,
+	itp::SamplerPtr<DoubleT> sampler,
+	size_t) const
 {
-	auto dpredictor = std::make_shared<itp::RealDistributionPredictor<DoubleT>>(
+	// Estimates the same distribution as MakePredictorFor, so the difference is not applied either.
+	return std::make_shared<itp::RealMonteCarloPredictor<DoubleT, itp::HighPrecDouble>>(
 		computer,
 		sampler,
 		quanta_count_,
-		difference);
-	return std::make_shared<itp::BasicPointwisePredictor<DoubleT, DoubleT>>(dpredictor);
+		*this->monte_carlo_samples_count_,
+		this->monte_carlo_seed_);
 }
 
 template<typename DoubleT>
-itp::PointwisePredictorPtr<DoubleT, DoubleT> ForecastingAlgorithmMultialphabet<DoubleT>::MakePredictor(
-	itp::CodeLengthsComputerPtr<DoubleT> computer,
+template<typename Real>
+itp::PointwisePredictorPtr<DoubleT, DoubleT> ForecastingAlgorithmMultialphabet<DoubleT>::MakePredictorFor(
+	itp::CodeLengthsComputerPtr<DoubleT, Real> computer,
 	itp::SamplerPtr<DoubleT> sampler,
 	size_t difference) const
 {
-	auto dpredictor = std::make_shared<itp::MultialphabetDistributionPredictor<DoubleT>>(
+	auto dpredictor = std::make_shared<itp::MultialphabetDistributionPredictor<DoubleT, Real>>(
 		computer,
 		sampler,
 		ForecastingAlgorithmReal<DoubleT>::quanta_count_,
 		difference);
-	return std::make_shared<itp::BasicPointwisePredictor<DoubleT, DoubleT>>(dpredictor);
+	return std::make_shared<itp::BasicPointwisePredictor<DoubleT, DoubleT, Real>>(dpredictor);
 }
 
 #endif // ITP_BUILDERS_H_INCLUDED_
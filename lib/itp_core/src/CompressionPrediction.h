@@ -3,49 +3,176 @@
 
 #include "Compnames.h"
 #include "Compressors.h"
+#include "Parallel.h"
 #include "PredictorSubtypes.h"
 
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
 
 namespace itp
 {
 
-template<typename T>
+/**
+ * Continuations drawn by CodeLengthsComputer::SampleContinuations for one compressor.
+ */
+struct WeightedContinuations
+{
+	std::vector<Continuation<Symbol>> continuations;
+
+	// Base-2 logarithms of the importance weights 2^(-code length) / q, where q is the probability to draw the
+	// continuation.
+	std::vector<Double> log2_weights;
+};
+
+using SampledContinuations = std::map<CompressorName, WeightedContinuations>;
+
+template<typename T, typename Real = CodeProbability>
 class CodeLengthsComputer
 {
 public:
 	using Trajectories = ICompressor::Continuations;
 
-	explicit CodeLengthsComputer(CompressorsFacadePtr compressors);
+	/**
+	 * \param[in] compressors Compressors to use.
+	 * \param[in] threads_count Number of threads to compress continuations with. Every additional thread works with
+	 *     its own clone of the compressors, the grid of (compressor, chunk of continuations) pairs is distributed
+	 *     among the threads dynamically.
+	 */
+	explicit CodeLengthsComputer(CompressorsFacadePtr compressors, size_t threads_count = 1);
+
+	/**
+	 * \param[in] workers_compressors Compressors of each thread, the facades must not be used by other threads. They
+	 *     are kept by the caller between computations, so the states of compressors are not rebuilt.
+	 */
+	explicit CodeLengthsComputer(std::vector<CompressorsFacadePtr> workers_compressors);
 	virtual ~CodeLengthsComputer() = default;
 
-	virtual ContinuationsDistribution<T> ComputeContinuationsDistribution(
+	virtual ContinuationsDistribution<T, Real> ComputeContinuationsDistribution(
 		const PreprocessedTimeSeries<T, Symbol>& history,
 		size_t length_of_continuation,
 		const CompressorNames& compressor_names,
 		const Trajectories& possible_continuations) const;
 
-	virtual ContinuationsDistribution<T> ComputeContinuationsDistribution(
+	virtual ContinuationsDistribution<T, Real> ComputeContinuationsDistribution(
+		const PreprocessedTimeSeries<T, Symbol>& history,
+		size_t length_of_continuation,
+		const CompressorNames& compressor_names) const;
+
+	/**
+	 * Computes the distributions of symbols on each step of continuations without keeping the code lengths of all
+	 * continuations: they are compressed by chunks, which are summed up at once. The memory is O(h * A * compressors)
+	 * instead of O(A^h * compressors) for ComputeContinuationsDistribution.
+	 *
+	 * \param[in] history The series to continue.
+	 * \param[in] length_of_continuation Length h of continuations.
+	 * \param[in] compressor_names Compressors to use.
+	 *
+	 * \return For each step, sums of 2^(-code length) over the continuations with each symbol on the step, i.e. the
+	 *     distributions are not normalized.
+	 */
+	virtual std::vector<SymbolsDistributions<T, Real>> ComputeStepsDistributions(
 		const PreprocessedTimeSeries<T, Symbol>& history,
 		size_t length_of_continuation,
 		const CompressorNames& compressor_names) const;
 
+	/**
+	 * Draws continuations symbol by symbol: the next symbol is drawn with the probabilities proportional to
+	 * 2^(-code length) of the series extended by each symbol of the alphabet. The cost is linear in the number of
+	 * samples and in the length of continuations, in contrast to the enumeration of all A^h continuations. The
+	 * compressors, which can save their state, compress the history once per thread and continue the compression along
+	 * each drawn path, the others compress the whole series for each step.
+	 *
+	 * \param[in] history The series to continue.
+	 * \param[in] length_of_continuation Length of continuations to draw.
+	 * \param[in] compressor_names Compressors to draw continuations for.
+	 * \param[in] samples_count Number of continuations to draw for each compressor.
+	 * \param[in] seed Seed of the pseudorandom generator, the result doesn't depend on the number of threads.
+	 *
+	 * \return The continuations with their importance weights for each compressor.
+	 */
+	virtual SampledContinuations SampleContinuations(
+		const PreprocessedTimeSeries<T, Symbol>& history,
+		size_t length_of_continuation,
+		const CompressorNames& compressor_names,
+		size_t samples_count,
+		size_t seed) const;
+
+	size_t GetThreadsCount() const;
+
+	/**
+	 * Enables the branch-and-bound evaluation of continuations (see ICompressor::SetPruningSlack). The pruned
+	 * continuations are discarded: they get code lengths, which make their probabilities negligible.
+	 *
+	 * \param[in] slack_in_bits The slack or std::nullopt to evaluate all the continuations.
+	 */
+	void SetPruningSlack(std::optional<ICompressor::SizeInBits> slack_in_bits);
+
+	/**
+	 * Only the compressors with monotone code lengths prune continuations (see ICompressor::SetPruningSlack), so each
+	 * pruned continuation is less probable than the best one in its column by more than 2^slack times, and the
+	 * discarded share of a column doesn't exceed the count of pruned continuations multiplied by 2^(-slack).
+	 *
+	 * \return Upper bound of the share of probability discarded by pruning from a column of any distribution computed
+	 *     so far.
+	 */
+	Double GetDiscardedProbabilityBound() const;
+
 private:
-	CompressorsFacadePtr compressors_;
+	/**
+	 * Returns the facades of workers prepared to compress continuations over the alphabet.
+	 */
+	const std::vector<CompressorsFacadePtr>& PrepareWorkersCompressors(size_t alphabet) const;
+
+	/**
+	 * Splits the continuations so that each thread gets several tasks even when there are few compressors and a
+	 * compressor never returns the code lengths of too many continuations at once. Every chunk makes the compressor
+	 * process the history once again, so there is no sense to split more.
+	 */
+	size_t ChunksCount(size_t continuations_count, size_t compressors_count, size_t workers_count) const;
+
+	/**
+	 * Replaces the code lengths of the pruned continuations of a chunk with the values, which make their probabilities
+	 * negligible.
+	 *
+	 * \return Count of the pruned continuations.
+	 */
+	size_t DiscardPrunedContinuations(std::vector<ICompressor::SizeInBits>* code_lengths) const;
+
+	/**
+	 * \param[in] pruned_counts Counts of the pruned continuations in each chunk, the chunks of a compressor go one
+	 *     after another.
+	 * \param[in] chunks_count Number of chunks of a compressor.
+	 */
+	void UpdateDiscardedProbabilityBound(const std::vector<size_t>& pruned_counts, size_t chunks_count) const;
+
+	std::vector<CompressorsFacadePtr> workers_compressors_;
+	std::optional<ICompressor::SizeInBits> pruning_slack_ = std::nullopt;
+	mutable std::mutex discarded_probability_bound_mutex_;
+	mutable Double discarded_probability_bound_ = 0.;
 	static constexpr size_t bits_in_byte_ = 8;
+	static constexpr size_t chunks_per_thread_ = 4;
+	static constexpr size_t max_chunk_size_ = 1 << 16;
+
+	// Added to the code lengths of the pruned continuations, 2^(-1100) is zero even for denormalized doubles.
+	static constexpr ICompressor::SizeInBits discarded_code_length_margin_ = 1100;
 };
 
-template<typename T>
-using CodeLengthsComputerPtr = std::shared_ptr<CodeLengthsComputer<T>>;
+template<typename T, typename Real = CodeProbability>
+using CodeLengthsComputerPtr = std::shared_ptr<CodeLengthsComputer<T, Real>>;
 
-template<typename OrigType, typename NewType>
-class CompressionBasedPredictor : public DistributionPredictor<OrigType, NewType>
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
+class CompressionBasedPredictor : public DistributionPredictor<OrigType, NewType, Real>
 {
 public:
 	explicit CompressionBasedPredictor(size_t difference_order = 0);
 	explicit CompressionBasedPredictor(WeightsGeneratorPtr weights_generator, size_t difference_order = 0);
 
-	ContinuationsDistribution<OrigType> Predict(
+	ContinuationsDistribution<OrigType, Real> Predict(
 		PreprocessedTimeSeries<OrigType, NewType> history,
 		size_t horizont,
 		const CompressorNamesVec& compressor_groups) const final;
@@ -54,7 +181,7 @@ public:
 	size_t GetDifferenceOrder() const;
 
 protected:
-	virtual ContinuationsDistribution<OrigType> ObtainCodeProbabilities(
+	virtual ContinuationsDistribution<OrigType, Real> ObtainCodeProbabilities(
 		const PreprocessedTimeSeries<OrigType, NewType>& history,
 		size_t horizont,
 		const CompressorNames& compressor_names) const = 0;
@@ -64,54 +191,54 @@ private:
 	size_t difference_order_;
 };
 
-template<typename DoubleT>
-class MultialphabetDistributionPredictor : public CompressionBasedPredictor<DoubleT, DoubleT>
+template<typename DoubleT, typename Real = CodeProbability>
+class MultialphabetDistributionPredictor : public CompressionBasedPredictor<DoubleT, DoubleT, Real>
 {
 public:
 	MultialphabetDistributionPredictor() = delete;
 	MultialphabetDistributionPredictor(
-		CodeLengthsComputerPtr<DoubleT> codes_lengths_computer,
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
 		SamplerPtr<DoubleT> sampler,
 		size_t max_q,
 		size_t difference = 0);
 
-	ContinuationsDistribution<DoubleT> ObtainCodeProbabilities(
+	ContinuationsDistribution<DoubleT, Real> ObtainCodeProbabilities(
 		const PreprocessedTimeSeries<DoubleT, DoubleT>& ts,
 		size_t horizont,
 		const CompressorNames& compressor_names) const override;
 
 private:
-	CodeLengthsComputerPtr<DoubleT> codes_lengths_computer_;
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer_;
 	SamplerPtr<DoubleT> sampler_;
 	size_t log2_max_partition_cardinality_;
 	WeightsGeneratorPtr partitions_weights_gen_;
 };
 
-template<typename OrigType, typename NewType>
-class SingleAlphabetDistributionPredictor : public CompressionBasedPredictor<OrigType, NewType>
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
+class SingleAlphabetDistributionPredictor : public CompressionBasedPredictor<OrigType, NewType, Real>
 {
 public:
 	SingleAlphabetDistributionPredictor() = delete;
-	explicit SingleAlphabetDistributionPredictor(CodeLengthsComputerPtr<OrigType>, size_t = 0);
+	explicit SingleAlphabetDistributionPredictor(CodeLengthsComputerPtr<OrigType, Real>, size_t = 0);
 
 protected:
-	ContinuationsDistribution<OrigType> ObtainCodeProbabilities(
+	ContinuationsDistribution<OrigType, Real> ObtainCodeProbabilities(
 		const PreprocessedTimeSeries<OrigType, NewType>&,
 		size_t,
 		const CompressorNames&) const override final;
 	virtual PreprocessedTimeSeries<OrigType, Symbol> Sample(const PreprocessedTimeSeries<OrigType, NewType>&) const = 0;
 
 private:
-	CodeLengthsComputerPtr<OrigType> codes_lengths_computer_;
+	CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer_;
 };
 
-template<typename DoubleT>
-class RealDistributionPredictor : public SingleAlphabetDistributionPredictor<DoubleT, DoubleT>
+template<typename DoubleT, typename Real = CodeProbability>
+class RealDistributionPredictor : public SingleAlphabetDistributionPredictor<DoubleT, DoubleT, Real>
 {
 public:
 	RealDistributionPredictor() = delete;
 	RealDistributionPredictor(
-		CodeLengthsComputerPtr<DoubleT> codes_lengths_computer,
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
 		SamplerPtr<DoubleT> sampler,
 		size_t partition_cardinality,
 		size_t difference = 0);
@@ -124,13 +251,13 @@ private:
 	size_t partition_cardinality_;
 };
 
-template<typename DoubleT, typename SymbolT>
-class DiscreteDistributionPredictor : public SingleAlphabetDistributionPredictor<DoubleT, SymbolT>
+template<typename DoubleT, typename SymbolT, typename Real = CodeProbability>
+class DiscreteDistributionPredictor : public SingleAlphabetDistributionPredictor<DoubleT, SymbolT, Real>
 {
 public:
 	DiscreteDistributionPredictor() = delete;
 	DiscreteDistributionPredictor(
-		CodeLengthsComputerPtr<DoubleT> codes_lengths_computer,
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
 		SamplerPtr<SymbolT> sampler,
 		size_t difference = 0);
 
@@ -141,51 +268,95 @@ private:
 	SamplerPtr<SymbolT> sampler_;
 };
 
-template<typename T>
-CodeLengthsComputer<T>::CodeLengthsComputer(CompressorsFacadePtr compressors)
-	: compressors_{std::move(compressors)}
+template<typename T, typename Real>
+CodeLengthsComputer<T, Real>::CodeLengthsComputer(CompressorsFacadePtr compressors, size_t threads_count)
+	: workers_compressors_{compressors}
 {
-	// DO NOTHING
+	while (std::size(workers_compressors_) < threads_count)
+	{
+		workers_compressors_.push_back(compressors->Clone());
+	}
 }
 
-template<typename T>
-ContinuationsDistribution<T> CodeLengthsComputer<T>::ComputeContinuationsDistribution(
+template<typename T, typename Real>
+CodeLengthsComputer<T, Real>::CodeLengthsComputer(std::vector<CompressorsFacadePtr> workers_compressors)
+	: workers_compressors_{std::move(workers_compressors)}
+{
+	assert(!workers_compressors_.empty());
+}
+
+template<typename T, typename Real>
+ContinuationsDistribution<T, Real> CodeLengthsComputer<T, Real>::ComputeContinuationsDistribution(
 	const PreprocessedTimeSeries<T, Symbol>& history,
 	size_t length_of_continuation,
 	const CompressorNames& compressor_names,
 	const Trajectories& possible_continuations) const
 {
 	const auto alphabet = history.GetSamplingAlphabet();
-	assert(length_of_continuation <= 100);
+	assert(length_of_continuation <= Continuation<Symbol>::kMaxSize);
 	assert(alphabet > 0);
 
-	compressors_->SetAlphabetDescription({0, static_cast<Symbol>(alphabet - 1)});
-
-	ContinuationsDistribution<T> result(
+	const auto& workers_compressors = PrepareWorkersCompressors(alphabet);
+	ContinuationsDistribution<T, Real> result(
 		std::begin(possible_continuations),
 		std::end(possible_continuations),
 		std::begin(compressor_names),
 		std::end(compressor_names));
+	if (possible_continuations.empty())
+	{
+		return result;
+	}
 
-	const auto& plain_time_series = history.to_plain_tseries();
-	for (size_t i = 0; i < result.FactorsSize(); ++i)
+	const auto continuations_count = std::size(possible_continuations);
+	const auto compressors_count = std::size(compressor_names);
+	const auto chunks_count = ChunksCount(continuations_count, compressors_count, std::size(workers_compressors));
+
+	// The continuations of the range go in the table one after another, so each chunk fills a contiguous part of the
+	// columns and the tasks never write to the same cells.
+	std::vector<Real*> columns(compressors_count);
+	for (size_t i = 0; i < compressors_count; ++i)
 	{
-		const auto code_lengths = compressors_->CompressContinuations(
-			compressor_names[i],
-			plain_time_series,
-			possible_continuations);
+		columns[i] = result.Column(result.FactorPosition(compressor_names[i]));
+	}
+	const auto first_row = result.Rank(possible_continuations[0]);
+	std::vector<size_t> pruned_counts(compressors_count * chunks_count);
 
-		for (size_t j = 0; j < std::size(possible_continuations); ++j)
+	const auto& plain_time_series = history.to_plain_tseries();
+	RunInParallel(
+		std::size(workers_compressors),
+		compressors_count * chunks_count,
+		[&](size_t worker_index, size_t task_index)
 		{
-			result(possible_continuations[j], compressor_names[i]) = code_lengths[j];
-		}
+			const auto compressor_index = task_index / chunks_count;
+			const auto chunk_index = task_index % chunks_count;
+			const auto chunk_begin = continuations_count * chunk_index / chunks_count;
+			const auto chunk_end = continuations_count * (chunk_index + 1) / chunks_count;
+
+			auto chunk_code_lengths = workers_compressors[worker_index]->CompressContinuations(
+				compressor_names[compressor_index],
+				plain_time_series,
+				possible_continuations.SubRange(chunk_begin, chunk_end));
+			assert(std::size(chunk_code_lengths) == chunk_end - chunk_begin);
+			if (pruning_slack_)
+			{
+				pruned_counts[task_index] = DiscardPrunedContinuations(&chunk_code_lengths);
+			}
+			std::copy(
+				std::cbegin(chunk_code_lengths),
+				std::cend(chunk_code_lengths),
+				columns[compressor_index] + first_row + chunk_begin);
+		});
+
+	if (pruning_slack_)
+	{
+		UpdateDiscardedProbabilityBound(pruned_counts, chunks_count);
 	}
 
 	return result;
 }
 
-template<typename T>
-ContinuationsDistribution<T> CodeLengthsComputer<T>::ComputeContinuationsDistribution(
+template<typename T, typename Real>
+ContinuationsDistribution<T, Real> CodeLengthsComputer<T, Real>::ComputeContinuationsDistribution(
 	const PreprocessedTimeSeries<T, Symbol>& history,
 	size_t length_of_continuation,
 	const CompressorNames& compressor_names) const
@@ -193,18 +364,312 @@ ContinuationsDistribution<T> CodeLengthsComputer<T>::ComputeContinuationsDistrib
 	const auto alphabet = history.GetSamplingAlphabet();
 	assert(0 < alphabet);
 
-	std::vector<Continuation<Symbol>> possible_continuations;
-	Continuation<Symbol> continuation(alphabet, length_of_continuation);
-	for (size_t i = 0; i < pow(alphabet, length_of_continuation); ++i)
+	return ComputeContinuationsDistribution(
+		history,
+		length_of_continuation,
+		compressor_names,
+		Trajectories(alphabet, length_of_continuation));
+}
+
+template<typename T, typename Real>
+std::vector<SymbolsDistributions<T, Real>> CodeLengthsComputer<T, Real>::ComputeStepsDistributions(
+	const PreprocessedTimeSeries<T, Symbol>& history,
+	size_t length_of_continuation,
+	const CompressorNames& compressor_names) const
+{
+	const auto alphabet = history.GetSamplingAlphabet();
+	assert(length_of_continuation <= Continuation<Symbol>::kMaxSize);
+	assert(alphabet > 0);
+
+	const auto& workers_compressors = PrepareWorkersCompressors(alphabet);
+	const Trajectories possible_continuations(alphabet, length_of_continuation);
+	const auto continuations_count = std::size(possible_continuations);
+	const auto compressors_count = std::size(compressor_names);
+	const auto chunks_count = ChunksCount(continuations_count, compressors_count, std::size(workers_compressors));
+
+	// Each task sums up its chunk separately, the sums are added in the same order for any number of threads.
+	std::vector<std::vector<Real>> chunks_sums(compressors_count * chunks_count);
+	std::vector<size_t> pruned_counts(compressors_count * chunks_count);
+	const auto& plain_time_series = history.to_plain_tseries();
+	RunInParallel(
+		std::size(workers_compressors),
+		compressors_count * chunks_count,
+		[&](size_t worker_index, size_t task_index)
+		{
+			const auto compressor_index = task_index / chunks_count;
+			const auto chunk_index = task_index % chunks_count;
+			const auto chunk_begin = continuations_count * chunk_index / chunks_count;
+			const auto chunk_end = continuations_count * (chunk_index + 1) / chunks_count;
+
+			const auto chunk_code_lengths = workers_compressors[worker_index]->CompressContinuations(
+				compressor_names[compressor_index],
+				plain_time_series,
+				possible_continuations.SubRange(chunk_begin, chunk_end));
+			assert(std::size(chunk_code_lengths) == chunk_end - chunk_begin);
+
+			const Real base = 2.;
+			auto& sums = chunks_sums[task_index];
+			sums.assign(length_of_continuation * alphabet, Real{0});
+			for (size_t i = 0; i < std::size(chunk_code_lengths); ++i)
+			{
+				if (chunk_code_lengths[i] == ICompressor::kPrunedCodeLength)
+				{
+					++pruned_counts[task_index];
+					continue;
+				}
+
+				const auto code_probability = pow(base, -static_cast<Real>(chunk_code_lengths[i]));
+				auto rank = chunk_begin + i;
+				for (size_t step = 0; step < length_of_continuation; ++step, rank /= alphabet)
+				{
+					sums[step * alphabet + rank % alphabet] += code_probability;
+				}
+			}
+		});
+
+	if (pruning_slack_)
+	{
+		UpdateDiscardedProbabilityBound(pruned_counts, chunks_count);
+	}
+
+	std::vector<SymbolsDistributions<T, Real>> result(length_of_continuation);
+	for (size_t step = 0; step < length_of_continuation; ++step)
+	{
+		for (size_t symbol = 0; symbol < alphabet; ++symbol)
+		{
+			for (size_t i = 0; i < compressors_count; ++i)
+			{
+				auto& value = result[step](static_cast<Symbol>(symbol), compressor_names[i]);
+				value = 0;
+				for (size_t j = 0; j < chunks_count; ++j)
+				{
+					value += chunks_sums[i * chunks_count + j][step * alphabet + symbol];
+				}
+			}
+		}
+		result[step].CopyPreprocessingInfoFrom(history);
+	}
+
+	return result;
+}
+
+template<typename T, typename Real>
+SampledContinuations CodeLengthsComputer<T, Real>::SampleContinuations(
+	const PreprocessedTimeSeries<T, Symbol>& history,
+	size_t length_of_continuation,
+	const CompressorNames& compressor_names,
+	size_t samples_count,
+	size_t seed) const
+{
+	const auto alphabet = history.GetSamplingAlphabet();
+	assert(length_of_continuation <= Continuation<Symbol>::kMaxSize);
+	assert(alphabet > 0);
+
+	for (const auto& compressors : workers_compressors_)
+	{
+		compressors->SetAlphabetDescription({0, static_cast<Symbol>(alphabet - 1)});
+
+		// Pruned symbols would never be drawn, that biases the estimates.
+		compressors->SetPruningSlack(std::nullopt);
+	}
+
+	SampledContinuations result;
+	std::vector<WeightedContinuations*> samples(std::size(compressor_names));
+	for (size_t i = 0; i < std::size(compressor_names); ++i)
+	{
+		samples[i] = &result[compressor_names[i]];
+		samples[i]->continuations.assign(samples_count, Continuation<Symbol>(alphabet, 0));
+		samples[i]->log2_weights.resize(samples_count);
+	}
+
+	const auto& plain_time_series = history.to_plain_tseries();
+
+	// The tasks of a worker go in the order of compressors, so the state after the history is made once per worker and
+	// compressor, std::nullopt until it is made.
+	std::vector<std::optional<ICompressionCheckpointPtr>> history_checkpoints(
+		std::size(workers_compressors_) * std::size(compressor_names));
+	RunInParallel(
+		std::size(workers_compressors_),
+		std::size(compressor_names) * samples_count,
+		[&](size_t worker_index, size_t task_index)
+		{
+			const auto compressor_index = task_index / samples_count;
+			const auto sample_index = task_index % samples_count;
+			const auto& compressors = workers_compressors_[worker_index];
+			const auto& compressor_name = compressor_names[compressor_index];
+
+			// Each sample has its own generator, so the samples don't depend on the order of tasks.
+			std::seed_seq seed_sequence{seed, compressor_index, sample_index};
+			std::mt19937_64 generator{seed_sequence};
+
+			auto& history_checkpoint = history_checkpoints[worker_index * std::size(compressor_names) + compressor_index];
+			if (!history_checkpoint)
+			{
+				history_checkpoint = compressors->MakeCheckpoint(
+					compressor_name,
+					plain_time_series.data(),
+					std::size(plain_time_series));
+			}
+
+			// Without checkpoints, the whole series is compressed with each next symbol.
+			const auto state = *history_checkpoint ? (*history_checkpoint)->Fork() : nullptr;
+			auto series = state ? std::vector<Symbol>{} : plain_time_series;
+			auto& continuation = samples[compressor_index]->continuations[sample_index];
+			std::vector<ICompressor::SizeInBits> code_lengths(alphabet);
+			std::vector<Double> probabilities(alphabet);
+			Double log2_probability_to_draw = 0.;
+			ICompressor::SizeInBits code_length = 0;
+			for (size_t i = 0; i < length_of_continuation; ++i)
+			{
+				if (state)
+				{
+					for (size_t symbol = 0; symbol < alphabet; ++symbol)
+					{
+						const auto next_symbol = static_cast<Symbol>(symbol);
+						const auto extended = state->Fork();
+						extended->Append(&next_symbol, 1);
+						code_lengths[symbol] = extended->Finish();
+					}
+				}
+				else
+				{
+					code_lengths = compressors->CompressContinuations(
+						compressor_name,
+						series,
+						Trajectories(alphabet, 1));
+				}
+				const auto minimal_code_length = *std::min_element(std::cbegin(code_lengths), std::cend(code_lengths));
+				for (size_t symbol = 0; symbol < alphabet; ++symbol)
+				{
+					probabilities[symbol] = std::exp2(-static_cast<Double>(code_lengths[symbol] - minimal_code_length));
+				}
+
+				std::discrete_distribution<size_t> next_symbol_distribution(
+					std::cbegin(probabilities),
+					std::cend(probabilities));
+				const auto symbol = next_symbol_distribution(generator);
+				log2_probability_to_draw += std::log2(next_symbol_distribution.probabilities()[symbol]);
+				code_length = code_lengths[symbol];
+				const auto drawn_symbol = static_cast<Symbol>(symbol);
+				continuation.push_back(drawn_symbol);
+				if (state)
+				{
+					state->Append(&drawn_symbol, 1);
+				}
+				else
+				{
+					series.push_back(drawn_symbol);
+				}
+			}
+			samples[compressor_index]->log2_weights[sample_index]
+				= -static_cast<Double>(code_length) - log2_probability_to_draw;
+		});
+
+	return result;
+}
+
+template<typename T, typename Real>
+size_t CodeLengthsComputer<T, Real>::GetThreadsCount() const
+{
+	return std::size(workers_compressors_);
+}
+
+template<typename T, typename Real>
+void CodeLengthsComputer<T, Real>::SetPruningSlack(std::optional<ICompressor::SizeInBits> slack_in_bits)
+{
+	pruning_slack_ = slack_in_bits;
+}
+
+template<typename T, typename Real>
+Double CodeLengthsComputer<T, Real>::GetDiscardedProbabilityBound() const
+{
+	std::lock_guard lock{discarded_probability_bound_mutex_};
+	return discarded_probability_bound_;
+}
+
+template<typename T, typename Real>
+const std::vector<CompressorsFacadePtr>& CodeLengthsComputer<T, Real>::PrepareWorkersCompressors(size_t alphabet) const
+{
+	for (const auto& compressors : workers_compressors_)
+	{
+		compressors->SetAlphabetDescription({0, static_cast<Symbol>(alphabet - 1)});
+		compressors->SetPruningSlack(pruning_slack_);
+	}
+
+	return workers_compressors_;
+}
+
+template<typename T, typename Real>
+size_t CodeLengthsComputer<T, Real>::ChunksCount(
+	size_t continuations_count,
+	size_t compressors_count,
+	size_t workers_count) const
+{
+	size_t chunks_count = (continuations_count + max_chunk_size_ - 1) / max_chunk_size_;
+	if (1 < workers_count && 0 < compressors_count)
 	{
-		possible_continuations.push_back(continuation++);
+		const auto desired_tasks_count = workers_count * chunks_per_thread_;
+		chunks_count = std::max(
+			chunks_count,
+			std::min<size_t>((desired_tasks_count + compressors_count - 1) / compressors_count, continuations_count));
+	}
+
+	return chunks_count;
+}
+
+template<typename T, typename Real>
+void CodeLengthsComputer<T, Real>::UpdateDiscardedProbabilityBound(
+	const std::vector<size_t>& pruned_counts,
+	size_t chunks_count) const
+{
+	assert(pruning_slack_);
+
+	size_t max_pruned_count = 0;
+	for (size_t i = 0; i < std::size(pruned_counts); i += chunks_count)
+	{
+		max_pruned_count = std::max(
+			max_pruned_count,
+			std::accumulate(
+				std::cbegin(pruned_counts) + i,
+				std::cbegin(pruned_counts) + i + chunks_count,
+				size_t{0}));
+	}
+
+	const auto bound = std::min(
+		1.,
+		std::ldexp(
+			static_cast<Double>(max_pruned_count),
+			-static_cast<int>(std::min<ICompressor::SizeInBits>(*pruning_slack_, 2048))));
+	std::lock_guard lock{discarded_probability_bound_mutex_};
+	discarded_probability_bound_ = std::max(discarded_probability_bound_, bound);
+}
+
+template<typename T, typename Real>
+size_t CodeLengthsComputer<T, Real>::DiscardPrunedContinuations(std::vector<ICompressor::SizeInBits>* code_lengths) const
+{
+	assert(pruning_slack_);
+
+	auto minimal_code_length = ICompressor::kPrunedCodeLength;
+	for (auto code_length : *code_lengths)
+	{
+		minimal_code_length = std::min(minimal_code_length, code_length);
+	}
+
+	size_t pruned_count = 0;
+	for (auto& code_length : *code_lengths)
+	{
+		if (code_length == ICompressor::kPrunedCodeLength)
+		{
+			code_length = minimal_code_length + *pruning_slack_ + discarded_code_length_margin_;
+			++pruned_count;
+		}
 	}
 
-	return ComputeContinuationsDistribution(history, length_of_continuation, compressor_names, possible_continuations);
+	return pruned_count;
 }
 
-template<typename OrigType, typename NewType>
-ContinuationsDistribution<OrigType> CompressionBasedPredictor<OrigType, NewType>::Predict(
+template<typename OrigType, typename NewType, typename Real>
+ContinuationsDistribution<OrigType, Real> CompressionBasedPredictor<OrigType, NewType, Real>::Predict(
 	PreprocessedTimeSeries<OrigType, NewType> history,
 	size_t horizont,
 	const CompressorNamesVec& compressor_groups) const
@@ -219,13 +684,13 @@ ContinuationsDistribution<OrigType> CompressionBasedPredictor<OrigType, NewType>
 	return ToProbabilities(code_probabilities_result);
 }
 
-template<typename DoubleT>
-MultialphabetDistributionPredictor<DoubleT>::MultialphabetDistributionPredictor(
-	CodeLengthsComputerPtr<DoubleT> codes_lengths_computer,
+template<typename DoubleT, typename Real>
+MultialphabetDistributionPredictor<DoubleT, Real>::MultialphabetDistributionPredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
 	SamplerPtr<DoubleT> sampler,
 	size_t max_q,
 	size_t difference_order)
-	: CompressionBasedPredictor<DoubleT, DoubleT>{difference_order}
+	: CompressionBasedPredictor<DoubleT, DoubleT, Real>{difference_order}
 	, codes_lengths_computer_{codes_lengths_computer}
 	, sampler_{sampler}
 	, partitions_weights_gen_{std::make_shared<CountableWeightsGenerator>()}
@@ -237,14 +702,14 @@ MultialphabetDistributionPredictor<DoubleT>::MultialphabetDistributionPredictor(
 	log2_max_partition_cardinality_ = log2(max_q);
 }
 
-template<typename DoubleT>
-ContinuationsDistribution<DoubleT> MultialphabetDistributionPredictor<DoubleT>::ObtainCodeProbabilities(
+template<typename DoubleT, typename Real>
+ContinuationsDistribution<DoubleT, Real> MultialphabetDistributionPredictor<DoubleT, Real>::ObtainCodeProbabilities(
 	const PreprocessedTimeSeries<DoubleT, DoubleT>& history,
 	size_t horizont,
 	const CompressorNames& compressor_names) const
 {
 	size_t N = log2_max_partition_cardinality_;
-	std::vector<ContinuationsDistribution<DoubleT>> tables(N);
+	std::vector<ContinuationsDistribution<DoubleT, Real>> tables(N);
 	std::vector<size_t> alphabets(N);
 	for (size_t i = 0; i < N; ++i)
 	{
@@ -262,7 +727,7 @@ ContinuationsDistribution<DoubleT> MultialphabetDistributionPredictor<DoubleT>::
 		AddValueToEach(begin(tables[i]), end(tables[i]), (N - i - 1) * message_length);
 	}
 	auto global_minimal_code_length
-		= MinValueOfAllTables<typename decltype(tables)::const_iterator, HighPrecDouble>(
+		= MinValueOfAllTables<typename decltype(tables)::const_iterator, Real>(
 			tables.cbegin(),
 			tables.cend());
 	for (auto& table : tables)
@@ -277,48 +742,48 @@ ContinuationsDistribution<DoubleT> MultialphabetDistributionPredictor<DoubleT>::
 	return table;
 }
 
-template<typename DoubleT>
-RealDistributionPredictor<DoubleT>::RealDistributionPredictor(
-	CodeLengthsComputerPtr<DoubleT> codes_lengths_computer,
+template<typename DoubleT, typename Real>
+RealDistributionPredictor<DoubleT, Real>::RealDistributionPredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
 	SamplerPtr<DoubleT> sampler,
 	size_t partition_cardinality,
 	size_t difference_order)
-	: SingleAlphabetDistributionPredictor<DoubleT, DoubleT>{codes_lengths_computer, difference_order}
+	: SingleAlphabetDistributionPredictor<DoubleT, DoubleT, Real>{codes_lengths_computer, difference_order}
 	, sampler_{sampler}
 	, partition_cardinality_{partition_cardinality}
 {
 	// DO NOTHING
 }
 
-template<typename DoubleT>
-PreprocessedTimeSeries<DoubleT, itp::Symbol> RealDistributionPredictor<DoubleT>::Sample(
+template<typename DoubleT, typename Real>
+PreprocessedTimeSeries<DoubleT, itp::Symbol> RealDistributionPredictor<DoubleT, Real>::Sample(
 	const PreprocessedTimeSeries<DoubleT, DoubleT>& history) const
 {
 	auto sampling_result = sampler_->Transform(history, partition_cardinality_);
 	return sampling_result;
 }
 
-template<typename DoubleT, typename SymbolT>
-DiscreteDistributionPredictor<DoubleT, SymbolT>::DiscreteDistributionPredictor(
-	CodeLengthsComputerPtr<DoubleT> codes_lengths_computer,
+template<typename DoubleT, typename SymbolT, typename Real>
+DiscreteDistributionPredictor<DoubleT, SymbolT, Real>::DiscreteDistributionPredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
 	SamplerPtr<SymbolT> sampler,
 	size_t difference_order)
-	: SingleAlphabetDistributionPredictor<DoubleT, SymbolT>{codes_lengths_computer, difference_order}
+	: SingleAlphabetDistributionPredictor<DoubleT, SymbolT, Real>{codes_lengths_computer, difference_order}
 	, sampler_{sampler}
 {
 	// DO NOTHING
 }
 
-template<typename DoubleT, typename SymbolT>
-PreprocessedTimeSeries<DoubleT, Symbol> DiscreteDistributionPredictor<DoubleT, SymbolT>::Sample(
+template<typename DoubleT, typename SymbolT, typename Real>
+PreprocessedTimeSeries<DoubleT, Symbol> DiscreteDistributionPredictor<DoubleT, SymbolT, Real>::Sample(
 	const PreprocessedTimeSeries<DoubleT, SymbolT>& history) const
 {
 	return sampler_->Transform(history);
 }
 
-template<typename OrigType, typename NewType>
-ContinuationsDistribution<OrigType>
-SingleAlphabetDistributionPredictor<OrigType, NewType>::ObtainCodeProbabilities(
+template<typename OrigType, typename NewType, typename Real>
+ContinuationsDistribution<OrigType, Real>
+SingleAlphabetDistributionPredictor<OrigType, NewType, Real>::ObtainCodeProbabilities(
 	const PreprocessedTimeSeries<OrigType, NewType>& history,
 	size_t horizont,
 	const CompressorNames& compressor_names) const
@@ -333,15 +798,15 @@ SingleAlphabetDistributionPredictor<OrigType, NewType>::ObtainCodeProbabilities(
 	return table;
 }
 
-template<typename OrigType, typename NewType>
-CompressionBasedPredictor<OrigType, NewType>::CompressionBasedPredictor(size_t difference_order)
-	: CompressionBasedPredictor<OrigType, NewType>{std::make_shared<WeightsGenerator>(), difference_order}
+template<typename OrigType, typename NewType, typename Real>
+CompressionBasedPredictor<OrigType, NewType, Real>::CompressionBasedPredictor(size_t difference_order)
+	: CompressionBasedPredictor<OrigType, NewType, Real>{std::make_shared<WeightsGenerator>(), difference_order}
 {
 	// DO NOTHING
 }
 
-template<typename OrigType, typename NewType>
-CompressionBasedPredictor<OrigType, NewType>::CompressionBasedPredictor(
+template<typename OrigType, typename NewType, typename Real>
+CompressionBasedPredictor<OrigType, NewType, Real>::CompressionBasedPredictor(
 	WeightsGeneratorPtr weights_generator,
 	size_t difference_order)
 	: weights_generator_{weights_generator}
@@ -350,21 +815,21 @@ CompressionBasedPredictor<OrigType, NewType>::CompressionBasedPredictor(
 	// DO NOTHING
 }
 
-template<typename OrigType, typename NewType>
-void CompressionBasedPredictor<OrigType, NewType>::SetDifferenceOrder(size_t n)
+template<typename OrigType, typename NewType, typename Real>
+void CompressionBasedPredictor<OrigType, NewType, Real>::SetDifferenceOrder(size_t n)
 {
 	difference_order_ = n;
 }
 
-template<typename OrigType, typename NewType>
-size_t CompressionBasedPredictor<OrigType, NewType>::GetDifferenceOrder() const
+template<typename OrigType, typename NewType, typename Real>
+size_t CompressionBasedPredictor<OrigType, NewType, Real>::GetDifferenceOrder() const
 {
 	return difference_order_;
 }
 
-template<typename OrigType, typename NewType>
-SingleAlphabetDistributionPredictor<OrigType, NewType>::SingleAlphabetDistributionPredictor(
-	CodeLengthsComputerPtr<OrigType> codes_lengths_computer,
+template<typename OrigType, typename NewType, typename Real>
+SingleAlphabetDistributionPredictor<OrigType, NewType, Real>::SingleAlphabetDistributionPredictor(
+	CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer,
 	size_t)
 	: codes_lengths_computer_{codes_lengths_computer}
 {
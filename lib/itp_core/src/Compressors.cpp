@@ -5,10 +5,180 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <new>
+#include <numeric>
 
 namespace itp
 {
 
+namespace
+{
+
+/**
+ * Checks if there are continuations, which ranks give the specified residue modulo the modulus, in the range. The
+ * continuations with a common prefix of length d are exactly the ones with the same rank modulo A^d.
+ */
+bool HasRanksInRange(const ICompressor::Continuations& range, size_t residue, size_t modulus)
+{
+	const auto first = range.GetFirstRank();
+	return first + (residue + modulus - first % modulus) % modulus < range.GetLastRank();
+}
+
+/**
+ * Checks if the code length of a prefix is too long to expand it, i.e. it exceeds the minimal code length of the already
+ * evaluated continuations by more than the slack.
+ */
+bool IsPruned(
+	ICompressor::SizeInBits code_length,
+	ICompressor::SizeInBits minimal_code_length,
+	ICompressor::SizeInBits slack)
+{
+	return minimal_code_length < code_length && slack < code_length - minimal_code_length;
+}
+
+/**
+ * Extends the prefix by each symbol of the alphabet and descends to the children until the continuations are complete.
+ *
+ * \param[in] prefix_state State of the compressor after the prefix.
+ * \param[in] depth Length of the prefix.
+ * \param[in] prefix_rank Rank of the prefix considered as a continuation of length depth.
+ * \param[in] modulus A^depth.
+ * \param[in] possible_endings Continuations to compress.
+ * \param[in] pruning_slack Slack of the branch-and-bound evaluation or std::nullopt to evaluate all continuations.
+ * \param[in,out] minimal_code_length Minimal code length of the continuations evaluated so far.
+ * \param[out] result Code lengths of the continuations.
+ */
+void CompressContinuationsWithPrefix(
+	const ICompressionCheckpoint& prefix_state,
+	size_t depth,
+	size_t prefix_rank,
+	size_t modulus,
+	const ICompressor::Continuations& possible_endings,
+	std::optional<ICompressor::SizeInBits> pruning_slack,
+	ICompressor::SizeInBits* minimal_code_length,
+	std::vector<ICompressor::SizeInBits>* result)
+{
+	const auto alphabet = possible_endings.GetAlphabetSize();
+	const auto is_last_symbol = depth + 1 == possible_endings.GetContinuationLength();
+	if (!pruning_slack)
+	{
+		for (size_t symbol = 0; symbol < alphabet; ++symbol)
+		{
+			const auto rank = prefix_rank + symbol * modulus;
+			if (!HasRanksInRange(possible_endings, rank, modulus * alphabet))
+			{
+				continue;
+			}
+
+			auto state = prefix_state.Fork();
+			const auto next_symbol = static_cast<Symbol>(symbol);
+			state->Append(&next_symbol, 1);
+			if (is_last_symbol)
+			{
+				(*result)[rank - possible_endings.GetFirstRank()] = state->Finish();
+			}
+			else
+			{
+				CompressContinuationsWithPrefix(
+					*state,
+					depth + 1,
+					rank,
+					modulus * alphabet,
+					possible_endings,
+					pruning_slack,
+					minimal_code_length,
+					result);
+			}
+		}
+
+		return;
+	}
+
+	// Visiting the most probable children first gives a small minimal code length early and prunes more.
+	struct Child
+	{
+		size_t rank;
+		ICompressionCheckpointPtr state;
+		ICompressor::SizeInBits code_length;
+	};
+	std::vector<Child> children;
+	for (size_t symbol = 0; symbol < alphabet; ++symbol)
+	{
+		const auto rank = prefix_rank + symbol * modulus;
+		if (HasRanksInRange(possible_endings, rank, modulus * alphabet))
+		{
+			auto state = prefix_state.Fork();
+			const auto next_symbol = static_cast<Symbol>(symbol);
+			state->Append(&next_symbol, 1);
+			const auto code_length = is_last_symbol ? state->Finish() : state->CodeLength();
+			children.push_back({rank, std::move(state), code_length});
+		}
+	}
+	std::stable_sort(
+		std::begin(children),
+		std::end(children),
+		[](const Child& lhs, const Child& rhs) { return lhs.code_length < rhs.code_length; });
+
+	for (const auto& child : children)
+	{
+		if (IsPruned(child.code_length, *minimal_code_length, *pruning_slack))
+		{
+			break;
+		}
+
+		if (is_last_symbol)
+		{
+			(*result)[child.rank - possible_endings.GetFirstRank()] = child.code_length;
+			*minimal_code_length = std::min(*minimal_code_length, child.code_length);
+		}
+		else
+		{
+			CompressContinuationsWithPrefix(
+				*child.state,
+				depth + 1,
+				child.rank,
+				modulus * alphabet,
+				possible_endings,
+				pruning_slack,
+				minimal_code_length,
+				result);
+		}
+	}
+}
+
+} // namespace
+
+std::vector<ICompressor::SizeInBits> CompressContinuationsFromCheckpoint(
+	const ICompressionCheckpoint& history_checkpoint,
+	const ICompressor::Continuations& possible_endings,
+	std::optional<ICompressor::SizeInBits> pruning_slack)
+{
+	std::vector<ICompressor::SizeInBits> result(std::size(possible_endings), ICompressor::kPrunedCodeLength);
+	if (possible_endings.empty())
+	{
+		return result;
+	}
+
+	if (possible_endings.GetContinuationLength() == 0)
+	{
+		std::fill(std::begin(result), std::end(result), history_checkpoint.Fork()->Finish());
+		return result;
+	}
+
+	auto minimal_code_length = ICompressor::kPrunedCodeLength;
+	CompressContinuationsWithPrefix(
+		history_checkpoint,
+		0,
+		0,
+		1,
+		possible_endings,
+		history_checkpoint.HasMonotoneCodeLengths() ? pruning_slack : std::nullopt,
+		&minimal_code_length,
+		&result);
+
+	return result;
+}
+
 std::vector<CompressorBase::SizeInBits> CompressorBase::CompressContinuations(
 	const std::vector<Symbol>& historical_values,
 	const Continuations& possible_endings)
@@ -18,25 +188,39 @@ std::vector<CompressorBase::SizeInBits> CompressorBase::CompressContinuations(
 		return {};
 	}
 
-	const auto full_series_length = std::size(historical_values) + std::size(possible_endings.front());
+	if (const auto checkpoint = MakeCheckpoint(historical_values.data(), std::size(historical_values)); checkpoint)
+	{
+		return CompressContinuationsFromCheckpoint(*checkpoint, possible_endings, pruning_slack_);
+	}
+
+	const auto full_series_length = std::size(historical_values) + possible_endings.GetContinuationLength();
 	auto buffer = std::make_unique<Symbol[]>(full_series_length);
 	std::copy(std::cbegin(historical_values), std::cend(historical_values), buffer.get());
 
 	std::vector<unsigned char> output_buffer;
-	std::vector<SizeInBits> result(std::size(possible_endings));
-	for (size_t i = 0; i < std::size(possible_endings); ++i)
+	std::vector<SizeInBits> result;
+	result.reserve(std::size(possible_endings));
+	for (const auto& ending : possible_endings)
 	{
-		std::copy(
-			possible_endings[i].cbegin(),
-			possible_endings[i].cend(),
-			buffer.get() + std::size(historical_values));
-		result[i] = Compress(buffer.get(), full_series_length, &output_buffer);
+		std::copy(ending.cbegin(), ending.cend(), buffer.get() + std::size(historical_values));
+		result.push_back(Compress(buffer.get(), full_series_length, &output_buffer));
 	}
 
 	return result;
 }
 
-ZstdCompressor::ZstdCompressor()
+ICompressionCheckpointPtr CompressorBase::MakeCheckpoint(const unsigned char*, size_t)
+{
+	return nullptr;
+}
+
+void CompressorBase::SetPruningSlack(std::optional<SizeInBits> slack_in_bits)
+{
+	pruning_slack_ = slack_in_bits;
+}
+
+ZstdCompressor::ZstdCompressor(int level)
+	: level_{level}
 {
 	if (context_ = ZSTD_createCCtx(); !context_)
 	{
@@ -63,7 +247,109 @@ ZstdCompressor::SizeInBits ZstdCompressor::Compress(
 	FitBuffer(dst_capacity, output_buffer);
 
 	return BytesToBits(
-		ZSTD_compressCCtx(context_, output_buffer->data(), output_buffer->size(), data, size, ZSTD_maxCLevel()));
+		ZSTD_compressCCtx(context_, output_buffer->data(), output_buffer->size(), data, size, level_));
+}
+
+std::unique_ptr<ICompressor> ZstdCompressor::Clone() const
+{
+	return std::make_unique<ZstdCompressor>(level_);
+}
+
+namespace
+{
+
+/**
+ * Passes all the data to the stream. The compressed data is written to the buffer by portions, only the size of it
+ * matters.
+ *
+ * \param[in,out] stream Initialized deflate stream.
+ * \param[in] data Data to compress.
+ * \param[in] size Size of the data.
+ * \param[in] flush Z_NO_FLUSH to continue compression later or Z_FINISH to complete the stream.
+ * \param[out] output_buffer Buffer for the compressed data.
+ */
+void Deflate(z_stream* stream, const unsigned char* data, size_t size, int flush, std::vector<unsigned char>* output_buffer)
+{
+	assert(stream != nullptr);
+	assert(output_buffer != nullptr && !output_buffer->empty());
+
+	stream->next_in = const_cast<unsigned char*>(data);
+	stream->avail_in = static_cast<uInt>(size);
+	int status = Z_OK;
+	do
+	{
+		stream->next_out = output_buffer->data();
+		stream->avail_out = static_cast<uInt>(output_buffer->size());
+		status = deflate(stream, flush);
+		if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+		{
+			throw CompressorsError{"zlib: an error is occured"};
+		}
+	} while (stream->avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+}
+
+} // namespace
+
+class ZlibCompressor::Checkpoint : public ICompressionCheckpoint
+{
+public:
+	/**
+	 * \param[in] stream The stream to copy the state from.
+	 * \param[in] output_buffer Buffer for the compressed data, which is shared by the forks of the checkpoint.
+	 */
+	Checkpoint(const z_stream& stream, std::shared_ptr<std::vector<unsigned char>> output_buffer)
+		: output_buffer_{std::move(output_buffer)}
+	{
+		if (deflateCopy(&stream_, const_cast<z_stream*>(&stream)) != Z_OK)
+		{
+			throw CompressorsError{"zlib: cannot copy the stream"};
+		}
+	}
+
+	Checkpoint(const Checkpoint&) = delete;
+	Checkpoint& operator=(const Checkpoint&) = delete;
+
+	~Checkpoint() override { deflateEnd(&stream_); }
+
+	ICompressionCheckpointPtr Fork() const override { return std::make_unique<Checkpoint>(stream_, output_buffer_); }
+
+	void Append(const unsigned char* data, size_t size) override
+	{
+		Deflate(&stream_, data, size, Z_NO_FLUSH, output_buffer_.get());
+	}
+
+	SizeInBits CodeLength() override
+	{
+		return Checkpoint{stream_, output_buffer_}.Finish();
+	}
+
+	SizeInBits Finish() override
+	{
+		Deflate(&stream_, nullptr, 0, Z_FINISH, output_buffer_.get());
+
+		return BytesToBits(stream_.total_out);
+	}
+
+	bool HasMonotoneCodeLengths() const override { return false; }
+
+private:
+	z_stream stream_{};
+	std::shared_ptr<std::vector<unsigned char>> output_buffer_;
+};
+
+ZlibCompressor::ZlibCompressor()
+	: checkpoints_output_buffer_{std::make_shared<std::vector<unsigned char>>(1 << 12)}
+{
+	// The same settings as in compress2.
+	if (deflateInit(&stream_, Z_BEST_COMPRESSION) != Z_OK)
+	{
+		throw CompressorsError{"cannot init zlib compressor"};
+	}
+}
+
+ZlibCompressor::~ZlibCompressor()
+{
+	deflateEnd(&stream_);
 }
 
 ZlibCompressor::SizeInBits ZlibCompressor::Compress(
@@ -71,14 +357,36 @@ ZlibCompressor::SizeInBits ZlibCompressor::Compress(
 	size_t size,
 	std::vector<unsigned char>* output_buffer)
 {
-	size_t dst_capacity = compressBound(size * sizeof(Symbol));
-	FitBuffer(dst_capacity, output_buffer);
-	if (compress2(output_buffer->data(), &dst_capacity, data, size, Z_BEST_COMPRESSION) != Z_OK)
+	assert(output_buffer);
+
+	if (deflateReset(&stream_) != Z_OK)
+	{
+		throw CompressorsError{"zlib: an error is occured"};
+	}
+	FitBuffer(deflateBound(&stream_, size), output_buffer);
+	Deflate(&stream_, data, size, Z_FINISH, output_buffer);
+
+	return BytesToBits(stream_.total_out);
+}
+
+ICompressionCheckpointPtr ZlibCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	if (size < kMinCheckpointedSize)
+	{
+		return nullptr;
+	}
+	if (deflateReset(&stream_) != Z_OK)
 	{
 		throw CompressorsError{"zlib: an error is occured"};
 	}
+	Deflate(&stream_, data, size, Z_NO_FLUSH, checkpoints_output_buffer_.get());
 
-	return BytesToBits(dst_capacity);
+	return std::make_unique<Checkpoint>(stream_, checkpoints_output_buffer_);
+}
+
+std::unique_ptr<ICompressor> ZlibCompressor::Clone() const
+{
+	return std::make_unique<ZlibCompressor>();
 }
 
 PpmCompressor::SizeInBits PpmCompressor::Compress(
@@ -92,9 +400,98 @@ PpmCompressor::SizeInBits PpmCompressor::Compress(
 	return BytesToBits(Ppmd::ppmd_compress(output_buffer->data(), output_buffer->size(), data, size));
 }
 
+class PpmCompressor::Checkpoint : public ICompressionCheckpoint
+{
+public:
+	Checkpoint(const unsigned char* data, size_t size)
+		: state_{data, size}
+	{
+		// DO NOTHING
+	}
+
+	ICompressionCheckpointPtr Fork() const override { return std::make_unique<Checkpoint>(*this); }
+
+	void Append(const unsigned char* data, size_t size) override { state_.append(data, size); }
+
+	SizeInBits CodeLength() override { return BytesToBits(state_.compressed_size()); }
+
+	bool HasMonotoneCodeLengths() const override { return false; }
+
+private:
+	Ppmd::encoder_state state_;
+};
+
+ICompressionCheckpointPtr PpmCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	return std::make_unique<Checkpoint>(data, size);
+}
+
+std::unique_ptr<ICompressor> PpmCompressor::Clone() const
+{
+	return std::make_unique<PpmCompressor>();
+}
+
 RpCompressor::SizeInBits RpCompressor::Compress(const unsigned char* data, size_t size, std::vector<unsigned char>*)
 {
-	return BytesToBits(Rp::rp_compress(data, size));
+	return BytesToBits(Rp::rp_compress(data, size, workspace_));
+}
+
+std::unique_ptr<ICompressor> RpCompressor::Clone() const
+{
+	return std::make_unique<RpCompressor>();
+}
+
+void* Bzip2Compressor::WorkMemory::Allocate(void* work_memory, int items_count, int item_size)
+{
+	assert(work_memory != nullptr);
+
+	auto& blocks = static_cast<WorkMemory*>(work_memory)->blocks_;
+	const auto size = static_cast<size_t>(items_count) * static_cast<size_t>(item_size);
+
+	// The smallest free block, which is large enough.
+	Block* suitable = nullptr;
+	for (auto& block : blocks)
+	{
+		if (!block.in_use && block.size >= size && (suitable == nullptr || block.size < suitable->size))
+		{
+			suitable = &block;
+		}
+	}
+	if (suitable == nullptr)
+	{
+		blocks.push_back({std::unique_ptr<char[]>(new (std::nothrow) char[size]), size, false});
+		suitable = &blocks.back();
+		if (suitable->memory == nullptr)
+		{
+			blocks.pop_back();
+			return nullptr;
+		}
+	}
+	suitable->in_use = true;
+
+	return suitable->memory.get();
+}
+
+void Bzip2Compressor::WorkMemory::Free(void* work_memory, void* address)
+{
+	assert(work_memory != nullptr);
+
+	for (auto& block : static_cast<WorkMemory*>(work_memory)->blocks_)
+	{
+		if (block.memory.get() == address)
+		{
+			block.in_use = false;
+			return;
+		}
+	}
+	assert(false);
+}
+
+Bzip2Compressor::Bzip2Compressor()
+{
+	stream_.bzalloc = &WorkMemory::Allocate;
+	stream_.bzfree = &WorkMemory::Free;
+	stream_.opaque = &work_memory_;
 }
 
 Bzip2Compressor::SizeInBits Bzip2Compressor::Compress(
@@ -105,112 +502,193 @@ Bzip2Compressor::SizeInBits Bzip2Compressor::Compress(
 	assert(output_buffer != nullptr);
 
 	// according to documentation, such capacity guaranties that the compressed data will fit in the buffer
-	std::unique_ptr<char[]> src(new char[size]);
-	std::copy(data, data + size, src.get());
 	uint dst_capacity = static_cast<uint>(size * sizeof(Symbol) + ceil(size * sizeof(Symbol) * 0.01) + 600);
 	FitBuffer(dst_capacity, output_buffer);
-	if (BZ2_bzBuffToBuffCompress(
-			reinterpret_cast<char*>(output_buffer->data()),
-			&dst_capacity,
-			src.get(),
-			static_cast<uint>(size),
-			9,
-			0,
-			30)
-		!= BZ_OK)
+
+	// The initial run-length encoding expands data at most by 5/4, and 19 bytes of a block are reserved.
+	constexpr size_t kMaxBlockSize = 9;
+	const auto block_size = static_cast<int>(std::min(kMaxBlockSize, (size + size / 4 + 19) / 100000 + 1));
+	if (BZ2_bzCompressInit(&stream_, block_size, 0, 30) != BZ_OK)
+	{
+		throw CompressorsError{"bzip2: an error occured"};
+	}
+
+	// bzip2 doesn't change the input, it's not const only because of the C interface.
+	stream_.next_in = reinterpret_cast<char*>(const_cast<unsigned char*>(data));
+	stream_.avail_in = static_cast<uint>(size);
+	stream_.next_out = reinterpret_cast<char*>(output_buffer->data());
+	stream_.avail_out = dst_capacity;
+	const auto status = BZ2_bzCompress(&stream_, BZ_FINISH);
+	const auto compressed_size = stream_.total_out_lo32;
+	BZ2_bzCompressEnd(&stream_);
+	if (status != BZ_STREAM_END)
 	{
 		throw CompressorsError{"bzip2: an error occured"};
 	}
 
-	return BytesToBits(dst_capacity);
+	return BytesToBits(compressed_size);
+}
+
+std::unique_ptr<ICompressor> Bzip2Compressor::Clone() const
+{
+	return std::make_unique<Bzip2Compressor>();
 }
 
 LcaCompressor::SizeInBits LcaCompressor::Compress(const unsigned char* data, size_t size, std::vector<unsigned char>*)
 {
-	return BytesToBits(Lcacomp::lcacomp_compress(data, size));
+	return BytesToBits(Lcacomp::lcacomp_compress(data, size, workspace_));
+}
+
+std::unique_ptr<ICompressor> LcaCompressor::Clone() const
+{
+	return std::make_unique<LcaCompressor>();
+}
+
+} // namespace itp
+
+void libzpaq::error(const char* msg)
+{
+	throw itp::CompressorsError{msg};
 }
 
+namespace itp
+{
+
 namespace
 {
 
-class ZpaqReader : public libzpaq::Reader
+/**
+ * A checkpoint of a compressor, whose model is shared by the checkpoint and all its forks. The checkpoint keeps only
+ * the symbols appended to it and moves the model to them, when the code length is requested. The model should provide
+ * SizeInBits MoveTo(const std::vector<unsigned char>& path) and bool kHasMonotoneCodeLengths.
+ */
+template<typename SharedModel>
+class SharedModelCheckpoint : public ICompressionCheckpoint
 {
 public:
-	ZpaqReader(const unsigned char* const data, const size_t size)
-		: data_{data}
-		, size_{size}
+	explicit SharedModelCheckpoint(std::shared_ptr<SharedModel> model)
+		: model_{std::move(model)}
 	{
 		// DO NOTHING
 	}
 
-	int get() override
-	{
-		if (curr_pos_ == size_)
-		{
-			return EOF;
-		}
-
-		return data_[curr_pos_++];
-	}
+	ICompressionCheckpointPtr Fork() const override { return std::make_unique<SharedModelCheckpoint>(*this); }
 
-	int read(char* buf, int n) override
-	{
-		if (curr_pos_ == size_)
-		{
-			return EOF;
-		}
+	void Append(const unsigned char* data, size_t size) override { path_.insert(std::end(path_), data, data + size); }
 
-		assert(0 <= n);
-		const auto bytes_to_read = std::min(static_cast<size_t>(n), size_ - curr_pos_);
-		std::copy(data_ + curr_pos_, data_ + curr_pos_ + bytes_to_read, buf);
-		curr_pos_ += bytes_to_read;
+	SizeInBits CodeLength() override { return model_->MoveTo(path_); }
 
-		return static_cast<int>(bytes_to_read);
-	}
+	bool HasMonotoneCodeLengths() const override { return SharedModel::kHasMonotoneCodeLengths; }
 
 private:
-	const unsigned char* const data_;
-	const size_t size_;
-	size_t curr_pos_ = 0;
+	std::shared_ptr<SharedModel> model_;
+	std::vector<unsigned char> path_;
 };
 
-class ZpaqWriter : public libzpaq::Writer
+} // namespace
+
+/**
+ * The model of zpaq after the data and the path of symbols appended to it. The model is moved to another path by
+ * restoring its state saved at the common prefix of the paths and appending the rest of the new path.
+ */
+class ZpaqCompressor::SharedModel
 {
 public:
-	void put(int) override { ++bytes_read_; }
+	static constexpr bool kHasMonotoneCodeLengths = false; // The size of the archive is rounded to bytes.
+
+	/**
+	 * Configures the model for the data, trains it on the data and forgets the path.
+	 */
+	void Reset(const unsigned char* data, size_t size)
+	{
+		model_.init(kMaxCompressionLevel, reinterpret_cast<const char*>(data), size);
+		path_.clear();
+		path_bits_.clear();
+		data_size_ = size;
+		data_bits_ = 0.0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			data_bits_ += model_.code(data[i]);
+		}
+	}
 
-	void write(const char*, int n) override
+	/**
+	 * Moves the model to the end of the path.
+	 *
+	 * \param[in] path Symbols appended to the data.
+	 *
+	 * \return Code length of the data and the path.
+	 */
+	SizeInBits MoveTo(const std::vector<unsigned char>& path)
 	{
-		assert(0 <= n);
-		bytes_read_ += static_cast<size_t>(n);
+		const auto common_prefix_length = static_cast<size_t>(
+			std::mismatch(std::cbegin(path_), std::cend(path_), std::cbegin(path), std::cend(path)).first
+			- std::cbegin(path_));
+		while (path_.size() > common_prefix_length)
+		{
+			model_.pop();
+			path_.pop_back();
+			path_bits_.pop_back();
+		}
+		for (auto i = common_prefix_length; i < path.size(); ++i)
+		{
+			model_.push();
+			path_.push_back(path[i]);
+			path_bits_.push_back((path_bits_.empty() ? 0.0 : path_bits_.back()) + model_.code(path[i]));
+		}
+
+		return CodeLength();
 	}
 
-	[[nodiscard]] size_t GetCompressedSize() const { return bytes_read_; }
+	/**
+	 * Returns the code length of the data and the current path.
+	 */
+	SizeInBits CodeLength() const
+	{
+		const auto bits = data_bits_ + (path_bits_.empty() ? 0.0 : path_bits_.back());
+
+		return static_cast<SizeInBits>(std::ceil(BytesToBits(1) * model_.size(data_size_ + path_.size(), bits)));
+	}
 
 private:
-	size_t bytes_read_ = 0;
+	static constexpr const char* kMaxCompressionLevel = "5";
+
+	libzpaq::Model model_;
+	size_t data_size_ = 0;
+	double data_bits_ = 0.0;
+	std::vector<unsigned char> path_;
+	std::vector<double> path_bits_; // path_bits_[i] is the cost of path_[0..i].
 };
 
-} // namespace
+ZpaqCompressor::SizeInBits ZpaqCompressor::Compress(const unsigned char* data, size_t size, std::vector<unsigned char>*)
+{
+	const auto model = AcquireModel();
+	model->Reset(data, size);
 
-} // namespace itp
+	return model->CodeLength();
+}
 
-void libzpaq::error(const char* msg)
+ICompressionCheckpointPtr ZpaqCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
 {
-	throw itp::CompressorsError{msg};
+	auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return std::make_unique<SharedModelCheckpoint<SharedModel>>(std::move(model));
 }
 
-namespace itp
+std::unique_ptr<ICompressor> ZpaqCompressor::Clone() const
 {
+	return std::make_unique<ZpaqCompressor>();
+}
 
-ZpaqCompressor::SizeInBits ZpaqCompressor::Compress(const unsigned char* data, size_t size, std::vector<unsigned char>*)
+std::shared_ptr<ZpaqCompressor::SharedModel> ZpaqCompressor::AcquireModel()
 {
-	const char* kMaxCompressionLevel = "5";
-	ZpaqReader reader{data, size};
-	ZpaqWriter writer;
-	libzpaq::compress(&reader, &writer, kMaxCompressionLevel);
+	if (!model_ || model_.use_count() > 1)
+	{
+		model_ = std::make_shared<SharedModel>();
+	}
 
-	return BytesToBits(writer.GetCompressedSize());
+	return model_;
 }
 
 AutomatonCompressor::AutomatonCompressor()
@@ -219,60 +697,729 @@ AutomatonCompressor::AutomatonCompressor()
 	// DO NOTHING
 }
 
-AutomatonCompressor::SizeInBits AutomatonCompressor::Compress(
-	const unsigned char* data,
-	size_t size,
-	std::vector<unsigned char>*)
+namespace
+{
+
+ICompressor::SizeInBits ToCodeLength(const AutomatonProbability& probability)
 {
-	auto probability = automaton->EvalProbability(PlainTimeSeries<Symbol>(data, data + size));
-	const auto code_length = ceil(-log2(probability));
+	const auto code_length = std::ceil(-probability.Log2Abs());
 
-	if (HighPrecDouble(std::numeric_limits<AutomatonCompressor::SizeInBits>::max()) < code_length)
+	if (static_cast<long double>(std::numeric_limits<ICompressor::SizeInBits>::max()) < code_length)
 	{
-		return std::numeric_limits<AutomatonCompressor::SizeInBits>::max();
+		return std::numeric_limits<ICompressor::SizeInBits>::max();
 	}
 
-	return static_cast<AutomatonCompressor::SizeInBits>(code_length);
+	return static_cast<ICompressor::SizeInBits>(code_length);
 }
 
-void AutomatonCompressor::SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol)
+} // namespace
+
+AutomatonCompressor::SizeInBits AutomatonCompressor::Compress(
+	const unsigned char* data,
+	size_t size,
+	std::vector<unsigned char>*)
 {
-	automaton->SetMinSymbol(alphabet_min_symbol);
-	automaton->SetMaxSymbol(alphabet_max_symbol);
+	return ToCodeLength(automaton->EvalProbability(PlainTimeSeries<Symbol>(data, data + size)));
 }
 
-void CompressorsPool::RegisterCompressor(std::string name, std::unique_ptr<ICompressor> compressor)
+class AutomatonCompressor::Checkpoint : public ICompressionCheckpoint
 {
-	if (name.empty())
+public:
+	Checkpoint(std::unique_ptr<PredictionAutomaton> automaton, SizeInBits code_length)
+		: automaton_{std::move(automaton)}
+		, code_length_{code_length}
 	{
-		throw CompressorsError{"RegisterCompressor: name is empty"};
+		// DO NOTHING
 	}
 
-	if (!compressor)
+	ICompressionCheckpointPtr Fork() const override
 	{
-		throw CompressorsError{"RegisterCompressor: compressor is nullptr"};
+		return std::make_unique<Checkpoint>(automaton_->Clone(), code_length_);
 	}
 
-	if (auto [compressor_iter, success] = compressor_instances_.emplace(std::move(name), std::move(compressor));
-		!success)
+	void Append(const unsigned char* data, size_t size) override
 	{
-		throw CompressorsError{"RegisterCompressor: trying to register already registered compressor"};
+		code_length_ = ToCodeLength(automaton_->EvalProbabilityOfExtended(data, size));
 	}
-}
 
-ICompressor::SizeInBits CompressorsPool::Compress(
-	const std::string& compressor_name,
-	const unsigned char* data,
-	size_t size)
-{
-	try
+	SizeInBits CodeLength() override { return code_length_; }
+
+	bool HasMonotoneCodeLengths() const override { return true; }
+
+private:
+	std::unique_ptr<PredictionAutomaton> automaton_;
+	SizeInBits code_length_;
+};
+
+ICompressionCheckpointPtr AutomatonCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	auto checkpoint_automaton = automaton->Clone();
+	const auto probability = checkpoint_automaton->EvalProbability(PlainTimeSeries<Symbol>(data, data + size));
+
+	return std::make_unique<Checkpoint>(std::move(checkpoint_automaton), ToCodeLength(probability));
+}
+
+void AutomatonCompressor::SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol)
+{
+	automaton->SetMinSymbol(alphabet_min_symbol);
+	automaton->SetMaxSymbol(alphabet_max_symbol);
+	alphabet_min_symbol_ = alphabet_min_symbol;
+	alphabet_max_symbol_ = alphabet_max_symbol;
+}
+
+std::unique_ptr<ICompressor> AutomatonCompressor::Clone() const
+{
+	auto clone = std::make_unique<AutomatonCompressor>();
+	clone->SetTsParams(alphabet_min_symbol_, alphabet_max_symbol_);
+
+	return clone;
+}
+
+class KtMixtureCompressor::SharedModel
+{
+public:
+	static constexpr bool kHasMonotoneCodeLengths = true;
+
+	SharedModel(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol, size_t max_order)
+		: alphabet_min_symbol_{alphabet_min_symbol}
+		, alphabet_size_{static_cast<size_t>(alphabet_max_symbol) - alphabet_min_symbol + 1}
+		, log2_alphabet_size_{std::log2(static_cast<long double>(alphabet_size_))}
+	{
+		// There are alphabet_size_^k contexts of order k.
+		size_t contexts_count = 1;
+		for (size_t order = 0; order <= max_order && contexts_count <= kMaxTableSize / alphabet_size_; ++order)
+		{
+			counts_.emplace_back(contexts_count * alphabet_size_);
+			totals_.emplace_back(contexts_count);
+			contexts_counts_.push_back(contexts_count);
+			contexts_count *= alphabet_size_;
+		}
+
+		// The weight of order k is 1 / log(k + 2) - 1 / log(k + 3), the weights of the orders above the maximal one
+		// are added to the weight of it.
+		const auto max_used_order = counts_.size() - 1;
+		for (size_t order = 0; order < max_used_order; ++order)
+		{
+			log_weights_.push_back(std::log2(1 / std::log2(order + 2.0L) - 1 / std::log2(order + 3.0L)));
+		}
+		log_weights_.push_back(-std::log2(std::log2(max_used_order + 2.0L)));
+
+		log_probabilities_.resize(counts_.size());
+	}
+
+	bool IsFor(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) const
+	{
+		return (alphabet_min_symbol_ == alphabet_min_symbol)
+			&& (alphabet_size_ == static_cast<size_t>(alphabet_max_symbol) - alphabet_min_symbol + 1);
+	}
+
+	/**
+	 * Forgets the previous data and the path and trains the model on the data.
+	 */
+	void Reset(const unsigned char* data, size_t size)
+	{
+		while (!history_.empty())
+		{
+			Uncount();
+		}
+		path_log_probabilities_.clear();
+		std::fill(std::begin(log_probabilities_), std::end(log_probabilities_), 0.0L);
+		for (size_t i = 0; i < size; ++i)
+		{
+			Count(data[i], false);
+		}
+		data_size_ = size;
+	}
+
+	/**
+	 * Moves the model to the end of the path.
+	 *
+	 * \param[in] path Symbols appended to the data.
+	 *
+	 * \return Code length of the data and the path.
+	 */
+	SizeInBits MoveTo(const std::vector<unsigned char>& path)
+	{
+		const auto path_begin = std::cbegin(history_) + data_size_;
+		const auto common_prefix_length = static_cast<size_t>(
+			std::mismatch(path_begin, std::cend(history_), std::cbegin(path), std::cend(path)).first - path_begin);
+		while (history_.size() > data_size_ + common_prefix_length)
+		{
+			Uncount();
+			log_probabilities_.assign(
+				std::cend(path_log_probabilities_) - log_probabilities_.size(),
+				std::cend(path_log_probabilities_));
+			path_log_probabilities_.resize(path_log_probabilities_.size() - log_probabilities_.size());
+		}
+		for (auto i = common_prefix_length; i < path.size(); ++i)
+		{
+			Count(path[i], true);
+		}
+
+		return CodeLength();
+	}
+
+	/**
+	 * Returns the code length of the data and the current path.
+	 */
+	SizeInBits CodeLength() const
+	{
+		const auto max_log = std::inner_product(
+			std::cbegin(log_probabilities_),
+			std::cend(log_probabilities_),
+			std::cbegin(log_weights_),
+			-std::numeric_limits<long double>::infinity(),
+			[](auto lhs, auto rhs) { return std::max(lhs, rhs); },
+			std::plus<>{});
+		long double sum = 0;
+		for (size_t order = 0; order < log_probabilities_.size(); ++order)
+		{
+			sum += std::exp2(log_probabilities_[order] + log_weights_[order] - max_log);
+		}
+
+		return static_cast<SizeInBits>(std::ceil(-(max_log + std::log2(sum))));
+	}
+
+private:
+	/**
+	 * Adds the symbol to the history, updates the estimates of all the orders and the counts. The estimates are saved,
+	 * if the symbol can be removed later.
+	 */
+	void Count(unsigned char symbol, bool can_be_removed)
+	{
+		if ((symbol < alphabet_min_symbol_) || (alphabet_size_ <= static_cast<size_t>(symbol - alphabet_min_symbol_)))
+		{
+			throw CompressorsError{"KtMixtureCompressor: the symbol is out of the alphabet"};
+		}
+		if (can_be_removed)
+		{
+			path_log_probabilities_.insert(
+				std::end(path_log_probabilities_),
+				std::cbegin(log_probabilities_),
+				std::cend(log_probabilities_));
+		}
+		const auto letter = static_cast<size_t>(symbol - alphabet_min_symbol_);
+
+		const auto position = history_.size();
+		size_t context = 0;
+		for (size_t order = 0; order < counts_.size(); ++order)
+		{
+			if (position < order)
+			{
+				// The first symbols have no context of the order and are encoded uniformly.
+				log_probabilities_[order] -= log2_alphabet_size_;
+				continue;
+			}
+			if (order > 0)
+			{
+				context += Letter(position - order) * contexts_counts_[order - 1];
+			}
+
+			auto& count = counts_[order][context * alphabet_size_ + letter];
+			auto& total = totals_[order][context];
+			log_probabilities_[order] += predictor_(count, total, alphabet_size_).Log2Abs();
+			++count;
+			++total;
+		}
+		history_.push_back(symbol);
+	}
+
+	/**
+	 * Removes the last symbol of the history from the counts. The estimates are restored by the caller.
+	 */
+	void Uncount()
+	{
+		const auto letter = Letter(history_.size() - 1);
+		history_.pop_back();
+
+		const auto position = history_.size();
+		size_t context = 0;
+		for (size_t order = 0; order < counts_.size() && order <= position; ++order)
+		{
+			if (order > 0)
+			{
+				context += Letter(position - order) * contexts_counts_[order - 1];
+			}
+			--counts_[order][context * alphabet_size_ + letter];
+			--totals_[order][context];
+		}
+	}
+
+	size_t Letter(size_t position) const { return history_[position] - alphabet_min_symbol_; }
+
+	Symbol alphabet_min_symbol_;
+	size_t alphabet_size_;
+	long double log2_alphabet_size_;
+	std::vector<std::vector<uint32_t>> counts_; // counts_[k][c * alphabet_size_ + s] is the count of s in context c.
+	std::vector<std::vector<uint32_t>> totals_; // totals_[k][c] is the count of context c.
+	std::vector<size_t> contexts_counts_; // contexts_counts_[k] is alphabet_size_^k.
+	std::vector<long double> log_weights_;
+	KrichevskyPredictor predictor_;
+
+	std::vector<unsigned char> history_;
+	size_t data_size_ = 0;
+	std::vector<long double> log_probabilities_; // log_probabilities_[k] is the log of the estimate of order k.
+	std::vector<long double> path_log_probabilities_; // The estimates before each symbol of the path.
+};
+
+KtMixtureCompressor::KtMixtureCompressor(size_t max_order)
+	: max_order_{max_order}
+{
+	// DO NOTHING
+}
+
+KtMixtureCompressor::SizeInBits KtMixtureCompressor::Compress(
+	const unsigned char* data,
+	size_t size,
+	std::vector<unsigned char>*)
+{
+	const auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return model->CodeLength();
+}
+
+ICompressionCheckpointPtr KtMixtureCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return std::make_unique<SharedModelCheckpoint<SharedModel>>(std::move(model));
+}
+
+void KtMixtureCompressor::SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol)
+{
+	alphabet_min_symbol_ = alphabet_min_symbol;
+	alphabet_max_symbol_ = alphabet_max_symbol;
+}
+
+std::unique_ptr<ICompressor> KtMixtureCompressor::Clone() const
+{
+	auto clone = std::make_unique<KtMixtureCompressor>(max_order_);
+	clone->SetTsParams(alphabet_min_symbol_, alphabet_max_symbol_);
+
+	return clone;
+}
+
+std::shared_ptr<KtMixtureCompressor::SharedModel> KtMixtureCompressor::AcquireModel()
+{
+	if (!model_ || model_.use_count() > 1 || !model_->IsFor(alphabet_min_symbol_, alphabet_max_symbol_))
+	{
+		model_ = std::make_shared<SharedModel>(alphabet_min_symbol_, alphabet_max_symbol_, max_order_);
+	}
+
+	return model_;
+}
+
+class CtwCompressor::SharedModel
+{
+public:
+	static constexpr bool kHasMonotoneCodeLengths = true;
+
+	SharedModel(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol, size_t depth)
+		: alphabet_min_symbol_{alphabet_min_symbol}
+		, alphabet_size_{static_cast<size_t>(alphabet_max_symbol) - alphabet_min_symbol + 1}
+	{
+		while ((size_t{1} << bits_per_symbol_) < alphabet_size_)
+		{
+			++bits_per_symbol_;
+		}
+		context_length_ = depth * bits_per_symbol_;
+		path_.resize(context_length_ + 1);
+	}
+
+	bool IsFor(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) const
+	{
+		return (alphabet_min_symbol_ == alphabet_min_symbol)
+			&& (alphabet_size_ == static_cast<size_t>(alphabet_max_symbol) - alphabet_min_symbol + 1);
+	}
+
+	/**
+	 * Forgets the previous data and the path and trains the model on the data.
+	 */
+	void Reset(const unsigned char* data, size_t size)
+	{
+		// The node 0 marks absent children, the nodes 1..2^b-1 are the roots of the trees of the decomposition.
+		nodes_.assign(size_t{1} << bits_per_symbol_, Node{});
+		history_.clear();
+		changes_.clear();
+		marks_.clear();
+		for (size_t i = 0; i < size; ++i)
+		{
+			Count(data[i], false);
+		}
+		data_size_ = size;
+	}
+
+	/**
+	 * Moves the model to the end of the path.
+	 *
+	 * \param[in] path Symbols appended to the data.
+	 *
+	 * \return Code length of the data and the path.
+	 */
+	SizeInBits MoveTo(const std::vector<unsigned char>& path)
+	{
+		const auto path_begin = std::cbegin(history_) + data_size_;
+		const auto common_prefix_length = static_cast<size_t>(
+			std::mismatch(path_begin, std::cend(history_), std::cbegin(path), std::cend(path)).first - path_begin);
+		while (history_.size() > data_size_ + common_prefix_length)
+		{
+			Uncount();
+		}
+		for (auto i = common_prefix_length; i < path.size(); ++i)
+		{
+			Count(path[i], true);
+		}
+
+		return CodeLength();
+	}
+
+	/**
+	 * Returns the code length of the data and the current path.
+	 */
+	SizeInBits CodeLength() const
+	{
+		double log_probability = 0.0;
+		for (size_t root = 1; root < (size_t{1} << bits_per_symbol_); ++root)
+		{
+			log_probability += nodes_[root].log_weighted;
+		}
+
+		return static_cast<SizeInBits>(std::ceil(-log_probability));
+	}
+
+private:
+	struct Node
+	{
+		uint32_t counts[2];
+		uint32_t children[2];
+		double log_estimate;
+		double log_weighted;
+	};
+
+	struct Change
+	{
+		size_t index;
+		Node node;
+	};
+
+	/**
+	 * The state of the model before a symbol of the path.
+	 */
+	struct Mark
+	{
+		size_t changes_count;
+		size_t nodes_count;
+	};
+
+	/**
+	 * Adds the symbol to the history and counts its bits in the trees of the decomposition. The bits, which are
+	 * determined by the previous ones for the alphabet, are not counted. The changes of the nodes are logged, if the
+	 * symbol can be removed later.
+	 */
+	void Count(unsigned char symbol, bool can_be_removed)
+	{
+		if ((symbol < alphabet_min_symbol_) || (alphabet_size_ <= static_cast<size_t>(symbol - alphabet_min_symbol_)))
+		{
+			throw CompressorsError{"CtwCompressor: the symbol is out of the alphabet"};
+		}
+		if (can_be_removed)
+		{
+			marks_.push_back({changes_.size(), nodes_.size()});
+		}
+		const auto letter = static_cast<size_t>(symbol - alphabet_min_symbol_);
+
+		size_t decomposition_node = 1;
+		for (auto shift = bits_per_symbol_; shift-- > 0;)
+		{
+			const auto bit = (letter >> shift) & 1;
+			if ((((letter >> shift) | 1) << shift) < alphabet_size_)
+			{
+				CountBit(decomposition_node, bit);
+			}
+			decomposition_node = 2 * decomposition_node + bit;
+		}
+		history_.push_back(symbol);
+	}
+
+	/**
+	 * Updates the nodes of the context of the bit in the tree with the specified root, the missing nodes are created.
+	 */
+	void CountBit(size_t root, size_t bit)
 	{
-		return compressor_instances_.at(compressor_name)->Compress(data, size, &output_buffer_);
+		const auto saved_nodes_count = marks_.empty() ? 0 : marks_.back().nodes_count;
+		path_[0] = root;
+		for (size_t level = 0; level <= context_length_; ++level)
+		{
+			const auto node = path_[level];
+			if (node < saved_nodes_count)
+			{
+				changes_.push_back({node, nodes_[node]});
+			}
+			if (level < context_length_)
+			{
+				const auto context_bit = ContextBit(level);
+				if (nodes_[node].children[context_bit] == 0)
+				{
+					nodes_[node].children[context_bit] = static_cast<uint32_t>(nodes_.size());
+					nodes_.push_back(Node{});
+				}
+				path_[level + 1] = nodes_[node].children[context_bit];
+			}
+		}
+
+		for (auto level = context_length_ + 1; level-- > 0;)
+		{
+			auto& node = nodes_[path_[level]];
+			node.log_estimate += static_cast<double>(
+				predictor_(node.counts[bit], node.counts[0] + node.counts[1], 2).Log2Abs());
+			++node.counts[bit];
+			if (level == context_length_)
+			{
+				node.log_weighted = node.log_estimate;
+			}
+			else
+			{
+				// Pw = (Pe + Pw0 * Pw1) / 2.
+				const auto log_children = LogWeighted(node.children[0]) + LogWeighted(node.children[1]);
+				const auto larger = std::max(node.log_estimate, log_children);
+				const auto smaller = std::min(node.log_estimate, log_children);
+				node.log_weighted = larger - 1.0 + std::log2(1.0 + std::exp2(smaller - larger));
+			}
+		}
 	}
-	catch (const std::out_of_range& e)
+
+	/**
+	 * Removes the last symbol of the path from the model.
+	 */
+	void Uncount()
 	{
-		throw CompressorsError{"Incorrect compressor name " + compressor_name};
+		const auto mark = marks_.back();
+		marks_.pop_back();
+		while (changes_.size() > mark.changes_count)
+		{
+			nodes_[changes_.back().index] = changes_.back().node;
+			changes_.pop_back();
+		}
+		nodes_.resize(mark.nodes_count);
+		history_.pop_back();
 	}
+
+	/**
+	 * Returns the bit of the context at the specified level of a tree. The levels go through the bits of the preceding
+	 * symbols from the high to the low ones, the symbols before the beginning of the data are zeros.
+	 */
+	size_t ContextBit(size_t level) const
+	{
+		const auto distance = level / bits_per_symbol_ + 1;
+		if (history_.size() < distance)
+		{
+			return 0;
+		}
+		const auto letter = static_cast<size_t>(history_[history_.size() - distance] - alphabet_min_symbol_);
+
+		return (letter >> (bits_per_symbol_ - 1 - level % bits_per_symbol_)) & 1;
+	}
+
+	double LogWeighted(uint32_t node) const { return (node == 0) ? 0.0 : nodes_[node].log_weighted; }
+
+	Symbol alphabet_min_symbol_;
+	size_t alphabet_size_;
+	size_t bits_per_symbol_ = 1;
+	size_t context_length_; // In bits.
+	KrichevskyPredictor predictor_;
+
+	std::vector<Node> nodes_;
+	std::vector<size_t> path_; // Nodes of the context of the current bit, from the root to the leaf.
+	std::vector<unsigned char> history_;
+	size_t data_size_ = 0;
+	std::vector<Change> changes_;
+	std::vector<Mark> marks_;
+};
+
+CtwCompressor::CtwCompressor(size_t depth)
+	: depth_{depth}
+{
+	// DO NOTHING
+}
+
+CtwCompressor::SizeInBits CtwCompressor::Compress(const unsigned char* data, size_t size, std::vector<unsigned char>*)
+{
+	const auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return model->CodeLength();
+}
+
+ICompressionCheckpointPtr CtwCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return std::make_unique<SharedModelCheckpoint<SharedModel>>(std::move(model));
+}
+
+void CtwCompressor::SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol)
+{
+	alphabet_min_symbol_ = alphabet_min_symbol;
+	alphabet_max_symbol_ = alphabet_max_symbol;
+}
+
+std::unique_ptr<ICompressor> CtwCompressor::Clone() const
+{
+	auto clone = std::make_unique<CtwCompressor>(depth_);
+	clone->SetTsParams(alphabet_min_symbol_, alphabet_max_symbol_);
+
+	return clone;
+}
+
+std::shared_ptr<CtwCompressor::SharedModel> CtwCompressor::AcquireModel()
+{
+	if (!model_ || model_.use_count() > 1 || !model_->IsFor(alphabet_min_symbol_, alphabet_max_symbol_))
+	{
+		model_ = std::make_shared<SharedModel>(alphabet_min_symbol_, alphabet_max_symbol_, depth_);
+	}
+
+	return model_;
+}
+
+class SequiturCompressor::SharedModel
+{
+public:
+	static constexpr bool kHasMonotoneCodeLengths = false; // Appending a symbol may shorten the grammar.
+
+	/**
+	 * Builds the grammar of the data and forgets the path.
+	 */
+	void Reset(const unsigned char* data, size_t size)
+	{
+		grammar_.clear();
+		for (size_t i = 0; i < size; ++i)
+		{
+			grammar_.append(data[i]);
+		}
+		path_.clear();
+	}
+
+	/**
+	 * Moves the grammar to the end of the path.
+	 *
+	 * \param[in] path Symbols appended to the data.
+	 *
+	 * \return Code length of the data and the path.
+	 */
+	SizeInBits MoveTo(const std::vector<unsigned char>& path)
+	{
+		const auto common_prefix_length = static_cast<size_t>(
+			std::mismatch(std::cbegin(path_), std::cend(path_), std::cbegin(path), std::cend(path)).first
+			- std::cbegin(path_));
+		while (path_.size() > common_prefix_length)
+		{
+			grammar_.pop();
+			path_.pop_back();
+		}
+		for (auto i = common_prefix_length; i < path.size(); ++i)
+		{
+			grammar_.push();
+			grammar_.append(path[i]);
+			path_.push_back(path[i]);
+		}
+
+		return CodeLength();
+	}
+
+	/**
+	 * Returns the code length of the data and the current path.
+	 */
+	SizeInBits CodeLength() const { return static_cast<SizeInBits>(std::ceil(grammar_.encoded_size())); }
+
+private:
+	Sequitur::grammar grammar_;
+	std::vector<unsigned char> path_;
+};
+
+SequiturCompressor::SizeInBits SequiturCompressor::Compress(
+	const unsigned char* data,
+	size_t size,
+	std::vector<unsigned char>*)
+{
+	const auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return model->CodeLength();
+}
+
+ICompressionCheckpointPtr SequiturCompressor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	auto model = AcquireModel();
+	model->Reset(data, size);
+
+	return std::make_unique<SharedModelCheckpoint<SharedModel>>(std::move(model));
+}
+
+std::unique_ptr<ICompressor> SequiturCompressor::Clone() const
+{
+	return std::make_unique<SequiturCompressor>();
+}
+
+std::shared_ptr<SequiturCompressor::SharedModel> SequiturCompressor::AcquireModel()
+{
+	if (!model_ || model_.use_count() > 1)
+	{
+		model_ = std::make_shared<SharedModel>();
+	}
+
+	return model_;
+}
+
+namespace
+{
+
+uint64_t MakeSettingsId()
+{
+	static std::atomic<uint64_t> last_settings_id = 0;
+	return ++last_settings_id;
+}
+
+} // namespace
+
+CompressorsPool::CompressorsPool()
+	: settings_id_{MakeSettingsId()}
+{
+	// DO NOTHING
+}
+
+void CompressorsPool::RegisterCompressor(std::string name, std::unique_ptr<ICompressor> compressor)
+{
+	if (name.empty())
+	{
+		throw CompressorsError{"RegisterCompressor: name is empty"};
+	}
+
+	if (!compressor)
+	{
+		throw CompressorsError{"RegisterCompressor: compressor is nullptr"};
+	}
+
+	Instance instance{std::move(compressor), std::make_shared<Guard>()};
+	if (auto [compressor_iter, success] = compressor_instances_.emplace(std::move(name), std::move(instance));
+		!success)
+	{
+		throw CompressorsError{"RegisterCompressor: trying to register already registered compressor"};
+	}
+}
+
+ICompressor::SizeInBits CompressorsPool::Compress(
+	const std::string& compressor_name,
+	const unsigned char* data,
+	size_t size)
+{
+	const auto& instance = GetInstance(compressor_name);
+	std::lock_guard lock{instance.guard->mutex};
+	ApplySettings(instance);
+
+	return instance.compressor->Compress(data, size, &output_buffer_);
 }
 
 std::vector<ICompressor::SizeInBits> CompressorsPool::CompressContinuations(
@@ -280,22 +1427,236 @@ std::vector<ICompressor::SizeInBits> CompressorsPool::CompressContinuations(
 	const std::vector<Symbol>& historical_values,
 	const ICompressor::Continuations& possible_continuations)
 {
-	try
+	const auto& instance = GetInstance(compressor_name);
+	std::lock_guard lock{instance.guard->mutex};
+	ApplySettings(instance);
+
+	return instance.compressor->CompressContinuations(historical_values, possible_continuations);
+}
+
+/**
+ * A checkpoint of a compressor of the pool. The compressor may be shared with other pools and its checkpoints may use
+ * it, so each call locks the compressor and gives it the settings of the pool.
+ */
+class CompressorsPool::Checkpoint : public ICompressionCheckpoint
+{
+public:
+	Checkpoint(const CompressorsPool* pool, Instance instance, ICompressionCheckpointPtr checkpoint)
+		: pool_{pool}
+		, instance_{std::move(instance)}
+		, checkpoint_{std::move(checkpoint)}
 	{
-		return compressor_instances_.at(compressor_name)
-			->CompressContinuations(historical_values, possible_continuations);
+		// DO NOTHING
 	}
-	catch (const std::out_of_range& e)
+
+	ICompressionCheckpointPtr Fork() const override
 	{
-		throw CompressorsError{"Incorrect compressor name " + compressor_name};
+		std::lock_guard lock{instance_.guard->mutex};
+		pool_->ApplySettings(instance_);
+
+		return std::make_unique<Checkpoint>(pool_, instance_, checkpoint_->Fork());
 	}
+
+	void Append(const unsigned char* data, size_t size) override
+	{
+		std::lock_guard lock{instance_.guard->mutex};
+		pool_->ApplySettings(instance_);
+		checkpoint_->Append(data, size);
+	}
+
+	SizeInBits CodeLength() override
+	{
+		std::lock_guard lock{instance_.guard->mutex};
+		pool_->ApplySettings(instance_);
+
+		return checkpoint_->CodeLength();
+	}
+
+	SizeInBits Finish() override
+	{
+		std::lock_guard lock{instance_.guard->mutex};
+		pool_->ApplySettings(instance_);
+
+		return checkpoint_->Finish();
+	}
+
+	bool HasMonotoneCodeLengths() const override { return checkpoint_->HasMonotoneCodeLengths(); }
+
+private:
+	const CompressorsPool* pool_;
+	Instance instance_;
+	ICompressionCheckpointPtr checkpoint_;
+};
+
+ICompressionCheckpointPtr CompressorsPool::MakeCheckpoint(
+	const std::string& compressor_name,
+	const unsigned char* data,
+	size_t size)
+{
+	const auto& instance = GetInstance(compressor_name);
+	std::lock_guard lock{instance.guard->mutex};
+	ApplySettings(instance);
+	auto checkpoint = instance.compressor->MakeCheckpoint(data, size);
+	if (!checkpoint)
+	{
+		return nullptr;
+	}
+
+	return std::make_unique<Checkpoint>(this, instance, std::move(checkpoint));
 }
 
 void CompressorsPool::SetAlphabetDescription(AlphabetDescription alphabet_description)
 {
-	for (auto& [name, compressor] : compressor_instances_)
+	alphabet_description_ = alphabet_description;
+	settings_id_ = MakeSettingsId();
+	ApplySettingsToOwnCompressors();
+}
+
+void CompressorsPool::SetPruningSlack(std::optional<ICompressor::SizeInBits> slack_in_bits)
+{
+	pruning_slack_ = slack_in_bits;
+	settings_id_ = MakeSettingsId();
+	ApplySettingsToOwnCompressors();
+}
+
+CompressorsFacadePtr CompressorsPool::Clone() const
+{
+	auto to_return = std::make_shared<CompressorsPool>();
+	to_return->alphabet_description_ = alphabet_description_;
+	to_return->pruning_slack_ = pruning_slack_;
+	for (const auto& [name, instance] : compressor_instances_)
 	{
-		compressor->SetTsParams(alphabet_description.min_symbol, alphabet_description.max_symbol);
+		std::unique_ptr<ICompressor> clone;
+		if (instance.guard->cloneable)
+		{
+			std::lock_guard lock{instance.guard->mutex};
+			clone = instance.compressor->Clone();
+		}
+
+		if (clone)
+		{
+			to_return->compressor_instances_.emplace(name, Instance{std::move(clone), std::make_shared<Guard>()});
+		}
+		else
+		{
+			instance.guard->cloneable = false;
+			to_return->compressor_instances_.emplace(name, instance);
+		}
+	}
+
+	return to_return;
+}
+
+const CompressorsPool::Instance& CompressorsPool::GetInstance(const std::string& compressor_name) const
+{
+	if (const auto iter = compressor_instances_.find(compressor_name); iter != std::cend(compressor_instances_))
+	{
+		return iter->second;
+	}
+
+	throw CompressorsError{"Incorrect compressor name " + compressor_name};
+}
+
+void CompressorsPool::ApplySettingsToOwnCompressors()
+{
+	for (const auto& [name, instance] : compressor_instances_)
+	{
+		// A compressor, which was never found uncloneable, is used by this pool only, so its lock is free. The shared
+		// ones are not waited for, they get the settings before their next use by this pool.
+		if (instance.guard->cloneable)
+		{
+			std::lock_guard lock{instance.guard->mutex};
+			ApplySettings(instance);
+		}
+	}
+}
+
+void CompressorsPool::ApplySettings(const Instance& instance) const
+{
+	if (instance.guard->settings_id == settings_id_)
+	{
+		return;
+	}
+
+	if (alphabet_description_)
+	{
+		instance.compressor->SetTsParams(alphabet_description_->min_symbol, alphabet_description_->max_symbol);
+	}
+	instance.compressor->SetPruningSlack(pruning_slack_);
+	instance.guard->settings_id = settings_id_;
+}
+
+CompressorsLeasingPool::CompressorsLeasingPool(CompressorsFacadePtr prototype)
+	: prototype_{std::move(prototype)}
+{
+	// DO NOTHING
+}
+
+CompressorsFacadePtr CompressorsLeasingPool::Lease()
+{
+	return Lease(1).front();
+}
+
+std::vector<CompressorsFacadePtr> CompressorsLeasingPool::Lease(size_t count)
+{
+	std::vector<CompressorsFacadePtr> facades;
+	CompressorsFacadePtr prototype;
+	size_t generation;
+	{
+		std::lock_guard lock{mutex_};
+		generation = generation_;
+		prototype = prototype_;
+		while (std::size(facades) < count && !idle_facades_.empty())
+		{
+			facades.push_back(std::move(idle_facades_.back()));
+			idle_facades_.pop_back();
+		}
+	}
+
+	// Cloning waits for the compressors, which are in use, so it is done out of the lock to not block other leases.
+	while (std::size(facades) < count)
+	{
+		facades.push_back(prototype->Clone());
+	}
+
+	for (auto& facade : facades)
+	{
+		auto* const leased = facade.get();
+		facade = CompressorsFacadePtr{
+			leased,
+			[this, facade = std::move(facade), generation](CompressorsFacade*) mutable {
+				Release(std::move(facade), generation);
+			}};
+	}
+
+	return facades;
+}
+
+void CompressorsLeasingPool::RegisterCompressor(std::string name, std::unique_ptr<ICompressor> compressor)
+{
+	// The prototype is replaced rather than changed, because it may be cloned by Lease concurrently.
+	std::lock_guard registration_lock{registration_mutex_};
+	CompressorsFacadePtr prototype;
+	{
+		std::lock_guard lock{mutex_};
+		prototype = prototype_;
+	}
+
+	auto new_prototype = prototype->Clone();
+	new_prototype->RegisterCompressor(std::move(name), std::move(compressor));
+
+	std::lock_guard lock{mutex_};
+	prototype_ = std::move(new_prototype);
+	idle_facades_.clear();
+	++generation_;
+}
+
+void CompressorsLeasingPool::Release(CompressorsFacadePtr facade, size_t generation)
+{
+	std::lock_guard lock{mutex_};
+	if (generation == generation_)
+	{
+		idle_facades_.push_back(std::move(facade));
 	}
 }
 
@@ -306,11 +1667,18 @@ CompressorsFacadePtr MakeStandardCompressorsPool()
 	to_return->RegisterCompressor("lcacomp", std::make_unique<LcaCompressor>());
 	to_return->RegisterCompressor("rp", std::make_unique<RpCompressor>());
 	to_return->RegisterCompressor("zstd", std::make_unique<ZstdCompressor>());
+	for (const int level : {1, 3, 6, 9, 12, 19})
+	{
+		to_return->RegisterCompressor("zstd" + std::to_string(level), std::make_unique<ZstdCompressor>(level));
+	}
 	to_return->RegisterCompressor("bzip2", std::make_unique<Bzip2Compressor>());
 	to_return->RegisterCompressor("zlib", std::make_unique<ZlibCompressor>());
 	to_return->RegisterCompressor("ppmd", std::make_unique<PpmCompressor>());
 	to_return->RegisterCompressor("automaton", std::make_unique<AutomatonCompressor>());
 	to_return->RegisterCompressor("zpaq", std::make_unique<ZpaqCompressor>());
+	to_return->RegisterCompressor("kt", std::make_unique<KtMixtureCompressor>());
+	to_return->RegisterCompressor("ctw", std::make_unique<CtwCompressor>());
+	to_return->RegisterCompressor("sequitur", std::make_unique<SequiturCompressor>());
 
 	return to_return;
 }
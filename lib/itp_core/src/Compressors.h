@@ -14,12 +14,17 @@
 #include <libzpaq.h>
 #include <ppmd.h>
 #include <rp.h>
+#include <sequitur.h>
 #include <zlib.h>
 #include <zstd.h>
 
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <unordered_map>
 
@@ -58,10 +63,18 @@ public:
 		// DO NOTHING
 	};
 
+	/**
+	 * If the compressor supports checkpoints, compresses the historical values only once and then processes only
+	 * the continuations. Otherwise, compresses each concatenation of the history and a continuation from scratch.
+	 */
 	std::vector<SizeInBits> CompressContinuations(
 		const std::vector<Symbol>& historical_values,
 		const Continuations& possible_endings) override;
 
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	void SetPruningSlack(std::optional<SizeInBits> slack_in_bits) override;
+
 protected:
 	/**
 	 * Allocates memory for output data if it's not enough.
@@ -76,54 +89,171 @@ protected:
 			output_buffer->resize(desired_size);
 		}
 	}
+
+private:
+	std::optional<SizeInBits> pruning_slack_ = std::nullopt;
 };
 
+/**
+ * Compresses data at the specified level. Low levels are much faster on short data, the maximal one is the default.
+ */
 class ZstdCompressor : public CompressorBase
 {
 public:
-	ZstdCompressor();
+	explicit ZstdCompressor(int level = ZSTD_maxCLevel());
 	~ZstdCompressor() override;
 
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
 
+	std::unique_ptr<ICompressor> Clone() const override;
+
 private:
+	int level_;
 	ZSTD_CCtx* context_ = nullptr;
 };
 
+/**
+ * Keeps one deflate stream, which is reset between calls instead of being allocated and initialized for each call.
+ */
 class ZlibCompressor : public CompressorBase
 {
 public:
+	ZlibCompressor();
+	~ZlibCompressor() override;
+
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	/**
+	 * The state of the stream is duplicated with deflateCopy, so continuations of the data are compressed without
+	 * processing the data again. A copy of the state takes about 256 KB, so for data shorter than
+	 * kMinCheckpointedSize it is cheaper to compress every continuation from scratch, and nullptr is returned.
+	 */
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+	static constexpr size_t kMinCheckpointedSize = 1 << 12;
+
+private:
+	class Checkpoint;
+
+	z_stream stream_{};
+	std::shared_ptr<std::vector<unsigned char>> checkpoints_output_buffer_;
 };
 
 class PpmCompressor : public CompressorBase
 {
 public:
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	/**
+	 * The model is trained on the data once, and its forks encode only the symbols appended to them.
+	 */
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+private:
+	class Checkpoint;
 };
 
+/**
+ * Keeps the text, the array of its positions and the priority queues of Re-Pair between calls, so a call for a short
+ * series costs as much as the compression itself, not as the allocation of the tables.
+ */
 class RpCompressor : public CompressorBase
 {
 public:
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+private:
+	Rp::workspace workspace_;
 };
 
+/**
+ * Keeps the work arrays of bzip2 between calls instead of allocating them for each compressed series. The block size
+ * is the minimal one, which still keeps the data in a single block, so the code lengths are the same as with the
+ * maximal block size, but less memory is touched.
+ */
 class Bzip2Compressor : public CompressorBase
 {
 public:
+	Bzip2Compressor();
+
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+private:
+	/**
+	 * Memory, which is requested by bzip2 and is not released until the compressor is destroyed.
+	 */
+	class WorkMemory
+	{
+	public:
+		static void* Allocate(void* work_memory, int items_count, int item_size);
+		static void Free(void* work_memory, void* address);
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<char[]> memory;
+			size_t size;
+			bool in_use;
+		};
+
+		std::vector<Block> blocks_;
+	};
+
+	WorkMemory work_memory_;
+	bz_stream stream_{};
 };
 
+/**
+ * Reads the series directly and only counts the bits of the encoded grammar. The dictionary of the grammar is kept
+ * between calls.
+ */
 class LcaCompressor : public CompressorBase
 {
 public:
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+private:
+	Lcacomp::workspace workspace_;
 };
 
+/**
+ * Computes the code length of the maximal compression level of zpaq from the bit probabilities of its predictor, the
+ * arithmetic coding itself is skipped. The model, which takes about 80 MB, is built once and only reset between calls
+ * while the data selects the same configuration of it.
+ */
 class ZpaqCompressor : public CompressorBase
 {
 public:
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	/**
+	 * The model is configured for and trained on the data once. The checkpoint and its forks share the model and
+	 * move it between their continuations: the states of the model are saved at each appended symbol by logging the
+	 * changes of it, so a fork costs only the symbols appended to it instead of a copy of the model.
+	 */
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+private:
+	class SharedModel;
+
+	/**
+	 * Returns the model, which is not used by any checkpoint. A new one is created if the current one is.
+	 */
+	std::shared_ptr<SharedModel> AcquireModel();
+
+	std::shared_ptr<SharedModel> model_;
 };
 
 class AutomatonCompressor : public CompressorBase
@@ -133,10 +263,131 @@ public:
 
 	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
 
+	/**
+	 * The automaton is suspended at the end of the data, its forks are resumed on the appended symbols only.
+	 */
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
 	void SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) override;
 
+	std::unique_ptr<ICompressor> Clone() const override;
+
 private:
+	class Checkpoint;
+
 	PredictionAutomatonPtr automaton;
+	Symbol alphabet_min_symbol_ = 0;
+	Symbol alphabet_max_symbol_ = 255;
+};
+
+/**
+ * Computes the code length of the R-measure, i.e. of the mixture of the Krichevsky-Trofimov estimates of the orders
+ * from 0 to the maximal one. For more details, see
+ * Ryabko B. (1988) Prediction of random sequences and universal coding.
+ *   Problems Inform. Transmission. Vol. 24 pp. 87-96.
+ *
+ * The counts of symbols are kept in tables indexed directly by contexts, so the code length is exact and costs O(k)
+ * per symbol. Orders, whose tables would exceed kMaxTableSize for the alphabet, are not used. Like the model of zpaq,
+ * the model is shared by a checkpoint and its forks: appended symbols are removed by decrementing their counts.
+ */
+class KtMixtureCompressor : public CompressorBase
+{
+public:
+	explicit KtMixtureCompressor(size_t max_order = kDefaultMaxOrder);
+
+	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	void SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+	static constexpr size_t kDefaultMaxOrder = 8;
+	static constexpr size_t kMaxTableSize = 1 << 20;
+
+private:
+	class SharedModel;
+
+	/**
+	 * Returns the model for the current alphabet, which is not used by any checkpoint. A new one is created if the
+	 * current one is used or was created for another alphabet.
+	 */
+	std::shared_ptr<SharedModel> AcquireModel();
+
+	size_t max_order_;
+	Symbol alphabet_min_symbol_ = 0;
+	Symbol alphabet_max_symbol_ = 255;
+	std::shared_ptr<SharedModel> model_;
+};
+
+/**
+ * Computes the code length of Context Tree Weighting. For more details, see
+ * Willems F., Shtarkov Y., Tjalkens T. (1995) The context-tree weighting method: basic properties.
+ *   IEEE Transactions on Information Theory. Vol. 41 pp. 653-664.
+ *
+ * Symbols are decomposed into bits, each node of the decomposition has its own binary context tree. The contexts are
+ * the bits of the preceding symbols, the depth of the trees is specified in symbols. The nodes of all the trees are
+ * kept in a single array. Like the model of zpaq, the model is shared by a checkpoint and its forks: the nodes changed
+ * by appended symbols are logged and restored, when the symbols are removed.
+ */
+class CtwCompressor : public CompressorBase
+{
+public:
+	explicit CtwCompressor(size_t depth = kDefaultDepth);
+
+	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	void SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+	static constexpr size_t kDefaultDepth = 8;
+
+private:
+	class SharedModel;
+
+	/**
+	 * Returns the model for the current alphabet, which is not used by any checkpoint. A new one is created if the
+	 * current one is used or was created for another alphabet.
+	 */
+	std::shared_ptr<SharedModel> AcquireModel();
+
+	size_t depth_;
+	Symbol alphabet_min_symbol_ = 0;
+	Symbol alphabet_max_symbol_ = 255;
+	std::shared_ptr<SharedModel> model_;
+};
+
+/**
+ * Computes the encoded size of the grammar, which Sequitur builds for the data (see Sequitur::grammar for the
+ * estimate). For more details, see
+ * Nevill-Manning C., Witten I. (1997) Identifying hierarchical structure in sequences: a linear-time algorithm.
+ *   Journal of Artificial Intelligence Research. Vol. 7 pp. 67-82.
+ *
+ * Sequitur builds the grammar online, so the grammar of the data is built once per checkpoint and shared by its forks
+ * as the models of zpaq and CTW are: the changes made by appended symbols are logged and undone to remove them.
+ */
+class SequiturCompressor : public CompressorBase
+{
+public:
+	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>* output_buffer) override;
+
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	std::unique_ptr<ICompressor> Clone() const override;
+
+private:
+	class SharedModel;
+
+	/**
+	 * Returns the model, which is not used by any checkpoint. A new one is created if the current one is used.
+	 */
+	std::shared_ptr<SharedModel> AcquireModel();
+
+	std::shared_ptr<SharedModel> model_;
 };
 
 /**
@@ -182,6 +433,23 @@ public:
 		const ICompressor::Continuations& possible_continuations)
 		= 0;
 
+	/**
+	 * Compresses data by the specified compressor and keeps its state to continue compression later (see
+	 * ICompressor::MakeCheckpoint). The checkpoint and its forks must be used by the user of the facade only, while the
+	 * settings of the facade are not changed.
+	 *
+	 * \param[in] compressor_name The name of data compression algorithm to use.
+	 * \param[in] data Buffer with data to compress.
+	 * \param[in] size Size of the data in the buffer.
+	 *
+	 * \return The state of the compressor after processing the data or nullptr if checkpoints are not supported.
+	 */
+	virtual ICompressionCheckpointPtr MakeCheckpoint(
+		const std::string& compressor_name,
+		const unsigned char* data,
+		size_t size)
+		= 0;
+
 	/**
 	 * Some compressors need to know the size of the alphabet. This method allows to specify it before compressing
 	 * a series.
@@ -189,6 +457,23 @@ public:
 	 * \param[in] alphabet_description Minimal and maximal letters of the integer alphabet.
 	 */
 	virtual void SetAlphabetDescription(AlphabetDescription alphabet_description) = 0;
+
+	/**
+	 * Enables the branch-and-bound evaluation of continuations for all the compressors (see
+	 * ICompressor::SetPruningSlack).
+	 *
+	 * \param[in] slack_in_bits The slack or std::nullopt to evaluate all the continuations.
+	 */
+	virtual void SetPruningSlack(std::optional<ICompressor::SizeInBits> slack_in_bits) = 0;
+
+	/**
+	 * Creates a facade with the same set of compressors, which can be used from another thread concurrently with
+	 * this one. Compressors, which cannot be duplicated, are shared between the facades and calls to them are
+	 * serialized, each facade sets its own alphabet and pruning slack to such a compressor before using it.
+	 *
+	 * \return The new facade.
+	 */
+	virtual std::shared_ptr<CompressorsFacade> Clone() const = 0;
 };
 using CompressorsFacadePtr = std::shared_ptr<CompressorsFacade>;
 
@@ -198,6 +483,8 @@ using CompressorsFacadePtr = std::shared_ptr<CompressorsFacade>;
 class CompressorsPool : public CompressorsFacade
 {
 public:
+	CompressorsPool();
+
 	void RegisterCompressor(std::string name, std::unique_ptr<ICompressor> compressor) override;
 
 	ICompressor::SizeInBits Compress(const std::string& compressor_name, const unsigned char* data, size_t size)
@@ -208,13 +495,107 @@ public:
 		const std::vector<Symbol>& historical_values,
 		const ICompressor::Continuations& possible_continuations) override;
 
+	ICompressionCheckpointPtr MakeCheckpoint(const std::string& compressor_name, const unsigned char* data, size_t size)
+		override;
+
 	void SetAlphabetDescription(AlphabetDescription alphabet_description) override;
 
+	void SetPruningSlack(std::optional<ICompressor::SizeInBits> slack_in_bits) override;
+
+	CompressorsFacadePtr Clone() const override;
+
 private:
-	std::unordered_map<std::string, std::unique_ptr<ICompressor>> compressor_instances_;
+	/**
+	 * The state of a compressor, which is shared by all pools using the same instance, i.e. it is actually
+	 * contended only for compressors, which cannot be cloned.
+	 */
+	struct Guard
+	{
+		std::mutex mutex;
+
+		// Guarded by the mutex: the settings of which pool the compressor has (see CompressorsPool::settings_id_).
+		uint64_t settings_id = 0;
+
+		// Set by the first Clone, which found that the compressor cannot be cloned, so the next ones do not lock it.
+		std::atomic<bool> cloneable = true;
+	};
+
+	struct Instance
+	{
+		std::shared_ptr<ICompressor> compressor;
+		std::shared_ptr<Guard> guard;
+	};
+
+	class Checkpoint;
+
+	const Instance& GetInstance(const std::string& compressor_name) const;
+
+	/**
+	 * Gives the settings of the pool to the compressor, unless it has them already. Must be called under the lock of
+	 * the instance, so another pool sharing the compressor cannot change them before the compression.
+	 */
+	void ApplySettings(const Instance& instance) const;
+
+	void ApplySettingsToOwnCompressors();
+
+	std::unordered_map<std::string, Instance> compressor_instances_;
 	std::vector<unsigned char> output_buffer_;
+
+	std::optional<AlphabetDescription> alphabet_description_;
+	std::optional<ICompressor::SizeInBits> pruning_slack_;
+	uint64_t settings_id_; // Unique among all pools, changed by each change of the settings.
 };
 
+/**
+ * Leases facades with the same set of compressors to concurrent users. A leased facade is used by its user only and
+ * is kept for the next lease after it is released, so facades are cloned from the prototype once per concurrent user
+ * rather than once per call.
+ */
+class CompressorsLeasingPool
+{
+public:
+	explicit CompressorsLeasingPool(CompressorsFacadePtr prototype);
+
+	/**
+	 * Returns an idle facade or a new clone of the prototype. The facade is released, when the last copy of the
+	 * returned pointer is destroyed, so the copies must not outlive the pool.
+	 *
+	 * \return The leased facade.
+	 */
+	CompressorsFacadePtr Lease();
+
+	/**
+	 * Leases facades for the workers of one forecast, see Lease().
+	 *
+	 * \param[in] count Number of facades to lease.
+	 *
+	 * \return The leased facades, they are different.
+	 */
+	std::vector<CompressorsFacadePtr> Lease(size_t count);
+
+	/**
+	 * Adds new compressor to the prototype. The facades cloned before are discarded instead of being leased again.
+	 *
+	 * \param[in] name The name which will be used for later access.
+	 * \param[in] compressor The instance of the new compressor.
+	 */
+	void RegisterCompressor(std::string name, std::unique_ptr<ICompressor> compressor);
+
+private:
+	void Release(CompressorsFacadePtr facade, size_t generation);
+
+	std::mutex registration_mutex_;
+	std::mutex mutex_;
+	CompressorsFacadePtr prototype_;
+	std::vector<CompressorsFacadePtr> idle_facades_;
+	size_t generation_ = 0; // Incremented by each registration.
+};
+
+/**
+ * Creates a pool with all integrated compressors. Besides "zstd", which works at the maximal level, zstd is available
+ * at the levels 1, 3, 6, 9, 12 and 19 with the names like "zstd3", so the trade-off between speed and compression can
+ * be chosen by the names of the compressors passed to a predictor.
+ */
 CompressorsFacadePtr MakeStandardCompressorsPool();
 
 } // namespace itp
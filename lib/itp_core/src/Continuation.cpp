@@ -1,11 +1,18 @@
 #include "Continuation.h"
 
 #include <cassert>
+#include <limits>
+#include <stdexcept>
 
 namespace itp
 {
 
 bool Increment(std::vector<Symbol>& sequence, size_t min, size_t max)
+{
+	return Increment(sequence.data(), sequence.data() + sequence.size(), min, max);
+}
+
+bool Increment(Symbol* first, Symbol* last, size_t min, size_t max)
 {
 	if (min > max)
 	{
@@ -16,30 +23,167 @@ bool Increment(std::vector<Symbol>& sequence, size_t min, size_t max)
 	}
 
 	assert(max <= 10000);
-	assert(sequence.size() > 0);
+	assert(first < last);
 
-	for (size_t i = 0; i < sequence.size(); ++i)
+	for (auto it = first; it != last; ++it)
 	{
-		if (sequence[i] < min)
+		if (*it < min)
 		{
 			throw std::invalid_argument(
 				"In increment function: passed sequence has an element less"
 				"than minimal value: "_s
-				+ std::to_string(sequence[i]) + " while min is: " + std::to_string(min) + ".");
+				+ std::to_string(*it) + " while min is: " + std::to_string(min) + ".");
 		}
 
-		if (sequence[i] + 1 < max)
+		if (*it + 1 < max)
 		{
-			++sequence[i];
+			++*it;
 			return true;
 		}
 
-		sequence[i] = min;
+		*it = min;
 	}
 
 	return false;
 }
 
+ContinuationsRange::Iterator::Iterator(const Continuation<Symbol>& continuation, size_t rank)
+	: continuation_{continuation}
+	, rank_{rank}
+{
+	// DO NOTHING
+}
+
+ContinuationsRange::Iterator::reference ContinuationsRange::Iterator::operator*() const
+{
+	return continuation_;
+}
+
+ContinuationsRange::Iterator::pointer ContinuationsRange::Iterator::operator->() const
+{
+	return &continuation_;
+}
+
+ContinuationsRange::Iterator& ContinuationsRange::Iterator::operator++()
+{
+	++continuation_;
+	++rank_;
+	return *this;
+}
+
+ContinuationsRange::Iterator ContinuationsRange::Iterator::operator++(int)
+{
+	auto tmp = *this;
+	++*this;
+	return tmp;
+}
+
+bool ContinuationsRange::Iterator::operator==(const Iterator& other) const
+{
+	return rank_ == other.rank_;
+}
+
+bool ContinuationsRange::Iterator::operator!=(const Iterator& other) const
+{
+	return !(*this == other);
+}
+
+ContinuationsRange::ContinuationsRange(size_t alphabet, size_t length)
+	: ContinuationsRange(alphabet, length, 0, 0)
+{
+	last_rank_ = 1;
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (last_rank_ > std::numeric_limits<size_t>::max() / alphabet)
+		{
+			throw std::overflow_error("In ContinuationsRange: the number of continuations does not fit in size_t.");
+		}
+		last_rank_ *= alphabet;
+	}
+}
+
+ContinuationsRange::ContinuationsRange(size_t alphabet, size_t length, size_t first_rank, size_t last_rank)
+	: alphabet_{alphabet}
+	, length_{length}
+	, first_rank_{first_rank}
+	, last_rank_{last_rank}
+{
+	if (alphabet_ == 0)
+	{
+		throw std::invalid_argument("In ContinuationsRange: alphabet should not be empty.");
+	}
+
+	if (last_rank_ < first_rank_)
+	{
+		throw std::invalid_argument(
+			"In ContinuationsRange: first rank "_s + std::to_string(first_rank_) + " is greater than last rank "
+			+ std::to_string(last_rank_) + ".");
+	}
+}
+
+size_t ContinuationsRange::size() const
+{
+	return last_rank_ - first_rank_;
+}
+
+bool ContinuationsRange::empty() const
+{
+	return last_rank_ == first_rank_;
+}
+
+size_t ContinuationsRange::GetAlphabetSize() const
+{
+	return alphabet_;
+}
+
+size_t ContinuationsRange::GetContinuationLength() const
+{
+	return length_;
+}
+
+size_t ContinuationsRange::GetFirstRank() const
+{
+	return first_rank_;
+}
+
+size_t ContinuationsRange::GetLastRank() const
+{
+	return last_rank_;
+}
+
+Continuation<Symbol> ContinuationsRange::operator[](size_t i) const
+{
+	auto rank = first_rank_ + i;
+	Continuation<Symbol> continuation(alphabet_, 0);
+	for (size_t j = 0; j < length_; ++j)
+	{
+		continuation.push_back(static_cast<Symbol>(rank % alphabet_));
+		rank /= alphabet_;
+	}
+
+	return continuation;
+}
+
+ContinuationsRange ContinuationsRange::SubRange(size_t first, size_t last) const
+{
+	if (size() < last)
+	{
+		throw std::range_error("In ContinuationsRange::SubRange: subrange is out of the range.");
+	}
+
+	return ContinuationsRange(alphabet_, length_, first_rank_ + first, first_rank_ + last);
+}
+
+ContinuationsRange::Iterator ContinuationsRange::begin() const
+{
+	return Iterator((*this)[0], first_rank_);
+}
+
+ContinuationsRange::Iterator ContinuationsRange::end() const
+{
+	return Iterator(Continuation<Symbol>(alphabet_, length_), last_rank_);
+}
+
 std::ostream& operator<<(std::ostream& ost, const Continuation<Symbol>& cont)
 {
 	for (size_t i = 0; i < cont.size(); ++i)
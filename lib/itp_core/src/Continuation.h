@@ -4,7 +4,10 @@
 #include "PrimitiveDataTypes.h"
 
 #include <algorithm>
+#include <array>
+#include <iterator>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace itp
@@ -21,11 +24,21 @@ struct Forecast_point
 };
 
 bool Increment(std::vector<Symbol>& sequence, size_t min, size_t max);
+bool Increment(Symbol* first, Symbol* last, size_t min, size_t max);
 
+/**
+ * A sequence of symbols, which can follow the history. The symbols are stored inline, so continuations are trivially
+ * copyable and neither creating nor enumerating or dividing them allocates memory.
+ */
 template<typename T>
 class Continuation
 {
 public:
+	/**
+	 * Maximal length of a continuation, it covers the longest allowed forecasting horizon.
+	 */
+	static constexpr size_t kMaxSize = 64;
+
 	explicit Continuation(T init_symbol = 0);
 	Continuation(size_t alphabet, size_t size, T init_symbol = 0);
 	Continuation(std::initializer_list<T> list);
@@ -53,11 +66,14 @@ public:
 	constexpr T* data() noexcept;
 	constexpr const T* data() const noexcept;
 
-	typename std::vector<T>::const_iterator cbegin() const;
-	typename std::vector<T>::const_iterator cend() const;
+	const T* cbegin() const;
+	const T* cend() const;
 
 private:
-	std::vector<T> continuation_;
+	static void CheckSize(size_t size);
+
+	std::array<T, kMaxSize> continuation_{};
+	size_t size_;
 	size_t alphabet_size_;
 	bool is_overflow_;
 };
@@ -77,6 +93,88 @@ private:
 	Continuation<T> continuation_;
 };
 
+/**
+ * Continuations of the same length over the same alphabet with mixed-radix ranks from [first_rank, last_rank). The first
+ * symbol is the least significant digit, so the continuations go in the order of Continuation::operator++. The range
+ * doesn't keep the continuations, they are generated during the iteration, so the whole space of A^h continuations
+ * can be passed around and split into parts without materializing it.
+ */
+class ContinuationsRange
+{
+public:
+	class Iterator
+	{
+	public:
+		using value_type = Continuation<Symbol>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Continuation<Symbol>*;
+		using reference = const Continuation<Symbol>&;
+		using iterator_category = std::input_iterator_tag;
+
+		Iterator() = default;
+		Iterator(const Continuation<Symbol>& continuation, size_t rank);
+
+		reference operator*() const;
+		pointer operator->() const;
+
+		Iterator& operator++();
+		Iterator operator++(int);
+
+		bool operator==(const Iterator& other) const;
+		bool operator!=(const Iterator& other) const;
+
+	private:
+		Continuation<Symbol> continuation_;
+		size_t rank_ = 0;
+	};
+
+	/**
+	 * Constructs the range of all continuations of the specified length.
+	 *
+	 * \param[in] alphabet Size of the alphabet.
+	 * \param[in] length Length of the continuations.
+	 */
+	ContinuationsRange(size_t alphabet, size_t length);
+
+	/**
+	 * \param[in] alphabet Size of the alphabet.
+	 * \param[in] length Length of the continuations.
+	 * \param[in] first_rank Rank of the first continuation in the range.
+	 * \param[in] last_rank Rank of the continuation after the last one in the range.
+	 */
+	ContinuationsRange(size_t alphabet, size_t length, size_t first_rank, size_t last_rank);
+
+	size_t size() const;
+	bool empty() const;
+
+	size_t GetAlphabetSize() const;
+	size_t GetContinuationLength() const;
+	size_t GetFirstRank() const;
+	size_t GetLastRank() const;
+
+	/**
+	 * \return Continuation with the rank first_rank + i.
+	 */
+	Continuation<Symbol> operator[](size_t i) const;
+
+	/**
+	 * \param[in] first Position of the first continuation of the subrange.
+	 * \param[in] last Position after the last continuation of the subrange.
+	 *
+	 * \return The continuations, which are on the positions from [first, last) in this range.
+	 */
+	ContinuationsRange SubRange(size_t first, size_t last) const;
+
+	Iterator begin() const;
+	Iterator end() const;
+
+private:
+	size_t alphabet_;
+	size_t length_;
+	size_t first_rank_;
+	size_t last_rank_;
+};
+
 std::ostream& operator<<(std::ostream&, const Continuation<Symbol>&);
 bool operator<(const std::pair<Continuation<Symbol>, Double>&, const std::pair<Continuation<Symbol>, Double>&);
 
@@ -91,9 +189,11 @@ itp::Continuation<T>::Continuation(T init_symbol)
 
 template<typename T>
 itp::Continuation<T>::Continuation(size_t alphabet, size_t size, T init_symbol)
-	: continuation_(size, init_symbol)
+	: size_(size)
 	, is_overflow_(false)
 {
+	CheckSize(size);
+	std::fill_n(begin(continuation_), size_, init_symbol);
 	alphabet_size_ = alphabet;
 	if (alphabet_size_ <= init_symbol)
 	{
@@ -106,7 +206,8 @@ itp::Continuation<T>::Continuation(size_t alphabet, size_t size, T init_symbol)
 template<typename T>
 itp::Continuation<T>::Continuation(std::initializer_list<T> list)
 {
-	continuation_.resize(list.size());
+	CheckSize(list.size());
+	size_ = list.size();
 	std::copy(begin(list), end(list), begin(continuation_));
 	alphabet_size_ = *std::max_element(begin(list), end(list)) + 1;
 	is_overflow_ = false;
@@ -115,7 +216,7 @@ itp::Continuation<T>::Continuation(std::initializer_list<T> list)
 template<typename T>
 const T& itp::Continuation<T>::operator[](size_t ind) const
 {
-	if (continuation_.size() <= ind)
+	if (size_ <= ind)
 	{
 		throw std::range_error("Index out of range");
 	}
@@ -132,7 +233,7 @@ itp::Continuation<T> itp::Continuation<T>::operator++(int)
 	}
 
 	Continuation<T> prev(*this);
-	is_overflow_ = !Increment(continuation_, 0, alphabet_size_);
+	is_overflow_ = !Increment(continuation_.data(), continuation_.data() + size_, 0, alphabet_size_);
 	return prev;
 }
 
@@ -141,7 +242,7 @@ itp::Continuation<T>& itp::Continuation<T>::operator++()
 {
 	if (!is_overflow_)
 	{
-		is_overflow_ = !Increment(continuation_, 0, alphabet_size_);
+		is_overflow_ = !Increment(continuation_.data(), continuation_.data() + size_, 0, alphabet_size_);
 	}
 
 	return *this;
@@ -150,13 +251,13 @@ itp::Continuation<T>& itp::Continuation<T>::operator++()
 template<typename T>
 size_t itp::Continuation<T>::size() const
 {
-	return continuation_.size();
+	return size_;
 }
 
 template<typename T>
 bool itp::Continuation<T>::is_init() const
 {
-	return std::all_of(begin(continuation_), end(continuation_), [](T item) { return item == 0; });
+	return std::all_of(cbegin(), cend(), [](T item) { return item == 0; });
 }
 
 template<typename T>
@@ -174,12 +275,12 @@ size_t itp::Continuation<T>::get_alphabet_size() const
 template<typename T>
 bool itp::Continuation<T>::operator<(const Continuation<T>& rhs) const
 {
-	if (continuation_.size() != rhs.size())
+	if (size_ != rhs.size())
 	{
 		throw std::invalid_argument("In operator <: continuations must have the same length.");
 	}
 
-	for (size_t i = continuation_.size(); i > 0; --i)
+	for (size_t i = size_; i > 0; --i)
 	{
 		if (continuation_[i - 1] < rhs[i - 1])
 		{
@@ -197,12 +298,12 @@ bool itp::Continuation<T>::operator<(const Continuation<T>& rhs) const
 template<typename T>
 bool itp::Continuation<T>::operator>(const Continuation<T>& rhs) const
 {
-	if (continuation_.size() != rhs.size())
+	if (size_ != rhs.size())
 	{
 		throw std::invalid_argument("In operator >: Continuations must have the same length.");
 	}
 
-	for (size_t i = continuation_.size(); i > 0; --i)
+	for (size_t i = size_; i > 0; --i)
 	{
 		if (continuation_[i - 1] > rhs[i - 1])
 		{
@@ -220,12 +321,12 @@ bool itp::Continuation<T>::operator>(const Continuation<T>& rhs) const
 template<typename T>
 bool itp::Continuation<T>::operator==(const Continuation<T>& rhs) const
 {
-	if (continuation_.size() != rhs.size())
+	if (size_ != rhs.size())
 	{
 		return false;
 	}
 
-	for (size_t i = continuation_.size(); i > 0; --i)
+	for (size_t i = size_; i > 0; --i)
 	{
 		if (continuation_[i - 1] != rhs[i - 1])
 		{
@@ -247,8 +348,8 @@ itp::Continuation<T> itp::Continuation<T>::operator/(T divisor) const
 {
 	Continuation<T> result(*this);
 	std::transform(
-		begin(continuation_),
-		end(continuation_),
+		cbegin(),
+		cend(),
 		begin(result.continuation_),
 		[&divisor](T value) { return value / divisor; });
 	result.alphabet_size_ /= divisor;
@@ -266,8 +367,9 @@ void itp::Continuation<T>::push_back(const T& item)
 			"In Continuation::push_back: item '"_s + std::to_string(item) + "' is greater than alphabet size "
 			+ std::to_string(alphabet_size_) + ".");
 	}
+	CheckSize(size_ + 1);
 
-	continuation_.push_back(item);
+	continuation_[size_++] = item;
 }
 
 template<typename T>
@@ -283,17 +385,30 @@ constexpr const T* itp::Continuation<T>::data() const noexcept
 }
 
 template<typename T>
-typename std::vector<T>::const_iterator itp::Continuation<T>::cbegin() const
+const T* itp::Continuation<T>::cbegin() const
 {
-	return continuation_.cbegin();
+	return continuation_.data();
 }
 
 template<typename T>
-typename std::vector<T>::const_iterator itp::Continuation<T>::cend() const
+const T* itp::Continuation<T>::cend() const
 {
-	return continuation_.cend();
+	return continuation_.data() + size_;
 }
 
+template<typename T>
+void itp::Continuation<T>::CheckSize(size_t size)
+{
+	if (kMaxSize < size)
+	{
+		throw std::length_error(
+			"Continuation is too long: "_s + std::to_string(size) + ", maximal length is " + std::to_string(kMaxSize)
+			+ ".");
+	}
+}
+
+static_assert(std::is_trivially_copyable_v<itp::Continuation<itp::Symbol>>);
+
 namespace std
 {
 template<>
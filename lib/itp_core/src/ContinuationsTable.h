@@ -0,0 +1,507 @@
+#ifndef ITP_CONTINUATIONS_TABLE_H_INCLUDED_
+#define ITP_CONTINUATIONS_TABLE_H_INCLUDED_
+
+#include "Continuation.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace itp
+{
+
+/**
+ * A table indexed by continuations of the same length over the same alphabet. Since such continuations are exactly the
+ * base-A numbers of length h, a continuation is stored in the row equal to its mixed-radix rank (the first symbol is
+ * the least significant digit, so the ranks go in the order of Continuation::operator++). The values are kept in one
+ * contiguous buffer column by column, so the column of a factor is a plain array of A^h values.
+ *
+ * The interface is compatible with the one of DataFrame, so the tables are interchangeable in the templates of
+ * transformations. Unlike DataFrame, the rows are always enumerated in the order of ranks.
+ */
+template<typename Factor, typename Value>
+class ContinuationsTable
+{
+public:
+	using IndexType = Continuation<Symbol>;
+	using FactorType = Factor;
+	using ValueType = Value;
+
+	/**
+	 * Iterates over the values of the continuations present in the table column by column.
+	 */
+	template<bool is_const>
+	class Iterator
+	{
+	public:
+		using value_type = Value;
+		using difference_type = std::ptrdiff_t;
+		using pointer = std::conditional_t<is_const, const Value*, Value*>;
+		using reference = std::conditional_t<is_const, const Value&, Value&>;
+		using iterator_category = std::bidirectional_iterator_tag;
+		using table_ptr_type = std::conditional_t<is_const, const ContinuationsTable*, ContinuationsTable*>;
+
+		Iterator() = default;
+		Iterator(table_ptr_type table, size_t position)
+			: table_{table}
+			, position_{position}
+		{
+			// DO NOTHING
+		}
+
+		reference operator*() const
+		{
+			const auto rows_count = std::size(table_->ranks_);
+			return table_->data_
+				[position_ / rows_count * table_->rows_capacity_ + table_->ranks_[position_ % rows_count]];
+		}
+
+		Iterator& operator++()
+		{
+			++position_;
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			auto tmp = *this;
+			++position_;
+			return tmp;
+		}
+
+		Iterator& operator--()
+		{
+			--position_;
+			return *this;
+		}
+
+		Iterator operator--(int)
+		{
+			auto tmp = *this;
+			--position_;
+			return tmp;
+		}
+
+		bool operator==(const Iterator& other) const
+		{
+			return position_ == other.position_ && table_ == other.table_;
+		}
+
+		bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+	private:
+		table_ptr_type table_ = nullptr;
+		size_t position_ = 0;
+	};
+
+	using iterator = Iterator<false>;
+	using const_iterator = Iterator<true>;
+
+	ContinuationsTable() = default;
+
+	template<typename IndexGenerator>
+	ContinuationsTable(IndexGenerator, size_t);
+
+	template<typename ForwardIterator>
+	ContinuationsTable(ForwardIterator, ForwardIterator);
+
+	template<typename ForwardIterator1, typename ForwardIterator2>
+	ContinuationsTable(ForwardIterator1, ForwardIterator1, ForwardIterator2, ForwardIterator2);
+
+	void AddIndex(const IndexType&);
+
+	template<typename Generator>
+	void AddIndex(Generator, size_t);
+
+	template<typename ForwardIterator>
+	void AddIndex(ForwardIterator, ForwardIterator);
+
+	void AddFactor(const FactorType&);
+
+	template<typename ForwardIterator>
+	void AddFactor(ForwardIterator, ForwardIterator);
+
+	size_t IndexSize() const;
+	size_t FactorsSize() const;
+
+	std::vector<IndexType> GetIndex() const;
+	std::vector<FactorType> GetFactors() const;
+
+	ValueType& operator()(const IndexType&, const FactorType&);
+	const ValueType& operator()(const IndexType&, const FactorType&) const;
+
+	size_t GetAlphabetSize() const;
+	size_t GetContinuationLength() const;
+
+	/**
+	 * Computes the row of a continuation.
+	 *
+	 * \param[in] continuation Continuation of the table's length with symbols from the table's alphabet.
+	 *
+	 * \return Mixed-radix rank of the continuation.
+	 */
+	size_t Rank(const IndexType& continuation) const;
+
+	/**
+	 * \return Ranks of the continuations present in the table in ascending order.
+	 */
+	const std::vector<size_t>& GetRanks() const;
+
+	/**
+	 * \return Position of the factor's column, throws std::range_error if there is no such factor.
+	 */
+	size_t FactorPosition(const FactorType& factor) const;
+
+	/**
+	 * Gives direct access to the column of a factor. The value of a continuation is placed at the offset equal to
+	 * its rank, the cells of the continuations absent in the table contain default-constructed values.
+	 *
+	 * \param[in] factor_position Position of the factor returned by FactorPosition.
+	 *
+	 * \return Pointer to the first of A^h values. It is invalidated by adding new factors or indexes.
+	 */
+	ValueType* Column(size_t factor_position);
+	const ValueType* Column(size_t factor_position) const;
+
+	iterator begin();
+	const_iterator begin() const;
+
+	iterator end();
+	const_iterator end() const;
+
+private:
+	/**
+	 * Adds the continuation if it is not present yet, extends the alphabet if the continuation does not fit in it.
+	 *
+	 * \return Rank of the continuation.
+	 */
+	size_t Insert(const IndexType& continuation);
+
+	/**
+	 * Rearranges the values for another alphabet keeping the present continuations.
+	 */
+	void Reshape(size_t alphabet, size_t length);
+
+	bool Fits(const IndexType& continuation) const;
+
+	size_t alphabet_ = 0;
+	size_t length_ = 0;
+	size_t rows_capacity_ = 0;
+
+	std::vector<ValueType> data_;
+	std::vector<bool> is_present_;
+	std::vector<size_t> ranks_;
+
+	std::map<FactorType, size_t> fac_to_column_;
+	std::vector<FactorType> factors_;
+};
+
+template<typename Factor, typename Value>
+template<typename IndexGenerator>
+ContinuationsTable<Factor, Value>::ContinuationsTable(IndexGenerator generator, size_t n)
+{
+	AddIndex(generator, n);
+}
+
+template<typename Factor, typename Value>
+template<typename ForwardIterator>
+ContinuationsTable<Factor, Value>::ContinuationsTable(ForwardIterator first, ForwardIterator last)
+{
+	AddIndex(first, last);
+}
+
+template<typename Factor, typename Value>
+template<typename ForwardIterator1, typename ForwardIterator2>
+ContinuationsTable<Factor, Value>::ContinuationsTable(
+	ForwardIterator1 first_index,
+	ForwardIterator1 last_index,
+	ForwardIterator2 first_factor,
+	ForwardIterator2 last_factor)
+{
+	AddIndex(first_index, last_index);
+	data_.reserve(rows_capacity_ * std::distance(first_factor, last_factor));
+	AddFactor(first_factor, last_factor);
+}
+
+template<typename Factor, typename Value>
+void ContinuationsTable<Factor, Value>::AddIndex(const IndexType& continuation)
+{
+	Insert(continuation);
+}
+
+template<typename Factor, typename Value>
+template<typename Generator>
+void ContinuationsTable<Factor, Value>::AddIndex(Generator generator, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		Insert(generator());
+	}
+}
+
+template<typename Factor, typename Value>
+template<typename ForwardIterator>
+void ContinuationsTable<Factor, Value>::AddIndex(ForwardIterator first, ForwardIterator last)
+{
+	while (first != last)
+	{
+		Insert(*first++);
+	}
+}
+
+template<typename Factor, typename Value>
+void ContinuationsTable<Factor, Value>::AddFactor(const FactorType& factor)
+{
+	if (fac_to_column_.find(factor) != std::end(fac_to_column_))
+	{
+		return;
+	}
+
+	fac_to_column_[factor] = std::size(factors_);
+	factors_.push_back(factor);
+	data_.resize(data_.size() + rows_capacity_);
+}
+
+template<typename Factor, typename Value>
+template<typename ForwardIterator>
+void ContinuationsTable<Factor, Value>::AddFactor(ForwardIterator first, ForwardIterator last)
+{
+	while (first != last)
+	{
+		AddFactor(*first++);
+	}
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::IndexSize() const
+{
+	return std::size(ranks_);
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::FactorsSize() const
+{
+	return std::size(factors_);
+}
+
+template<typename Factor, typename Value>
+std::vector<typename ContinuationsTable<Factor, Value>::IndexType> ContinuationsTable<Factor, Value>::GetIndex() const
+{
+	std::vector<IndexType> index;
+	index.reserve(std::size(ranks_));
+	for (auto rank : ranks_)
+	{
+		IndexType continuation(alphabet_, 0);
+		for (size_t i = 0; i < length_; ++i)
+		{
+			continuation.push_back(static_cast<Symbol>(rank % alphabet_));
+			rank /= alphabet_;
+		}
+		index.push_back(continuation);
+	}
+
+	return index;
+}
+
+template<typename Factor, typename Value>
+std::vector<typename ContinuationsTable<Factor, Value>::FactorType> ContinuationsTable<Factor, Value>::GetFactors()
+	const
+{
+	return factors_;
+}
+
+template<typename Factor, typename Value>
+typename ContinuationsTable<Factor, Value>::ValueType& ContinuationsTable<Factor, Value>::operator()(
+	const IndexType& continuation,
+	const FactorType& factor)
+{
+	const auto rank = Insert(continuation);
+	AddFactor(factor);
+
+	return data_[fac_to_column_[factor] * rows_capacity_ + rank];
+}
+
+template<typename Factor, typename Value>
+const typename ContinuationsTable<Factor, Value>::ValueType& ContinuationsTable<Factor, Value>::operator()(
+	const IndexType& continuation,
+	const FactorType& factor) const
+{
+	if (!Fits(continuation) || !is_present_[Rank(continuation)])
+	{
+		throw std::range_error("Index out of range.");
+	}
+
+	return Column(FactorPosition(factor))[Rank(continuation)];
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::GetAlphabetSize() const
+{
+	return alphabet_;
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::GetContinuationLength() const
+{
+	return length_;
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::Rank(const IndexType& continuation) const
+{
+	size_t rank = 0;
+	for (size_t i = continuation.size(); i > 0; --i)
+	{
+		rank = rank * alphabet_ + continuation[i - 1];
+	}
+
+	return rank;
+}
+
+template<typename Factor, typename Value>
+const std::vector<size_t>& ContinuationsTable<Factor, Value>::GetRanks() const
+{
+	return ranks_;
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::FactorPosition(const FactorType& factor) const
+{
+	const auto it = fac_to_column_.find(factor);
+	if (it == std::end(fac_to_column_))
+	{
+		throw std::range_error("Factor out of range.");
+	}
+
+	return it->second;
+}
+
+template<typename Factor, typename Value>
+typename ContinuationsTable<Factor, Value>::ValueType* ContinuationsTable<Factor, Value>::Column(
+	size_t factor_position)
+{
+	return data_.data() + factor_position * rows_capacity_;
+}
+
+template<typename Factor, typename Value>
+const typename ContinuationsTable<Factor, Value>::ValueType* ContinuationsTable<Factor, Value>::Column(
+	size_t factor_position) const
+{
+	return data_.data() + factor_position * rows_capacity_;
+}
+
+template<typename Factor, typename Value>
+typename ContinuationsTable<Factor, Value>::iterator ContinuationsTable<Factor, Value>::begin()
+{
+	return iterator(this, 0);
+}
+
+template<typename Factor, typename Value>
+typename ContinuationsTable<Factor, Value>::const_iterator ContinuationsTable<Factor, Value>::begin() const
+{
+	return const_iterator(this, 0);
+}
+
+template<typename Factor, typename Value>
+typename ContinuationsTable<Factor, Value>::iterator ContinuationsTable<Factor, Value>::end()
+{
+	return iterator(this, std::size(ranks_) * std::size(factors_));
+}
+
+template<typename Factor, typename Value>
+typename ContinuationsTable<Factor, Value>::const_iterator ContinuationsTable<Factor, Value>::end() const
+{
+	return const_iterator(this, std::size(ranks_) * std::size(factors_));
+}
+
+template<typename Factor, typename Value>
+size_t ContinuationsTable<Factor, Value>::Insert(const IndexType& continuation)
+{
+	if (rows_capacity_ == 0)
+	{
+		Reshape(continuation.get_alphabet_size(), continuation.size());
+	}
+	else if (continuation.size() != length_)
+	{
+		throw std::invalid_argument(
+			"In ContinuationsTable: all continuations must have the same length, expected " + std::to_string(length_)
+			+ ", got " + std::to_string(continuation.size()) + ".");
+	}
+
+	if (!Fits(continuation))
+	{
+		Reshape(
+			std::max<size_t>(alphabet_, *std::max_element(continuation.cbegin(), continuation.cend()) + 1),
+			length_);
+	}
+
+	const auto rank = Rank(continuation);
+	if (!is_present_[rank])
+	{
+		is_present_[rank] = true;
+		ranks_.insert(std::upper_bound(std::begin(ranks_), std::end(ranks_), rank), rank);
+	}
+
+	return rank;
+}
+
+template<typename Factor, typename Value>
+void ContinuationsTable<Factor, Value>::Reshape(size_t alphabet, size_t length)
+{
+	alphabet = std::max<size_t>(1, alphabet);
+	size_t rows_capacity = 1;
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (std::numeric_limits<size_t>::max() / alphabet < rows_capacity)
+		{
+			throw std::length_error("In ContinuationsTable: too many continuations.");
+		}
+		rows_capacity *= alphabet;
+	}
+
+	std::vector<ValueType> data(rows_capacity * std::size(factors_));
+	std::vector<bool> is_present(rows_capacity);
+	for (auto& rank : ranks_)
+	{
+		size_t new_rank = 0;
+		size_t multiplier = 1;
+		for (size_t i = 0, old_rank = rank; i < length; ++i)
+		{
+			new_rank += old_rank % alphabet_ * multiplier;
+			old_rank /= alphabet_;
+			multiplier *= alphabet;
+		}
+
+		for (size_t j = 0; j < std::size(factors_); ++j)
+		{
+			data[j * rows_capacity + new_rank] = std::move(data_[j * rows_capacity_ + rank]);
+		}
+		is_present[new_rank] = true;
+		rank = new_rank;
+	}
+
+	alphabet_ = alphabet;
+	length_ = length;
+	rows_capacity_ = rows_capacity;
+	data_ = std::move(data);
+	is_present_ = std::move(is_present);
+}
+
+template<typename Factor, typename Value>
+bool ContinuationsTable<Factor, Value>::Fits(const IndexType& continuation) const
+{
+	return rows_capacity_ != 0 && continuation.size() == length_
+		&& std::all_of(
+			   continuation.cbegin(),
+			   continuation.cend(),
+			   [this](Symbol symbol) { return symbol < alphabet_; });
+}
+
+} // namespace itp
+
+#endif // ITP_CONTINUATIONS_TABLE_H_INCLUDED_
@@ -3,9 +3,66 @@
 
 #include "Types.h"
 
+#include <limits>
+#include <memory>
+#include <optional>
+
 namespace itp
 {
 
+/**
+ * A snapshot of a compressor's state taken after some data was processed. Allows to compress several different
+ * endings of the same data without processing the common beginning again.
+ */
+class ICompressionCheckpoint
+{
+public:
+	using SizeInBits = size_t;
+
+	virtual ~ICompressionCheckpoint() = default;
+
+	/**
+	 * Makes an independent copy of the checkpoint. Appending data to the copy doesn't affect the original.
+	 *
+	 * \return The copy of the checkpoint.
+	 */
+	virtual std::unique_ptr<ICompressionCheckpoint> Fork() const = 0;
+
+	/**
+	 * Continues compression with the specified data.
+	 *
+	 * \param[in] data Data to append to the already processed one.
+	 * \param[in] size Size of the data.
+	 */
+	virtual void Append(const unsigned char* data, size_t size) = 0;
+
+	/**
+	 * Returns the size of all data processed so far as if the compression were finished right now. The checkpoint
+	 * remains usable after the call.
+	 *
+	 * \return Size of the compressed data in bits.
+	 */
+	virtual SizeInBits CodeLength() = 0;
+
+	/**
+	 * Finishes the compression and returns the size of all processed data like CodeLength(), but the checkpoint may
+	 * become unusable after the call, so a compressor doesn't have to copy its state to finish it.
+	 *
+	 * \return Size of the compressed data in bits.
+	 */
+	virtual SizeInBits Finish() { return CodeLength(); }
+
+	/**
+	 * Tells whether the code length never decreases when data is appended, e.g. it is the sum of ideal code lengths of
+	 * the symbols. Only such checkpoints are pruned (see ICompressor::SetPruningSlack): the code lengths of the whole
+	 * compressed files include headers, padding and the like, so a continuation may turn out shorter than its prefix.
+	 *
+	 * \return true if the code lengths are monotone.
+	 */
+	virtual bool HasMonotoneCodeLengths() const = 0;
+};
+using ICompressionCheckpointPtr = std::unique_ptr<ICompressionCheckpoint>;
+
 /**
  * Base class for all data compression algorithms. Hides calls for library-specific functions.
  */
@@ -13,7 +70,12 @@ class ICompressor
 {
 public:
 	using SizeInBits = size_t;
-	using Continuations = std::vector<Continuation<Symbol>>;
+	using Continuations = ContinuationsRange;
+
+	/**
+	 * Code length of the continuations discarded by the branch-and-bound evaluation (see SetPruningSlack).
+	 */
+	static constexpr SizeInBits kPrunedCodeLength = std::numeric_limits<SizeInBits>::max();
 
 	virtual ~ICompressor() = default;
 
@@ -30,6 +92,7 @@ public:
 
 	/**
 	 * Compresses each passed trajectory after the historical values and returns the code lengths for each trajectory.
+	 * The trajectories are generated on the fly, so the caller may pass any part of the space of continuations.
 	 *
 	 * \param[in] historical_values Time series.
 	 * \param[in] possible_endings Continuations to compress.
@@ -39,6 +102,25 @@ public:
 	virtual std::vector<SizeInBits>
 	CompressContinuations(const std::vector<Symbol>& historical_values, const Continuations& possible_endings) = 0;
 
+	/**
+	 * Compresses data and keeps the state of the compressor to continue compression later. This is an optional
+	 * capability: compressors, which cannot save their state, return nullptr.
+	 *
+	 * \param[in] data Data to compress.
+	 * \param[in] size Size of the data.
+	 *
+	 * \return The state of the compressor after processing the data or nullptr if checkpoints are not supported.
+	 */
+	virtual ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) = 0;
+
+	/**
+	 * Creates a new instance of the same compressor with the same settings. The new instance doesn't share any
+	 * state with the original one, so both can be used concurrently from different threads.
+	 *
+	 * \return The new instance or nullptr if the compressor cannot be duplicated (e.g. it wraps an external object).
+	 */
+	virtual std::unique_ptr<ICompressor> Clone() const = 0;
+
 	/**
 	 * Inform algorithm about the minimal and maximal possible values in data.
 	 *
@@ -46,8 +128,40 @@ public:
 	 * \param[in] alphabet_max_symbol Maximal value in the data.
 	 */
 	virtual void SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) = 0;
+
+	/**
+	 * Enables the branch-and-bound evaluation in CompressContinuations: a prefix of continuations, which code length
+	 * exceeds the minimal code length of the already evaluated continuations by more than the slack, is not expanded
+	 * and all its continuations get kPrunedCodeLength. Only compressors with checkpoints, which code lengths don't
+	 * decrease when data is appended (see ICompressionCheckpoint::HasMonotoneCodeLengths), prune continuations, so the
+	 * pruning never discards a continuation closer than the slack to the best one.
+	 *
+	 * \param[in] slack_in_bits The slack or std::nullopt to evaluate all the continuations.
+	 */
+	virtual void SetPruningSlack(std::optional<SizeInBits> slack_in_bits) = 0;
 };
 
+/**
+ * Computes code lengths of the continuations by forking the checkpoint, which already contains the historical values.
+ * The continuations are evaluated depth-first over the trie of their prefixes: the state after a prefix is computed
+ * once and forked for all its children, so about A^h * A / (A - 1) symbols are appended instead of h * A^h.
+ *
+ * With pruning, the children of a prefix are visited from the shortest code length, and the prefixes, which are
+ * longer than the best complete continuation found so far plus the slack, are not expanded. The checkpoints without
+ * monotone code lengths are never pruned.
+ *
+ * \param[in] history_checkpoint State of a compressor after processing the historical values.
+ * \param[in] possible_endings Continuations to compress.
+ * \param[in] pruning_slack Slack of the branch-and-bound evaluation or std::nullopt to evaluate all continuations.
+ *
+ * \return Code lengths in bits for each trajectory (including the historical values), ICompressor::kPrunedCodeLength
+ * for the pruned ones.
+ */
+std::vector<ICompressor::SizeInBits> CompressContinuationsFromCheckpoint(
+	const ICompressionCheckpoint& history_checkpoint,
+	const ICompressor::Continuations& possible_endings,
+	std::optional<ICompressor::SizeInBits> pruning_slack = std::nullopt);
+
 } // namespace itp
 
 #endif // ITP_ICOMPRESSOR_H
@@ -0,0 +1,263 @@
+/**
+ * Floating-point numbers in the logarithmic number system. A number is kept as its sign and the base-2 logarithm of its
+ * absolute value, so probabilities like 2^(-100000) are representable by an ordinary double. Multiplication and
+ * division are exact additions and subtractions of the logarithms, addition is performed with the log-sum-exp trick.
+ *
+ * The interface is the same as the one of BigDouble, so the types are interchangeable in templates.
+ *
+ * Precision: the relative error of each operation is about the machine epsilon multiplied by the magnitude of the
+ * logarithm, i.e. ~1e-12 for numbers like 2^(-10000). Results of forecasting obtained with this type differ from the
+ * ones obtained with BigDouble<12, 24> by less than 1e-9 (relative).
+ */
+#ifndef ITP_LOG_DOUBLE_H_INCLUDED_
+#define ITP_LOG_DOUBLE_H_INCLUDED_
+
+#include "Bignums.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+
+namespace bignums
+{
+
+template<typename Float>
+class LogNumber
+{
+	static_assert(std::is_floating_point_v<Float>, "Float should be a floating-point type");
+
+public:
+	LogNumber() = default;
+
+	template<typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+	LogNumber(T num)
+		: negative_{static_cast<Float>(num) < 0}
+		, log2_abs_{std::log2(std::abs(static_cast<Float>(num)))}
+	{
+		// DO NOTHING
+	}
+
+	/**
+	 * Constructs the number from the logarithm of its absolute value.
+	 *
+	 * \param[in] log2_abs Base-2 logarithm of the absolute value of the number.
+	 * \param[in] negative Sign of the number.
+	 *
+	 * \return The number.
+	 */
+	static LogNumber<Float> FromLog2(Float log2_abs, bool negative = false)
+	{
+		LogNumber<Float> result;
+		result.log2_abs_ = log2_abs;
+		result.negative_ = negative && !result.IsZero();
+
+		return result;
+	}
+
+	Float Log2Abs() const { return log2_abs_; }
+
+	bool IsZero() const { return log2_abs_ == -std::numeric_limits<Float>::infinity(); }
+
+	LogNumber<Float>& operator+=(const LogNumber<Float>& other)
+	{
+		if (other.IsZero())
+		{
+			return *this;
+		}
+
+		if (IsZero())
+		{
+			return *this = other;
+		}
+
+		auto larger = log2_abs_;
+		auto smaller = other.log2_abs_;
+		auto negative = negative_;
+		if (larger < smaller)
+		{
+			std::swap(larger, smaller);
+			negative = other.negative_;
+		}
+
+		const auto ratio = std::exp2(smaller - larger);
+		if (negative_ == other.negative_)
+		{
+			log2_abs_ = larger + std::log1p(ratio) / ln2_;
+		}
+		else
+		{
+			log2_abs_ = larger + std::log1p(-ratio) / ln2_;
+		}
+		negative_ = negative && !IsZero();
+
+		return *this;
+	}
+
+	LogNumber<Float>& operator-=(const LogNumber<Float>& other) { return *this += -other; }
+
+	LogNumber<Float>& operator*=(const LogNumber<Float>& other)
+	{
+		log2_abs_ += other.log2_abs_;
+		negative_ = (negative_ != other.negative_) && !IsZero();
+
+		return *this;
+	}
+
+	LogNumber<Float>& operator/=(const LogNumber<Float>& other)
+	{
+		log2_abs_ -= other.log2_abs_;
+		negative_ = (negative_ != other.negative_) && !IsZero();
+
+		return *this;
+	}
+
+	operator Float() const { return negative_ ? -std::exp2(log2_abs_) : std::exp2(log2_abs_); }
+
+	template<typename F>
+	friend bool operator<(const LogNumber<F>&, const LogNumber<F>&);
+	template<typename F>
+	friend bool operator==(const LogNumber<F>&, const LogNumber<F>&);
+	template<typename F>
+	friend LogNumber<F> operator-(const LogNumber<F>&);
+
+private:
+	static constexpr Float ln2_ = static_cast<Float>(0.693147180559945309417232121458176568L);
+
+	bool negative_ = false;
+	Float log2_abs_ = -std::numeric_limits<Float>::infinity();
+};
+
+using LogDouble = LogNumber<double>;
+
+template<typename Float>
+LogNumber<Float> operator+(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	auto tmp = lhs;
+	return tmp += rhs;
+}
+
+template<typename Float>
+LogNumber<Float> operator-(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	auto tmp = lhs;
+	return tmp -= rhs;
+}
+
+template<typename Float>
+LogNumber<Float> operator*(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	auto tmp = lhs;
+	return tmp *= rhs;
+}
+
+template<typename Float>
+LogNumber<Float> operator/(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	auto tmp = lhs;
+	return tmp /= rhs;
+}
+
+template<typename Float>
+bool operator<(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	if (lhs.negative_ != rhs.negative_)
+	{
+		return lhs.negative_;
+	}
+
+	return lhs.negative_ ? rhs.log2_abs_ < lhs.log2_abs_ : lhs.log2_abs_ < rhs.log2_abs_;
+}
+
+template<typename Float>
+bool operator<=(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	return !(rhs < lhs);
+}
+
+template<typename Float>
+bool operator>(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	return rhs < lhs;
+}
+
+template<typename Float>
+bool operator>=(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	return !(lhs < rhs);
+}
+
+template<typename Float>
+bool operator==(const LogNumber<Float>& lhs, const LogNumber<Float>& rhs)
+{
+	return lhs.negative_ == rhs.negative_ && lhs.log2_abs_ == rhs.log2_abs_;
+}
+
+template<typename Float>
+LogNumber<Float> operator-(const LogNumber<Float>& num)
+{
+	auto tmp = num;
+	tmp.negative_ = !tmp.negative_ && !tmp.IsZero();
+
+	return tmp;
+}
+
+template<typename Float>
+LogNumber<Float> pow(const LogNumber<Float>& base, const LogNumber<Float>& power)
+{
+	if (base < LogNumber<Float>{})
+	{
+		throw InvalidBaseException("Invalid base in pow.");
+	}
+
+	return LogNumber<Float>::FromLog2(static_cast<Float>(power) * base.Log2Abs());
+}
+
+template<typename Float>
+LogNumber<Float> log(const LogNumber<Float>& base, const LogNumber<Float>& x)
+{
+	return x.Log2Abs() / base.Log2Abs();
+}
+
+template<typename Float>
+LogNumber<Float> log2(const LogNumber<Float>& x)
+{
+	return x.Log2Abs();
+}
+
+template<typename Float>
+LogNumber<Float> abs(const LogNumber<Float>& num)
+{
+	return LogNumber<Float>::FromLog2(num.Log2Abs());
+}
+
+template<typename Float>
+LogNumber<Float> ceil(const LogNumber<Float>& num)
+{
+	return std::ceil(static_cast<Float>(num));
+}
+
+template<typename Float>
+std::string to_string(const LogNumber<Float>& num)
+{
+	std::ostringstream ost;
+	ost << num;
+
+	return ost.str();
+}
+
+template<typename Float>
+std::ostream& operator<<(std::ostream& ost, const LogNumber<Float>& num)
+{
+	if (num < LogNumber<Float>{})
+	{
+		ost << '-';
+	}
+
+	return ost << "2^" << num.Log2Abs();
+}
+
+} // namespace bignums
+
+#endif // ITP_LOG_DOUBLE_H_INCLUDED_
@@ -0,0 +1,155 @@
+/**
+ * Forecasting from the distributions of symbols on each step of continuations. Point forecasts need only these
+ * marginal distributions, so the joint distribution over all A^h continuations is never built (see
+ * CodeLengthsComputer::ComputeStepsDistributions).
+ */
+
+#ifndef ITP_MARGINAL_PREDICTION_H_INCLUDED_
+#define ITP_MARGINAL_PREDICTION_H_INCLUDED_
+
+#include "CompressionPrediction.h"
+
+namespace itp
+{
+
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
+class MarginalPointwisePredictor : public PointwisePredictor<OrigType, NewType>
+{
+public:
+	explicit MarginalPointwisePredictor(
+		CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer,
+		size_t difference_order = 0);
+
+	/**
+	 * Gives the same forecasts as BasicPointwisePredictor over the corresponding distribution predictor.
+	 */
+	Forecast<OrigType> Predict(
+		PreprocessedTimeSeries<OrigType, NewType> history,
+		size_t horizont,
+		const CompressorNamesVec& compressor_groups) const final;
+
+protected:
+	virtual PreprocessedTimeSeries<OrigType, Symbol> Sample(
+		const PreprocessedTimeSeries<OrigType, NewType>& history) const = 0;
+
+private:
+	CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer_;
+	WeightsGeneratorPtr weights_generator_;
+	size_t difference_order_;
+};
+
+template<typename DoubleT, typename Real = CodeProbability>
+class RealMarginalPointwisePredictor : public MarginalPointwisePredictor<DoubleT, DoubleT, Real>
+{
+public:
+	RealMarginalPointwisePredictor(
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+		SamplerPtr<DoubleT> sampler,
+		size_t partition_cardinality,
+		size_t difference_order = 0);
+
+protected:
+	PreprocessedTimeSeries<DoubleT, Symbol> Sample(const PreprocessedTimeSeries<DoubleT, DoubleT>& history) const override;
+
+private:
+	SamplerPtr<DoubleT> sampler_;
+	size_t partition_cardinality_;
+};
+
+template<typename DoubleT, typename SymbolT, typename Real = CodeProbability>
+class DiscreteMarginalPointwisePredictor : public MarginalPointwisePredictor<DoubleT, SymbolT, Real>
+{
+public:
+	DiscreteMarginalPointwisePredictor(
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+		SamplerPtr<SymbolT> sampler,
+		size_t difference_order = 0);
+
+protected:
+	PreprocessedTimeSeries<DoubleT, Symbol> Sample(const PreprocessedTimeSeries<DoubleT, SymbolT>& history) const override;
+
+private:
+	SamplerPtr<SymbolT> sampler_;
+};
+
+template<typename OrigType, typename NewType, typename Real>
+MarginalPointwisePredictor<OrigType, NewType, Real>::MarginalPointwisePredictor(
+	CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer,
+	size_t difference_order)
+	: codes_lengths_computer_{codes_lengths_computer}
+	, weights_generator_{std::make_shared<WeightsGenerator>()}
+	, difference_order_{difference_order}
+{
+	assert(codes_lengths_computer != nullptr);
+}
+
+template<typename OrigType, typename NewType, typename Real>
+Forecast<OrigType> MarginalPointwisePredictor<OrigType, NewType, Real>::Predict(
+	PreprocessedTimeSeries<OrigType, NewType> history,
+	size_t horizont,
+	const CompressorNamesVec& compressor_groups) const
+{
+	const auto differentized_history = DiffN(history, difference_order_);
+	const auto sampled_history = Sample(differentized_history);
+	auto steps_distributions = codes_lengths_computer_->ComputeStepsDistributions(
+		sampled_history,
+		horizont,
+		FindAllDistinctNames(compressor_groups));
+
+	Forecast<OrigType> result;
+	for (size_t i = 0; i < horizont; ++i)
+	{
+		FormGroupForecasts(steps_distributions[i], compressor_groups, weights_generator_);
+		const auto distribution = ToProbabilities(std::move(steps_distributions[i]));
+		for (const auto& compressor : distribution.GetFactors())
+		{
+			result(compressor, i).point = Mean(distribution, compressor);
+		}
+	}
+	result.CopyPreprocessingInfoFrom(sampled_history);
+	Integrate(result);
+
+	return result;
+}
+
+template<typename DoubleT, typename Real>
+RealMarginalPointwisePredictor<DoubleT, Real>::RealMarginalPointwisePredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+	SamplerPtr<DoubleT> sampler,
+	size_t partition_cardinality,
+	size_t difference_order)
+	: MarginalPointwisePredictor<DoubleT, DoubleT, Real>{codes_lengths_computer, difference_order}
+	, sampler_{sampler}
+	, partition_cardinality_{partition_cardinality}
+{
+	assert(sampler != nullptr);
+}
+
+template<typename DoubleT, typename Real>
+PreprocessedTimeSeries<DoubleT, Symbol> RealMarginalPointwisePredictor<DoubleT, Real>::Sample(
+	const PreprocessedTimeSeries<DoubleT, DoubleT>& history) const
+{
+	return sampler_->Transform(history, partition_cardinality_);
+}
+
+template<typename DoubleT, typename SymbolT, typename Real>
+DiscreteMarginalPointwisePredictor<DoubleT, SymbolT, Real>::DiscreteMarginalPointwisePredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+	SamplerPtr<SymbolT> sampler,
+	size_t difference_order)
+	: MarginalPointwisePredictor<DoubleT, SymbolT, Real>{codes_lengths_computer, difference_order}
+	, sampler_{sampler}
+{
+	assert(sampler != nullptr);
+}
+
+template<typename DoubleT, typename SymbolT, typename Real>
+PreprocessedTimeSeries<DoubleT, Symbol> DiscreteMarginalPointwisePredictor<DoubleT, SymbolT, Real>::Sample(
+	const PreprocessedTimeSeries<DoubleT, SymbolT>& history) const
+{
+	return sampler_->Transform(history);
+}
+
+} // namespace itp
+
+#endif // ITP_MARGINAL_PREDICTION_H_INCLUDED_
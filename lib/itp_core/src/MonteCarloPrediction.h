@@ -0,0 +1,347 @@
+/**
+ * Forecasting with the Monte Carlo estimation of means over continuations. Instead of enumerating all A^h continuations,
+ * a fixed number of them is drawn for each compressor (see CodeLengthsComputer::SampleContinuations), so the running
+ * time is linear in the number of samples and in the horizon. The means are estimated by importance sampling.
+ */
+
+#ifndef ITP_MONTE_CARLO_PREDICTION_H_INCLUDED_
+#define ITP_MONTE_CARLO_PREDICTION_H_INCLUDED_
+
+#include "CompressionPrediction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace itp
+{
+
+inline Double ElementwiseSqrt(Double value)
+{
+	return std::sqrt(value);
+}
+
+inline VectorDouble ElementwiseSqrt(VectorDouble value)
+{
+	for (auto& item : value)
+	{
+		item = std::sqrt(item);
+	}
+
+	return value;
+}
+
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
+class MonteCarloPredictor : public PointwisePredictor<OrigType, NewType>
+{
+public:
+	/**
+	 * \param[in] codes_lengths_computer Computer to draw continuations with.
+	 * \param[in] samples_count Number of continuations to draw for each compressor.
+	 * \param[in] seed Seed of the pseudorandom generator, forecasts with the same seed are equal.
+	 * \param[in] difference_order Order of differences to take before forecasting.
+	 */
+	MonteCarloPredictor(
+		CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer,
+		size_t samples_count,
+		size_t seed,
+		size_t difference_order = 0);
+
+	/**
+	 * The borders of the returned points are the bounds of the 95% confidence interval of the estimated mean, i.e.
+	 * they show the error of the Monte Carlo estimation rather than the uncertainty of the forecast.
+	 */
+	Forecast<OrigType> Predict(
+		PreprocessedTimeSeries<OrigType, NewType> history,
+		size_t horizont,
+		const CompressorNamesVec& compressor_groups) const final;
+
+protected:
+	virtual PreprocessedTimeSeries<OrigType, Symbol> Sample(
+		const PreprocessedTimeSeries<OrigType, NewType>& history) const = 0;
+
+private:
+	struct Estimate
+	{
+		std::vector<OrigType> means;
+		std::vector<OrigType> variances;
+
+		// Base-2 logarithm of the estimated sum of 2^(-code length) over all continuations.
+		Double log2_normalizer;
+	};
+
+	/**
+	 * Self-normalized importance sampling estimate of means for each step of continuations.
+	 */
+	Estimate EstimateMeans(
+		const WeightedContinuations& samples,
+		const PreprocessedTimeSeries<OrigType, Symbol>& history,
+		size_t horizont) const;
+
+	/**
+	 * The distribution of a group is the mixture of the distributions of its compressors, in which the weight of a
+	 * compressor is multiplied by its normalizer. The error of the weights of the mixture is neglected.
+	 */
+	Estimate MixEstimates(const std::vector<const Estimate*>& estimates, const std::vector<Double>& weights) const;
+
+	CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer_;
+	WeightsGeneratorPtr weights_generator_;
+	size_t samples_count_;
+	size_t seed_;
+	size_t difference_order_;
+
+	// The 0.975 quantile of the standard normal distribution.
+	static constexpr Double normal_quantile_ = 1.959963984540054;
+};
+
+template<typename DoubleT, typename Real = CodeProbability>
+class RealMonteCarloPredictor : public MonteCarloPredictor<DoubleT, DoubleT, Real>
+{
+public:
+	RealMonteCarloPredictor(
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+		SamplerPtr<DoubleT> sampler,
+		size_t partition_cardinality,
+		size_t samples_count,
+		size_t seed,
+		size_t difference_order = 0);
+
+protected:
+	PreprocessedTimeSeries<DoubleT, Symbol> Sample(const PreprocessedTimeSeries<DoubleT, DoubleT>& history) const override;
+
+private:
+	SamplerPtr<DoubleT> sampler_;
+	size_t partition_cardinality_;
+};
+
+template<typename DoubleT, typename SymbolT, typename Real = CodeProbability>
+class DiscreteMonteCarloPredictor : public MonteCarloPredictor<DoubleT, SymbolT, Real>
+{
+public:
+	DiscreteMonteCarloPredictor(
+		CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+		SamplerPtr<SymbolT> sampler,
+		size_t samples_count,
+		size_t seed,
+		size_t difference_order = 0);
+
+protected:
+	PreprocessedTimeSeries<DoubleT, Symbol> Sample(const PreprocessedTimeSeries<DoubleT, SymbolT>& history) const override;
+
+private:
+	SamplerPtr<SymbolT> sampler_;
+};
+
+template<typename OrigType, typename NewType, typename Real>
+MonteCarloPredictor<OrigType, NewType, Real>::MonteCarloPredictor(
+	CodeLengthsComputerPtr<OrigType, Real> codes_lengths_computer,
+	size_t samples_count,
+	size_t seed,
+	size_t difference_order)
+	: codes_lengths_computer_{codes_lengths_computer}
+	, weights_generator_{std::make_shared<WeightsGenerator>()}
+	, samples_count_{samples_count}
+	, seed_{seed}
+	, difference_order_{difference_order}
+{
+	assert(codes_lengths_computer != nullptr);
+	assert(samples_count != 0);
+}
+
+template<typename OrigType, typename NewType, typename Real>
+Forecast<OrigType> MonteCarloPredictor<OrigType, NewType, Real>::Predict(
+	PreprocessedTimeSeries<OrigType, NewType> history,
+	size_t horizont,
+	const CompressorNamesVec& compressor_groups) const
+{
+	const auto differentized_history = DiffN(history, difference_order_);
+	const auto sampled_history = Sample(differentized_history);
+	const auto distinct_single_compressors = FindAllDistinctNames(compressor_groups);
+	const auto samples = codes_lengths_computer_->SampleContinuations(
+		sampled_history,
+		horizont,
+		distinct_single_compressors,
+		samples_count_,
+		seed_);
+
+	// As in the exhaustive case, the forecasts are made for every single compressor and every group.
+	std::map<ConcatenatedCompressorNames, Estimate> estimates;
+	for (const auto& compressor : distinct_single_compressors)
+	{
+		estimates[compressor] = EstimateMeans(samples.at(compressor), sampled_history, horizont);
+	}
+	for (const auto& group : compressor_groups)
+	{
+		if (group.size() > 1)
+		{
+			std::vector<const Estimate*> group_estimates;
+			for (const auto& compressor : group)
+			{
+				group_estimates.push_back(&estimates.at(compressor));
+			}
+			estimates[ToConcatenatedCompressorNames(group)]
+				= MixEstimates(group_estimates, weights_generator_->Generate(group.size()));
+		}
+	}
+
+	Forecast<OrigType> result;
+	for (const auto& [name, estimate] : estimates)
+	{
+		for (size_t i = 0; i < horizont; ++i)
+		{
+			const auto error = ElementwiseSqrt(estimate.variances[i]) * normal_quantile_;
+			auto& point = result(name, i);
+			point.point = estimate.means[i];
+			point.left_border = estimate.means[i];
+			point.left_border -= error;
+			point.right_border = estimate.means[i];
+			point.right_border += error;
+		}
+	}
+	result.CopyPreprocessingInfoFrom(sampled_history);
+	Integrate(result);
+
+	return result;
+}
+
+template<typename OrigType, typename NewType, typename Real>
+typename MonteCarloPredictor<OrigType, NewType, Real>::Estimate MonteCarloPredictor<OrigType, NewType, Real>::
+	EstimateMeans(
+		const WeightedContinuations& samples,
+		const PreprocessedTimeSeries<OrigType, Symbol>& history,
+		size_t horizont) const
+{
+	const auto& log2_weights = samples.log2_weights;
+	assert(!log2_weights.empty());
+
+	// The weights differ by thousands of orders, so they are scaled by the maximal one.
+	const auto maximal_log2_weight = *std::max_element(std::cbegin(log2_weights), std::cend(log2_weights));
+	std::vector<Double> weights(std::size(log2_weights));
+	for (size_t i = 0; i < std::size(log2_weights); ++i)
+	{
+		weights[i] = std::exp2(log2_weights[i] - maximal_log2_weight);
+	}
+	const auto weights_sum = std::accumulate(std::cbegin(weights), std::cend(weights), Double{0});
+	for (auto& weight : weights)
+	{
+		weight /= weights_sum;
+	}
+
+	Sampler<OrigType> sampler;
+	std::vector<OrigType> values;
+	for (size_t symbol = 0; symbol < history.GetSamplingAlphabet(); ++symbol)
+	{
+		values.push_back(sampler.InverseTransform(static_cast<Symbol>(symbol), history));
+	}
+
+	Estimate estimate;
+	estimate.means.assign(horizont, ZeroInitialized<OrigType>(history));
+	estimate.variances.assign(horizont, ZeroInitialized<OrigType>(history));
+	for (size_t i = 0; i < horizont; ++i)
+	{
+		for (size_t j = 0; j < std::size(weights); ++j)
+		{
+			estimate.means[i] += values[samples.continuations[j][i]] * weights[j];
+		}
+
+		for (size_t j = 0; j < std::size(weights); ++j)
+		{
+			auto deviation = values[samples.continuations[j][i]];
+			deviation -= estimate.means[i];
+			deviation *= deviation;
+			estimate.variances[i] += deviation * (weights[j] * weights[j]);
+		}
+	}
+	estimate.log2_normalizer = maximal_log2_weight + std::log2(weights_sum / std::size(weights));
+
+	return estimate;
+}
+
+template<typename OrigType, typename NewType, typename Real>
+typename MonteCarloPredictor<OrigType, NewType, Real>::Estimate MonteCarloPredictor<OrigType, NewType, Real>::
+	MixEstimates(const std::vector<const Estimate*>& estimates, const std::vector<Double>& weights) const
+{
+	assert(!estimates.empty());
+	assert(estimates.size() == weights.size());
+
+	std::vector<Double> mixture_weights(estimates.size());
+	for (size_t i = 0; i < estimates.size(); ++i)
+	{
+		mixture_weights[i] = std::log2(weights[i]) + estimates[i]->log2_normalizer;
+	}
+	const auto maximal_log2_weight = *std::max_element(std::cbegin(mixture_weights), std::cend(mixture_weights));
+	for (auto& weight : mixture_weights)
+	{
+		weight = std::exp2(weight - maximal_log2_weight);
+	}
+	const auto weights_sum = std::accumulate(std::cbegin(mixture_weights), std::cend(mixture_weights), Double{0});
+	for (auto& weight : mixture_weights)
+	{
+		weight /= weights_sum;
+	}
+
+	const auto horizont = estimates[0]->means.size();
+	Estimate mixture;
+	mixture.means = estimates[0]->means;
+	mixture.variances = estimates[0]->variances;
+	for (size_t i = 0; i < horizont; ++i)
+	{
+		mixture.means[i] *= mixture_weights[0];
+		mixture.variances[i] *= mixture_weights[0] * mixture_weights[0];
+		for (size_t j = 1; j < estimates.size(); ++j)
+		{
+			mixture.means[i] += estimates[j]->means[i] * mixture_weights[j];
+			mixture.variances[i] += estimates[j]->variances[i] * (mixture_weights[j] * mixture_weights[j]);
+		}
+	}
+	mixture.log2_normalizer = maximal_log2_weight + std::log2(weights_sum);
+
+	return mixture;
+}
+
+template<typename DoubleT, typename Real>
+RealMonteCarloPredictor<DoubleT, Real>::RealMonteCarloPredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+	SamplerPtr<DoubleT> sampler,
+	size_t partition_cardinality,
+	size_t samples_count,
+	size_t seed,
+	size_t difference_order)
+	: MonteCarloPredictor<DoubleT, DoubleT, Real>{codes_lengths_computer, samples_count, seed, difference_order}
+	, sampler_{sampler}
+	, partition_cardinality_{partition_cardinality}
+{
+	assert(sampler != nullptr);
+}
+
+template<typename DoubleT, typename Real>
+PreprocessedTimeSeries<DoubleT, Symbol> RealMonteCarloPredictor<DoubleT, Real>::Sample(
+	const PreprocessedTimeSeries<DoubleT, DoubleT>& history) const
+{
+	return sampler_->Transform(history, partition_cardinality_);
+}
+
+template<typename DoubleT, typename SymbolT, typename Real>
+DiscreteMonteCarloPredictor<DoubleT, SymbolT, Real>::DiscreteMonteCarloPredictor(
+	CodeLengthsComputerPtr<DoubleT, Real> codes_lengths_computer,
+	SamplerPtr<SymbolT> sampler,
+	size_t samples_count,
+	size_t seed,
+	size_t difference_order)
+	: MonteCarloPredictor<DoubleT, SymbolT, Real>{codes_lengths_computer, samples_count, seed, difference_order}
+	, sampler_{sampler}
+{
+	assert(sampler != nullptr);
+}
+
+template<typename DoubleT, typename SymbolT, typename Real>
+PreprocessedTimeSeries<DoubleT, Symbol> DiscreteMonteCarloPredictor<DoubleT, SymbolT, Real>::Sample(
+	const PreprocessedTimeSeries<DoubleT, SymbolT>& history) const
+{
+	return sampler_->Transform(history);
+}
+
+} // namespace itp
+
+#endif // ITP_MONTE_CARLO_PREDICTION_H_INCLUDED_
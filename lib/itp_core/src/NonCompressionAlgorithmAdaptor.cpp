@@ -1,5 +1,6 @@
 #include "NonCompressionAlgorithmAdaptor.h"
 
+#include <algorithm>
 #include <numeric>
 
 namespace itp
@@ -15,6 +16,37 @@ HighPrecDouble KrichevskyPredictor(const size_t sym_freq, const size_t total_fre
 
 } // namespace
 
+/**
+ * Keeps all the processed data, because the adapted algorithm needs the whole prefix to make the next prediction.
+ */
+class NonCompressionAlgorithmAdaptor::Checkpoint : public ICompressionCheckpoint
+{
+public:
+	explicit Checkpoint(const NonCompressionAlgorithmAdaptor* adaptor)
+		: adaptor_{adaptor}
+		, state_{*adaptor->alphabet_max_symbol_}
+	{
+		// DO NOTHING
+	}
+
+	std::unique_ptr<ICompressionCheckpoint> Fork() const override { return std::make_unique<Checkpoint>(*this); }
+
+	void Append(const unsigned char* data, size_t size) override
+	{
+		data_.insert(std::end(data_), data, data + size);
+		adaptor_->EvaluateProbability(data_.data(), std::size(data_), &state_);
+	}
+
+	SizeInBits CodeLength() override { return ToCodeLengths(state_.evaluated_probability); }
+
+	bool HasMonotoneCodeLengths() const override { return true; }
+
+private:
+	const NonCompressionAlgorithmAdaptor* adaptor_;
+	std::vector<unsigned char> data_;
+	InternalState state_;
+};
+
 NonCompressionAlgorithmAdaptor::NonCompressionAlgorithmAdaptor(INonCompressionAlgorithm* non_compression_algorithm)
 	: non_compression_algorithm_{std::move(non_compression_algorithm)}
 {
@@ -52,33 +84,32 @@ std::vector<NonCompressionAlgorithmAdaptor::SizeInBits> NonCompressionAlgorithmA
 		return {};
 	}
 
-	if (!alphabet_min_symbol_ || !alphabet_max_symbol_)
+	const auto history_checkpoint = MakeCheckpoint(historical_values.data(), std::size(historical_values));
+	return CompressContinuationsFromCheckpoint(*history_checkpoint, possible_endings, pruning_slack_);
+}
+
+ICompressionCheckpointPtr NonCompressionAlgorithmAdaptor::MakeCheckpoint(const unsigned char* data, size_t size)
+{
+	if (data == nullptr && size != 0)
 	{
-		const auto [min, max] = std::minmax_element(std::cbegin(historical_values), std::cend(historical_values));
-		SetTsParams(*min, *max);
+		throw std::runtime_error{"data is nullptr"};
 	}
 
-	InternalState history_state(*alphabet_max_symbol_);
-	EvaluateProbability(historical_values.data(), historical_values.size(), &history_state);
-
-	std::vector<unsigned char> input_buffer(std::size(historical_values) + std::size(possible_endings.front()));
-	std::copy(std::cbegin(historical_values), std::cend(historical_values), std::begin(input_buffer));
+	if ((!alphabet_min_symbol_ || !alphabet_max_symbol_) && size != 0)
+	{
+		const auto [min, max] = std::minmax_element(data, data + size);
+		SetTsParams(*min, *max);
+	}
 
-	std::vector<unsigned char> output_buffer;
-	std::vector<SizeInBits> result(std::size(possible_endings));
-	for (size_t i = 0; i < std::size(possible_endings); ++i)
+	if (!alphabet_min_symbol_ || !alphabet_max_symbol_)
 	{
-		std::copy(
-			possible_endings[i].cbegin(),
-			possible_endings[i].cend(),
-			std::next(std::begin(input_buffer), std::size(historical_values)));
-
-		auto full_state = history_state;
-		EvaluateProbability(input_buffer.data(), std::size(input_buffer), &full_state);
-		result[i] = ToCodeLengths(full_state.evaluated_probability);
+		throw std::runtime_error{"alphabet is unknown"};
 	}
 
-	return result;
+	auto checkpoint = std::make_unique<Checkpoint>(this);
+	checkpoint->Append(data, size);
+
+	return checkpoint;
 }
 
 void NonCompressionAlgorithmAdaptor::SetTsParams(const Symbol alphabet_min_symbol, const Symbol alphabet_max_symbol)
@@ -89,6 +120,16 @@ void NonCompressionAlgorithmAdaptor::SetTsParams(const Symbol alphabet_min_symbo
 	non_compression_algorithm_->SetTsParams(alphabet_min_symbol, alphabet_max_symbol);
 }
 
+void NonCompressionAlgorithmAdaptor::SetPruningSlack(std::optional<SizeInBits> slack_in_bits)
+{
+	pruning_slack_ = slack_in_bits;
+}
+
+std::unique_ptr<ICompressor> NonCompressionAlgorithmAdaptor::Clone() const
+{
+	return nullptr;
+}
+
 void NonCompressionAlgorithmAdaptor::EvaluateProbability(
 	const unsigned char* data,
 	size_t size,
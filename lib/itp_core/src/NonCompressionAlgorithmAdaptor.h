@@ -22,7 +22,18 @@ public:
 
 	void SetTsParams(Symbol alphabet_min_symbol, Symbol alphabet_max_symbol) override;
 
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override;
+
+	void SetPruningSlack(std::optional<SizeInBits> slack_in_bits) override;
+
+	/**
+	 * The wrapped algorithm is owned by the caller and cannot be duplicated, so the adaptor cannot be cloned.
+	 */
+	std::unique_ptr<ICompressor> Clone() const override;
+
 private:
+	class Checkpoint;
+
 	struct InternalState
 	{
 		explicit InternalState(Symbol alphabet_max_symbol)
@@ -55,6 +66,7 @@ private:
 
 	std::optional<Symbol> alphabet_min_symbol_ = std::nullopt;
 	std::optional<Symbol> alphabet_max_symbol_ = std::nullopt;
+	std::optional<SizeInBits> pruning_slack_ = std::nullopt;
 };
 
 } // namespace itp
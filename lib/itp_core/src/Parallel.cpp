@@ -0,0 +1,70 @@
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace itp
+{
+
+void RunInParallel(size_t threads_count, size_t tasks_count, const std::function<void(size_t, size_t)>& task)
+{
+	const auto workers_count = std::max<size_t>(1, std::min(threads_count, tasks_count));
+	if (workers_count == 1)
+	{
+		for (size_t i = 0; i < tasks_count; ++i)
+		{
+			task(0, i);
+		}
+
+		return;
+	}
+
+	std::atomic<size_t> next_task{0};
+	std::atomic<bool> failed{false};
+	std::exception_ptr first_error;
+	std::mutex error_mutex;
+
+	const auto worker = [&](size_t worker_index)
+	{
+		for (auto i = next_task++; i < tasks_count && !failed; i = next_task++)
+		{
+			try
+			{
+				task(worker_index, i);
+			}
+			catch (...)
+			{
+				std::lock_guard lock{error_mutex};
+				if (!first_error)
+				{
+					first_error = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers_count - 1);
+	for (size_t i = 1; i < workers_count; ++i)
+	{
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (first_error)
+	{
+		std::rethrow_exception(first_error);
+	}
+}
+
+} // namespace itp
@@ -0,0 +1,29 @@
+/**
+ * Helpers to spread independent pieces of work among several threads.
+ */
+
+#ifndef ITP_PARALLEL_H_INCLUDED_
+#define ITP_PARALLEL_H_INCLUDED_
+
+#include <cstddef>
+#include <functional>
+
+namespace itp
+{
+
+/**
+ * Executes tasks with numbers 0...tasks_count-1 using up to threads_count threads (including the calling one). Tasks
+ * are distributed dynamically: each thread takes the next unprocessed task as soon as it finishes the previous one.
+ * If any task throws, no new tasks are started and the first exception is rethrown in the calling thread after all
+ * threads have finished.
+ *
+ * \param[in] threads_count Maximal number of threads to use. Zero is treated as one.
+ * \param[in] tasks_count Number of tasks.
+ * \param[in] task A function, which receives the index of the worker (0...threads_count-1) executing the task and the
+ *     number of the task. Calls with the same worker index are never made concurrently.
+ */
+void RunInParallel(size_t threads_count, size_t tasks_count, const std::function<void(size_t, size_t)>& task);
+
+} // namespace itp
+
+#endif // ITP_PARALLEL_H_INCLUDED_
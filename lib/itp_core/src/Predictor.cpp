@@ -3,6 +3,9 @@
 #include "Builders.h"
 #include "CompressionPrediction.h"
 #include "NonCompressionAlgorithmAdaptor.h"
+#include "Parallel.h"
+
+#include <algorithm>
 
 namespace itp
 {
@@ -108,11 +111,60 @@ std::map<std::string, std::vector<std::vector<double>>> Convert(
 }
 
 InformationTheoreticPredictor::InformationTheoreticPredictor()
-	: compressors_(itp::MakeStandardCompressorsPool())
+	: compressors_(std::make_shared<CompressorsLeasingPool>(itp::MakeStandardCompressorsPool()))
+	, numeric_backend_{kDefaultNumericBackend}
 {
 	// DO NOTHING
 }
 
+template<typename ForecastingAlgorithm>
+void InformationTheoreticPredictor::Configure(ForecastingAlgorithm& forecasting_algorithm) const
+{
+	std::lock_guard lock{mutex_};
+	forecasting_algorithm.SetThreadsCount(threads_count_);
+	forecasting_algorithm.SetNumericBackend(numeric_backend_);
+	forecasting_algorithm.SetPruningSlack(pruning_slack_);
+	forecasting_algorithm.SetMonteCarloSampling(monte_carlo_samples_count_, monte_carlo_seed_);
+}
+
+void InformationTheoreticPredictor::SetDiscardedProbabilityBound(Double bound)
+{
+	std::lock_guard lock{mutex_};
+	discarded_probability_bounds_[std::this_thread::get_id()] = bound;
+}
+
+template<typename Series, typename MakeAlgorithm, typename Forecast>
+auto InformationTheoreticPredictor::ForecastBatch(
+	const std::vector<Series>& batch,
+	MakeAlgorithm make_algorithm,
+	Forecast forecast)
+{
+	size_t threads_count;
+	{
+		std::lock_guard lock{mutex_};
+		threads_count = std::max<size_t>(threads_count_, 1);
+	}
+
+	std::vector<decltype(make_algorithm())> algorithms(threads_count);
+	std::vector<decltype(forecast(*make_algorithm(), batch.front()))> results(std::size(batch));
+	std::vector<Double> discarded_probability_bounds(threads_count, 0.);
+	RunInParallel(threads_count, std::size(batch), [&](size_t worker, size_t series_number) {
+		auto& algorithm = algorithms[worker];
+		if (!algorithm)
+		{
+			algorithm = make_algorithm();
+		}
+
+		results[series_number] = forecast(*algorithm, batch[series_number]);
+		discarded_probability_bounds[worker] =
+			std::max(discarded_probability_bounds[worker], algorithm->GetDiscardedProbabilityBound());
+	});
+	SetDiscardedProbabilityBound(
+		*std::max_element(std::cbegin(discarded_probability_bounds), std::cend(discarded_probability_bounds)));
+
+	return results;
+}
+
 std::map<std::string, std::vector<itp::Double>> InformationTheoreticPredictor::ForecastReal(
 	const std::vector<itp::Double>& time_series,
 	const itp::ConcatenatedCompressorNamesVec& compressors_groups,
@@ -125,8 +177,12 @@ std::map<std::string, std::vector<itp::Double>> InformationTheoreticPredictor::F
 	CheckQuantaCountRange(quanta_count);
 
 	ForecastingAlgorithmReal<itp::Double> forecasting_algorithm(compressors_);
+	Configure(forecasting_algorithm);
 	forecasting_algorithm.SetQuantaCount(quanta_count);
-	return forecasting_algorithm(time_series, compressors_groups, horizon, difference, sparse);
+	auto result = forecasting_algorithm(time_series, compressors_groups, horizon, difference, sparse);
+	SetDiscardedProbabilityBound(forecasting_algorithm.GetDiscardedProbabilityBound());
+
+	return result;
 }
 
 std::map<std::string, std::vector<itp::Double>> InformationTheoreticPredictor::ForecastMultialphabet(
@@ -145,11 +201,15 @@ std::map<std::string, std::vector<itp::Double>> InformationTheoreticPredictor::F
 	}
 
 	ForecastingAlgorithmMultialphabet<itp::Double> forecasting_algorithm(compressors_);
+	Configure(forecasting_algorithm);
 	forecasting_algorithm.SetQuantaCount(max_quanta_count);
 
 	std::vector<itp::Double> transformed_history;
 	std::copy(begin(history), end(history), std::back_inserter(transformed_history));
-	return forecasting_algorithm(transformed_history, concatenated_compressor_groups, horizon, difference, sparse);
+	auto result = forecasting_algorithm(transformed_history, concatenated_compressor_groups, horizon, difference, sparse);
+	SetDiscardedProbabilityBound(forecasting_algorithm.GetDiscardedProbabilityBound());
+
+	return result;
 }
 
 std::map<std::string, std::vector<std::vector<double>>> InformationTheoreticPredictor::ForecastMultialphabetVec(
@@ -168,10 +228,13 @@ std::map<std::string, std::vector<std::vector<double>>> InformationTheoreticPred
 	}
 
 	ForecastingAlgorithmMultialphabet<itp::VectorDouble> forecasting_algorithm{compressors_};
+	Configure(forecasting_algorithm);
 	forecasting_algorithm.SetQuantaCount(max_quanta_count);
 
-	return Convert(
-		forecasting_algorithm(Convert(history), concatenated_compressor_groups, horizon, difference, sparse));
+	auto result = Convert(forecasting_algorithm(Convert(history), concatenated_compressor_groups, horizon, difference, sparse));
+	SetDiscardedProbabilityBound(forecasting_algorithm.GetDiscardedProbabilityBound());
+
+	return result;
 }
 
 std::map<std::string, std::vector<itp::Double>> InformationTheoreticPredictor::ForecastDiscrete(
@@ -184,7 +247,11 @@ std::map<std::string, std::vector<itp::Double>> InformationTheoreticPredictor::F
 	CheckArgs(horizon, difference, sparse);
 
 	ForecastingAlgorithmDiscrete<itp::Double, itp::Symbol> forecasting_algorithm{compressors_};
-	return forecasting_algorithm(history, concatenated_compressor_groups, horizon, difference, sparse);
+	Configure(forecasting_algorithm);
+	auto result = forecasting_algorithm(history, concatenated_compressor_groups, horizon, difference, sparse);
+	SetDiscardedProbabilityBound(forecasting_algorithm.GetDiscardedProbabilityBound());
+
+	return result;
 }
 
 std::map<std::string, std::vector<itp::VectorDouble>> InformationTheoreticPredictor::ForecastDiscreteVec(
@@ -197,7 +264,95 @@ std::map<std::string, std::vector<itp::VectorDouble>> InformationTheoreticPredic
 	CheckArgs(horizon, difference, sparse);
 
 	ForecastingAlgorithmDiscrete<itp::VectorDouble, itp::VectorSymbol> forecasting_algorithm{compressors_};
-	return forecasting_algorithm(history, concatenated_compressor_groups, horizon, difference, sparse);
+	Configure(forecasting_algorithm);
+	auto result = forecasting_algorithm(history, concatenated_compressor_groups, horizon, difference, sparse);
+	SetDiscardedProbabilityBound(forecasting_algorithm.GetDiscardedProbabilityBound());
+
+	return result;
+}
+
+std::vector<std::map<std::string, std::vector<itp::Double>>> InformationTheoreticPredictor::ForecastRealBatch(
+	const std::vector<std::vector<itp::Double>>& batch,
+	const itp::ConcatenatedCompressorNamesVec& concatenated_compressor_groups,
+	size_t horizon,
+	size_t difference,
+	size_t quanta_count,
+	int sparse)
+{
+	CheckArgs(horizon, difference, sparse);
+	CheckQuantaCountRange(quanta_count);
+
+	return ForecastBatch(
+		batch,
+		[this, quanta_count] {
+			auto forecasting_algorithm = std::make_unique<ForecastingAlgorithmReal<itp::Double>>(compressors_);
+			Configure(*forecasting_algorithm);
+			forecasting_algorithm->SetThreadsCount(1);
+			forecasting_algorithm->SetQuantaCount(quanta_count);
+			return forecasting_algorithm;
+		},
+		[&](auto& forecasting_algorithm, const auto& time_series) {
+			return forecasting_algorithm(time_series, concatenated_compressor_groups, horizon, difference, sparse);
+		});
+}
+
+std::vector<std::map<std::string, std::vector<itp::Double>>> InformationTheoreticPredictor::ForecastMultialphabetBatch(
+	const std::vector<std::vector<double>>& batch,
+	const itp::ConcatenatedCompressorNamesVec& concatenated_compressor_groups,
+	size_t horizon,
+	size_t difference,
+	size_t max_quanta_count,
+	int sparse)
+{
+	CheckArgs(horizon, difference, sparse);
+	CheckQuantaCountRange(max_quanta_count);
+	if (!itp::IsPowerOfTwo(max_quanta_count))
+	{
+		throw std::invalid_argument("Max quants count should be greater a power of two.");
+	}
+
+	return ForecastBatch(
+		batch,
+		[this, max_quanta_count] {
+			auto forecasting_algorithm =
+				std::make_unique<ForecastingAlgorithmMultialphabet<itp::Double>>(compressors_);
+			Configure(*forecasting_algorithm);
+			forecasting_algorithm->SetThreadsCount(1);
+			forecasting_algorithm->SetQuantaCount(max_quanta_count);
+			return forecasting_algorithm;
+		},
+		[&](auto& forecasting_algorithm, const auto& history) {
+			const std::vector<itp::Double> transformed_history(std::cbegin(history), std::cend(history));
+			return forecasting_algorithm(
+				transformed_history,
+				concatenated_compressor_groups,
+				horizon,
+				difference,
+				sparse);
+		});
+}
+
+std::vector<std::map<std::string, std::vector<itp::Double>>> InformationTheoreticPredictor::ForecastDiscreteBatch(
+	const std::vector<std::vector<itp::Symbol>>& batch,
+	const ConcatenatedCompressorNamesVec& concatenated_compressor_groups,
+	size_t horizon,
+	size_t difference,
+	int sparse)
+{
+	CheckArgs(horizon, difference, sparse);
+
+	return ForecastBatch(
+		batch,
+		[this] {
+			auto forecasting_algorithm =
+				std::make_unique<ForecastingAlgorithmDiscrete<itp::Double, itp::Symbol>>(compressors_);
+			Configure(*forecasting_algorithm);
+			forecasting_algorithm->SetThreadsCount(1);
+			return forecasting_algorithm;
+		},
+		[&](auto& forecasting_algorithm, const auto& history) {
+			return forecasting_algorithm(history, concatenated_compressor_groups, horizon, difference, sparse);
+		});
 }
 
 void InformationTheoreticPredictor::RegisterNonCompressionAlgorithm(
@@ -208,4 +363,41 @@ void InformationTheoreticPredictor::RegisterNonCompressionAlgorithm(
 	compressors_->RegisterCompressor(name, std::move(compressor));
 }
 
+void InformationTheoreticPredictor::SetThreadsCount(size_t threads_count)
+{
+	std::lock_guard lock{mutex_};
+	threads_count_ = threads_count;
+}
+
+void InformationTheoreticPredictor::SetNumericBackend(NumericBackend numeric_backend)
+{
+	std::lock_guard lock{mutex_};
+	numeric_backend_ = numeric_backend;
+}
+
+void InformationTheoreticPredictor::SetPruningSlack(std::optional<size_t> slack_in_bits)
+{
+	std::lock_guard lock{mutex_};
+	pruning_slack_ = slack_in_bits;
+}
+
+Double InformationTheoreticPredictor::GetDiscardedProbabilityBound() const
+{
+	std::lock_guard lock{mutex_};
+	const auto bound = discarded_probability_bounds_.find(std::this_thread::get_id());
+	return bound != std::cend(discarded_probability_bounds_) ? bound->second : 0.;
+}
+
+void InformationTheoreticPredictor::SetMonteCarloSampling(std::optional<size_t> samples_count, size_t seed)
+{
+	if (samples_count && *samples_count == 0)
+	{
+		throw std::invalid_argument("Number of samples should be greater than zero");
+	}
+
+	std::lock_guard lock{mutex_};
+	monte_carlo_samples_count_ = samples_count;
+	monte_carlo_seed_ = seed;
+}
+
 } // namespace itp
@@ -2,27 +2,31 @@
 #define ITP_PREDICTOR_SUBTYPES_H_INCLUDED_
 
 #include "ItpExceptions.h"
+#include "Parallel.h"
 #include "Sampler.h"
 #include "TableTransformations.h"
 #include "Types.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <vector>
 
 namespace itp
 {
 
-template<typename T>
-std::ostream& operator<<(std::ostream& ost, const ContinuationsDistribution<T>& table);
+template<typename T, typename Real>
+std::ostream& operator<<(std::ostream& ost, const ContinuationsDistribution<T, Real>& table);
 
 constexpr bool IsPowerOfTwo(std::size_t number)
 {
 	return (number > 0 && ((number & (number - 1)) == 0));
 }
 
-template<typename OrigType, typename NewType>
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
 class DistributionPredictor
 {
 	// static_assert(std::is_arithmetic<NewType>::value, "NewType should be an arithmetic type");
@@ -30,14 +34,14 @@ class DistributionPredictor
 public:
 	virtual ~DistributionPredictor() = default;
 
-	virtual ContinuationsDistribution<OrigType> Predict(
+	virtual ContinuationsDistribution<OrigType, Real> Predict(
 		PreprocessedTimeSeries<OrigType, NewType> history,
 		size_t horizont,
 		const CompressorNamesVec& compressor_groups) const = 0;
 };
 
-template<typename OrigType, typename NewType>
-using DistributionPredictorPtr = std::shared_ptr<DistributionPredictor<OrigType, NewType>>;
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
+using DistributionPredictorPtr = std::shared_ptr<DistributionPredictor<OrigType, NewType, Real>>;
 
 template<typename OrigType, typename NewType>
 class PointwisePredictor
@@ -56,18 +60,18 @@ public:
 template<typename OrigType, typename NewType>
 using PointwisePredictorPtr = std::shared_ptr<PointwisePredictor<OrigType, NewType>>;
 
-template<typename OrigType, typename NewType>
+template<typename OrigType, typename NewType, typename Real = CodeProbability>
 class BasicPointwisePredictor : public PointwisePredictor<OrigType, NewType>
 {
 public:
-	BasicPointwisePredictor(DistributionPredictorPtr<OrigType, NewType> distribution_predictor);
+	BasicPointwisePredictor(DistributionPredictorPtr<OrigType, NewType, Real> distribution_predictor);
 	Forecast<OrigType> Predict(
 		PreprocessedTimeSeries<OrigType, NewType> history,
 		size_t horizont,
 		const CompressorNamesVec& compressor_groups) const override;
 
 private:
-	DistributionPredictorPtr<OrigType, NewType> distribution_predictor_;
+	DistributionPredictorPtr<OrigType, NewType, Real> distribution_predictor_;
 };
 
 /**
@@ -80,13 +84,33 @@ class SparsePredictor : public PointwisePredictor<OrigType, NewType>
 public:
 	SparsePredictor(PointwisePredictorPtr<OrigType, NewType> pointwise_predictor, size_t sparse);
 
+	/**
+	 * The forecasts by the full history and by the sub-series are made in parallel, one thread per predictor.
+	 *
+	 * \param pointwise_predictors Predictors, which are equivalent, but do not share a state, so can be used
+	 * concurrently.
+	 */
+	SparsePredictor(std::vector<PointwisePredictorPtr<OrigType, NewType>> pointwise_predictors, size_t sparse);
+
 	Forecast<OrigType> Predict(
 		PreprocessedTimeSeries<OrigType, NewType> history,
 		size_t horizont,
 		const CompressorNamesVec& compressor_groups) const override final;
 
+	/**
+	 * \return The number of forecasts made for the horizont: one by the full history and one by each sub-series,
+	 * which forecasts are used.
+	 */
+	static size_t CountPasses(size_t sparse, size_t horizont);
+
 private:
-	PointwisePredictorPtr<OrigType, NewType> pointwise_predictor_;
+	/**
+	 * The first ceil(h / sparse) steps are taken from the forecast by the full history, so the sub-series, which
+	 * steps all fall among them, are not forecasted. There are no such sub-series if sparse is 1.
+	 */
+	static std::vector<size_t> FindUsedSubSeries(size_t sparse, size_t horizont);
+
+	std::vector<PointwisePredictorPtr<OrigType, NewType>> pointwise_predictors_;
 	size_t sparse_;
 };
 
@@ -98,8 +122,8 @@ void AddValueToEach(Forward_iterator first, Forward_iterator last, T value);
 
 } // namespace itp
 
-template<typename T>
-std::ostream& itp::operator<<(std::ostream& ost, const ContinuationsDistribution<T>& table)
+template<typename T, typename Real>
+std::ostream& itp::operator<<(std::ostream& ost, const ContinuationsDistribution<T, Real>& table)
 {
 	ost << "-\t";
 	for (const auto& compressor : table.GetFactors())
@@ -126,21 +150,33 @@ itp::Forecast<OrigType> itp::SparsePredictor<OrigType, NewType>::Predict(
 	size_t horizont,
 	const CompressorNamesVec& compressor_groups) const
 {
+	const size_t sparsed_horizont = ceil(horizont / static_cast<double>(sparse_));
+	const auto used_sub_series = FindUsedSubSeries(sparse_, horizont);
 	std::vector<Forecast<OrigType>> results(sparse_);
-	size_t sparsed_horizont = ceil(horizont / static_cast<double>(sparse_));
-	for (size_t i = 0; i < sparse_; ++i)
-	{
-		PreprocessedTimeSeries<OrigType, NewType> sparse_ts_data;
-		sparse_ts_data.CopyPreprocessingInfoFrom(history);
-		for (size_t j = i; j < history.size(); j += sparse_)
-		{
-			sparse_ts_data.push_back(history[j]);
-		}
-		results[i] = pointwise_predictor_->Predict(sparse_ts_data, sparsed_horizont, compressor_groups);
-	}
+	Forecast<OrigType> full_first_steps;
+
+	// The task 0 is the forecasting by the full history, the others are the forecasting by the used sub-series.
+	RunInParallel(std::size(pointwise_predictors_), std::size(used_sub_series) + 1,
+		[&](size_t worker_index, size_t task_number) {
+			const auto& pointwise_predictor = pointwise_predictors_[worker_index];
+			if (task_number == 0)
+			{
+				full_first_steps = pointwise_predictor->Predict(history, sparsed_horizont, compressor_groups);
+				return;
+			}
+
+			const size_t i = used_sub_series[task_number - 1];
+			PreprocessedTimeSeries<OrigType, NewType> sparse_ts_data;
+			sparse_ts_data.CopyPreprocessingInfoFrom(history);
+			sparse_ts_data.reserve((std::size(history) + sparse_ - 1 - i) / sparse_);
+			for (size_t j = i; j < history.size(); j += sparse_)
+			{
+				sparse_ts_data.push_back(history[j]);
+			}
+			results[i] = pointwise_predictor->Predict(std::move(sparse_ts_data), sparsed_horizont, compressor_groups);
+		});
 
 	Forecast<OrigType> result;
-	Forecast<OrigType> full_first_steps = pointwise_predictor_->Predict(history, sparsed_horizont, compressor_groups);
 	for (size_t i = 0; i < sparsed_horizont; ++i)
 	{
 		for (const auto& compressor : full_first_steps.GetIndex())
@@ -165,16 +201,16 @@ itp::Forecast<OrigType> itp::SparsePredictor<OrigType, NewType>::Predict(
 	return result;
 }
 
-template<typename OrigType, typename NewType>
-itp::BasicPointwisePredictor<OrigType, NewType>::BasicPointwisePredictor(
-	DistributionPredictorPtr<OrigType, NewType> distribution_predictor)
+template<typename OrigType, typename NewType, typename Real>
+itp::BasicPointwisePredictor<OrigType, NewType, Real>::BasicPointwisePredictor(
+	DistributionPredictorPtr<OrigType, NewType, Real> distribution_predictor)
 	: distribution_predictor_{distribution_predictor}
 {
 	// DO NOTHING
 }
 
-template<typename OrigType, typename NewType>
-itp::Forecast<OrigType> itp::BasicPointwisePredictor<OrigType, NewType>::Predict(
+template<typename OrigType, typename NewType, typename Real>
+itp::Forecast<OrigType> itp::BasicPointwisePredictor<OrigType, NewType, Real>::Predict(
 	PreprocessedTimeSeries<OrigType, NewType> ts,
 	size_t horizont,
 	const CompressorNamesVec& compressor_groups) const
@@ -189,10 +225,49 @@ template<typename OrigType, typename NewType>
 itp::SparsePredictor<OrigType, NewType>::SparsePredictor(
 	PointwisePredictorPtr<OrigType, NewType> pointwise_predictor,
 	size_t sparse)
-	: pointwise_predictor_{pointwise_predictor}
+	: SparsePredictor{std::vector<PointwisePredictorPtr<OrigType, NewType>>{pointwise_predictor}, sparse}
+{
+	// DO NOTHING
+}
+
+template<typename OrigType, typename NewType>
+itp::SparsePredictor<OrigType, NewType>::SparsePredictor(
+	std::vector<PointwisePredictorPtr<OrigType, NewType>> pointwise_predictors,
+	size_t sparse)
+	: pointwise_predictors_{std::move(pointwise_predictors)}
 	, sparse_{sparse}
 {
-	assert(pointwise_predictor != nullptr);
+	assert(!pointwise_predictors_.empty());
+	assert(std::all_of(std::begin(pointwise_predictors_), std::end(pointwise_predictors_),
+		[](const auto& pointwise_predictor) { return pointwise_predictor != nullptr; }));
+}
+
+template<typename OrigType, typename NewType>
+size_t itp::SparsePredictor<OrigType, NewType>::CountPasses(size_t sparse, size_t horizont)
+{
+	return std::size(FindUsedSubSeries(sparse, horizont)) + 1;
+}
+
+template<typename OrigType, typename NewType>
+std::vector<size_t> itp::SparsePredictor<OrigType, NewType>::FindUsedSubSeries(size_t sparse, size_t horizont)
+{
+	const size_t sparsed_horizont = ceil(horizont / static_cast<double>(sparse));
+	std::vector<bool> used(sparse, false);
+	for (size_t step = sparsed_horizont; step < horizont; ++step)
+	{
+		used[step % sparse] = true;
+	}
+
+	std::vector<size_t> used_sub_series;
+	for (size_t i = 0; i < sparse; ++i)
+	{
+		if (used[i])
+		{
+			used_sub_series.push_back(i);
+		}
+	}
+
+	return used_sub_series;
 }
 
 template<typename Forward_iterator, typename New_value>
@@ -1,6 +1,7 @@
 #ifndef FTABLE_H_INCLUDED
 #define FTABLE_H_INCLUDED
 
+#include "ContinuationsTable.h"
 #include "DataFrame.h"
 #include "PreprocInfo.h"
 #include <iostream>
@@ -17,6 +18,18 @@ public:
 	using DataFrame<Index, Factor, TableValue>::DataFrame;
 };
 
+/**
+ * Tables indexed by continuations are stored densely, see ContinuationsTable.
+ */
+template<typename Factor, typename TableValue, typename OrigValue>
+class TableWithPreprocInfo<Continuation<Symbol>, Factor, TableValue, OrigValue>
+	: public ContinuationsTable<Factor, TableValue>
+	, public PreprocInfo<OrigValue>
+{
+public:
+	using ContinuationsTable<Factor, TableValue>::ContinuationsTable;
+};
+
 template<typename Index, typename Factor, typename TableValue, typename OrigValue>
 std::ostream& operator<<(
 	std::ostream& ost,
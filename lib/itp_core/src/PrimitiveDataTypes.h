@@ -71,6 +71,18 @@ using CompressorNamesVec = std::vector<CompressorNames>;
 using ConcatenatedCompressorNames = std::string;
 using ConcatenatedCompressorNamesVec = std::vector<ConcatenatedCompressorNames>;
 
+/**
+ * Numeric representation of code lengths and probabilities of continuations.
+ */
+enum class NumericBackend
+{
+	// Software floating-point numbers with a huge exponent (slow, but exact enough for any series).
+	HighPrecision,
+	// Base-2 logarithms of the values stored in doubles, sums are computed with the log-sum-exp trick. The forecasts
+	// differ from the HighPrecision ones by less than 1e-9 (relative).
+	LogDomain
+};
+
 inline std::string operator"" _s(const char* str, size_t size)
 {
 	return std::string(str, size);
@@ -29,16 +29,47 @@ SensingDFA::SensingDFA(Symbol min_symbol, Symbol max_symbol)
 	SetHeadName(9, "t");
 }
 
+SensingDFA::SensingDFA(const SensingDFA& other)
+	: MultiheadAutomaton<10>{other}
+	, h3a_{h(0)}
+	, inner_{h(5)}
+	, outer_{h(6)}
+	, l_{h(7)}
+	, r_{h(8)}
+	, t_{h(9)}
+	, resume_points_{other.resume_points_}
+{
+	// DO NOTHING
+}
+
+std::unique_ptr<PredictionAutomaton> SensingDFA::Clone() const
+{
+	return std::make_unique<SensingDFA>(*this);
+}
+
+void SensingDFA::Init()
+{
+	MultiheadAutomaton<10>::Init();
+	resume_points_ = ResumePoints{};
+}
+
 void SensingDFA::Run()
 {
+	MainLoop();
+}
+
+bool SensingDFA::MainLoop()
+{
+	BEGIN_RESUMABLE(resume_points_.main_loop);
 	while (less(h(4), a.size()))
 	{
-		GuessIfRightmost(r_, IsPredictionConfident::No);
-		if (!Move(r_) || !Correction() || !Matching())
-		{
-			return;
-		}
+		EXIT_IF_IMPOSSIBLE(resume_points_.main_loop, GuessAndMove(r_, IsPredictionConfident::No));
+		EXIT_IF_IMPOSSIBLE(resume_points_.main_loop, Correction());
+		EXIT_IF_IMPOSSIBLE(resume_points_.main_loop, Matching());
 	}
+	END_RESUMABLE(resume_points_.main_loop);
+
+	return true;
 }
 
 Symbol SensingDFA::MeanSymbol() const
@@ -66,15 +97,31 @@ void SensingDFA::GuessIfRightmost(const Head& h, Symbol predicted_symbol, IsPred
 	}
 }
 
+bool SensingDFA::GuessAndMove(const Head& h, IsPredictionConfident confidence)
+{
+	return GuessAndMove(h, a[h], confidence);
+}
+
+bool SensingDFA::GuessAndMove(const Head& h, Symbol predicted_symbol, IsPredictionConfident confidence)
+{
+	if (h + 1 == a.size())
+	{
+		return false;
+	}
+
+	GuessIfRightmost(h, predicted_symbol, confidence);
+	return Move(h);
+}
+
 bool SensingDFA::AdvanceOne(size_t i)
 {
+	BEGIN_RESUMABLE(resume_points_.advance_one);
 	while (t_ != h(i))
 	{
 		Move(t_);
 	}
 
-	GuessIfRightmost(h(i), IsPredictionConfident::No);
-	EXIT_IF_IMPOSSIBLE(Move(h(i)));
+	EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, GuessAndMove(h(i), IsPredictionConfident::No));
 
 	while (inner_ != r_)
 	{
@@ -85,7 +132,9 @@ bool SensingDFA::AdvanceOne(size_t i)
 	{
 		if (a[t_] == a[h(i)])
 		{
-			EXIT_IF_IMPOSSIBLE(Move(l_, r_, outer_));
+			EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, Move(l_));
+			EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, Move(r_));
+			EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, Move(outer_));
 		}
 		else
 		{
@@ -94,70 +143,75 @@ bool SensingDFA::AdvanceOne(size_t i)
 				Move(inner_);
 			}
 
-			GuessIfRightmost(h(i), IsPredictionConfident::No);
-			EXIT_IF_IMPOSSIBLE(Move(h(i)))
+			EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, GuessAndMove(h(i), IsPredictionConfident::No));
 		}
 
-		EXIT_IF_IMPOSSIBLE(Move(t_));
-		GuessIfRightmost(h(i), IsPredictionConfident::No);
-		EXIT_IF_IMPOSSIBLE(Move(h(i)));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, Move(t_));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, GuessAndMove(h(i), IsPredictionConfident::No));
 	}
 
 	while (a[t_] == a[h(i)])
 	{
-		EXIT_IF_IMPOSSIBLE(Move(t_));
-		GuessIfRightmost(h(i), a[t_], IsPredictionConfident::Yes);
-		EXIT_IF_IMPOSSIBLE(Move(h(i)));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, Move(t_));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_one, GuessAndMove(h(i), a[t_], IsPredictionConfident::Yes));
 	}
+	END_RESUMABLE(resume_points_.advance_one);
 
 	return true;
 }
 
 bool SensingDFA::AdvanceMany(size_t i)
 {
+	BEGIN_RESUMABLE(resume_points_.advance_many);
 	while (outer_ != r_)
 	{
 		Move(outer_);
 	}
 	while (l_ != outer_)
 	{
-		EXIT_IF_IMPOSSIBLE(AdvanceOne(i) && Move(l_, r_));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_many, AdvanceOne(i));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_many, Move(l_));
+		EXIT_IF_IMPOSSIBLE(resume_points_.advance_many, Move(r_));
 	}
+	END_RESUMABLE(resume_points_.advance_many);
 
 	return true;
 }
 
 bool SensingDFA::Correction()
 {
+	BEGIN_RESUMABLE(resume_points_.correction);
 	while (h(1) != h(4))
 	{
 		Move(h(1));
 	}
-	EXIT_IF_IMPOSSIBLE(AdvanceOne(1));
+	EXIT_IF_IMPOSSIBLE(resume_points_.correction, AdvanceOne(1));
 
 	while (h(2) != h(1))
 	{
 		Move(h(2));
 	}
-	EXIT_IF_IMPOSSIBLE(AdvanceMany(2));
+	EXIT_IF_IMPOSSIBLE(resume_points_.correction, AdvanceMany(2));
 
 	while (h(3) != h(2))
 	{
 		Move(h(3));
 	}
-	EXIT_IF_IMPOSSIBLE(AdvanceMany(3));
+	EXIT_IF_IMPOSSIBLE(resume_points_.correction, AdvanceMany(3));
 
 	while (h(4) != h(3))
 	{
 		Move(h(4));
 	}
-	EXIT_IF_IMPOSSIBLE(AdvanceMany(4));
+	EXIT_IF_IMPOSSIBLE(resume_points_.correction, AdvanceMany(4));
+	END_RESUMABLE(resume_points_.correction);
 
 	return true;
 }
 
 bool SensingDFA::Matching()
 {
+	BEGIN_RESUMABLE(resume_points_.matching);
 	while (less(h(4), a.size()))
 	{
 		while (h3a_ != h(3))
@@ -167,9 +221,11 @@ bool SensingDFA::Matching()
 
 		while ((a[h(1)] == a[h(2)]) && (a[h(2)] == a[h(3)]) && (a[h(3)] == a[h(4)]))
 		{
-			EXIT_IF_IMPOSSIBLE(Move(h(1), h(2), h3a_, h(3)));
-			GuessIfRightmost(h(4), a[h(2)], IsPredictionConfident::Yes);
-			EXIT_IF_IMPOSSIBLE(Move(h(4)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h(1)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h(2)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h3a_));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h(3)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, GuessAndMove(h(4), a[h(2)], IsPredictionConfident::Yes));
 		}
 
 		if (a[h(2)] != a[h(4)])
@@ -179,9 +235,9 @@ bool SensingDFA::Matching()
 
 		while ((a[h(2)] == a[h(3)]) && (a[h(3)] == a[h(4)]))
 		{
-			EXIT_IF_IMPOSSIBLE(Move(h(2), h(3)));
-			GuessIfRightmost(h(4), a[h(3)], IsPredictionConfident::Yes);
-			EXIT_IF_IMPOSSIBLE(Move(h(4)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h(2)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h(3)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, GuessAndMove(h(4), a[h(3)], IsPredictionConfident::Yes));
 		}
 
 		if (a[h(3)] != a[h(4)])
@@ -191,9 +247,9 @@ bool SensingDFA::Matching()
 
 		while ((a[h3a_] == a[h(3)]) && (a[h(3)] == a[h(4)]))
 		{
-			EXIT_IF_IMPOSSIBLE(Move(h3a_, h(3)));
-			GuessIfRightmost(h(4), a[h3a_], IsPredictionConfident::Yes);
-			EXIT_IF_IMPOSSIBLE(Move(h(4)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h3a_));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h(3)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, GuessAndMove(h(4), a[h3a_], IsPredictionConfident::Yes));
 		}
 
 		if (a[h3a_] != a[h(4)])
@@ -203,9 +259,8 @@ bool SensingDFA::Matching()
 
 		while ((h3a_ != h(3)) && (a[h3a_] == a[h(4)]))
 		{
-			EXIT_IF_IMPOSSIBLE(Move(h3a_));
-			GuessIfRightmost(h(4), a[h3a_], IsPredictionConfident::Yes);
-			EXIT_IF_IMPOSSIBLE(Move(h(4)));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, Move(h3a_));
+			EXIT_IF_IMPOSSIBLE(resume_points_.matching, GuessAndMove(h(4), a[h3a_], IsPredictionConfident::Yes));
 		}
 
 		if (a[h3a_] != a[h(4)])
@@ -213,6 +268,7 @@ bool SensingDFA::Matching()
 			break;
 		}
 	}
+	END_RESUMABLE(resume_points_.matching);
 
 	return true;
 }
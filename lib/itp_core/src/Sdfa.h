@@ -10,7 +10,8 @@
  * – Т. 62. – №. 3. – С. 653-681.
  * In the paper a word is assumed to be infinite, but the implementation, obviously,
  * works only with finite words. So when any head goues out of the word, the
- * automaton stops.
+ * automaton stops. The stopped automaton can be resumed after the word is
+ * extended, the run on the extended word is the same as on the whole word.
  */
 
 #ifndef SDFA_H_INCLUDED
@@ -25,13 +26,32 @@
 #include <fstream>
 #include <iostream>
 
+/**
+ * Macros to make procedures resumable. The body of a procedure is a switch on the point to resume from, the points are
+ * placed just before the moves, which can be impossible.
+ */
+#define BEGIN_RESUMABLE(point) \
+	switch (point) \
+	{ \
+	case 0:
+
+#define END_RESUMABLE(point) \
+	} \
+	point = 0
+
 /**
  * Macro to break main infinte loop when move is not possible (head
- * to move reaches the end of the word).
+ * to move reaches the end of the word). The point of the move is saved
+ * to try the move again, when the procedure is resumed. A failed move
+ * changes nothing, so it can be safely repeated.
  */
-#define EXIT_IF_IMPOSSIBLE(procedure_call) \
-	if (!(procedure_call)) \
-		return false;
+#define EXIT_IF_IMPOSSIBLE(point, procedure_call) \
+	case __LINE__: \
+		if (!(procedure_call)) \
+		{ \
+			point = __LINE__; \
+			return false; \
+		}
 
 namespace itp
 {
@@ -45,18 +65,33 @@ class SensingDFA : public MultiheadAutomaton<10>
 {
 public:
 	SensingDFA(Symbol min_symbol, Symbol max_symbol);
+	SensingDFA(const SensingDFA& other);
+
+	std::unique_ptr<PredictionAutomaton> Clone() const override;
+
+protected:
+	void Init() override;
 
 private:
 	/**
 	 * Run main "infinite" loop.
 	 */
 	void Run() override;
+	bool MainLoop();
 
 	Symbol MeanSymbol() const;
 
 	void GuessIfRightmost(const Head&, IsPredictionConfident);
 	void GuessIfRightmost(const Head&, Symbol, IsPredictionConfident);
 
+	/**
+	 * In the paper every guess is followed by the move of the same head. A move of the rightmost head is impossible
+	 * only at the end of the word, where the guess is skipped, so the pair is performed only if the move is possible.
+	 * Thus a failed pair changes nothing and can be repeated, when the word is extended.
+	 */
+	bool GuessAndMove(const Head&, IsPredictionConfident);
+	bool GuessAndMove(const Head&, Symbol, IsPredictionConfident);
+
 	/**
 	 * All procedures based on pseudocode from the paper and very close to it.
 	 */
@@ -72,6 +107,21 @@ private:
 	 * special names in the paper.
 	 */
 	const Head &h3a_, &inner_, &outer_, &l_, &r_, &t_;
+
+	/**
+	 * Points to resume the procedures from. Every procedure is on the call stack at most once, so a single point per
+	 * procedure restores the whole stack.
+	 */
+	struct ResumePoints
+	{
+		int main_loop = 0;
+		int correction = 0;
+		int matching = 0;
+		int advance_many = 0;
+		int advance_one = 0;
+	};
+
+	ResumePoints resume_points_;
 };
 
 } // namespace itp
@@ -34,26 +34,26 @@ std::vector<Double> CountableWeightsGenerator::Generate(size_t n) const
 }
 
 template<>
-Symbol ZeroInitialized<Symbol>(const SymbolsDistributions<Symbol>&)
+Symbol ZeroInitialized<Symbol>(const PreprocInfo<Symbol>&)
 {
 	return 0;
 }
 
 template<>
-Double ZeroInitialized<Double>(const SymbolsDistributions<Double>&)
+Double ZeroInitialized<Double>(const PreprocInfo<Double>&)
 {
 	return 0.;
 }
 
 template<>
-VectorSymbol ZeroInitialized<VectorSymbol>(const SymbolsDistributions<VectorSymbol>& d)
+VectorSymbol ZeroInitialized<VectorSymbol>(const PreprocInfo<VectorSymbol>& d)
 {
 	const auto count_of_series = d.GetDesampleTable().size();
 	return VectorSymbol(count_of_series);
 }
 
 template<>
-VectorDouble ZeroInitialized<VectorDouble>(const SymbolsDistributions<VectorDouble>& d)
+VectorDouble ZeroInitialized<VectorDouble>(const PreprocInfo<VectorDouble>& d)
 {
 	const auto count_of_series = d.GetDesampleTable().size();
 	return VectorDouble(count_of_series);
@@ -6,6 +6,7 @@
 #include "Types.h"
 
 #include <cmath>
+#include <type_traits>
 
 namespace itp
 {
@@ -29,18 +30,18 @@ using WeightsGeneratorPtr = std::shared_ptr<WeightsGenerator>;
 VectorDouble operator*(const VectorDouble& lhs, Double rhs);
 
 template<typename T>
-T ZeroInitialized(const SymbolsDistributions<T>& d);
+T ZeroInitialized(const PreprocInfo<T>& d);
 template<>
-Symbol ZeroInitialized<Symbol>(const SymbolsDistributions<Symbol>&);
+Symbol ZeroInitialized<Symbol>(const PreprocInfo<Symbol>&);
 template<>
-Double ZeroInitialized<Double>(const SymbolsDistributions<Double>&);
+Double ZeroInitialized<Double>(const PreprocInfo<Double>&);
 template<>
-VectorSymbol ZeroInitialized<VectorSymbol>(const SymbolsDistributions<VectorSymbol>& d);
+VectorSymbol ZeroInitialized<VectorSymbol>(const PreprocInfo<VectorSymbol>& d);
 template<>
-VectorDouble ZeroInitialized<VectorDouble>(const SymbolsDistributions<VectorDouble>& d);
+VectorDouble ZeroInitialized<VectorDouble>(const PreprocInfo<VectorDouble>& d);
 
-template<typename T>
-T Mean(const SymbolsDistributions<T>& d, const typename SymbolsDistributions<T>::FactorType& compressor)
+template<typename T, typename Real>
+T Mean(const SymbolsDistributions<T, Real>& d, const typename SymbolsDistributions<T, Real>::FactorType& compressor)
 {
 	auto sum = ZeroInitialized<T>(d);
 	Sampler<T> sampler;
@@ -103,20 +104,25 @@ void Integrate(Forecast<T>& forecast)
 	}
 }
 
+/**
+ * Replaces each code length x with the probability 2^(-x). Works with any numeric type, which provides pow(), e.g. for
+ * LogDouble it just negates the logarithm.
+ */
 template<typename ForwardIterator>
 inline void ToCodeProbabilities(ForwardIterator first, ForwardIterator last)
 {
-	HighPrecDouble base = 2.;
+	using Real = std::decay_t<decltype(*first)>;
+	const Real base = 2.;
 	while (first != last)
 	{
-		*first = bignums::pow(base, -(*first));
+		*first = pow(base, -(*first));
 		++first;
 	}
 }
 
-template<typename T>
+template<typename T, typename Real>
 void FormGroupForecasts(
-	ContinuationsDistribution<T>& code_probabilities,
+	ContinuationsDistribution<T, Real>& code_probabilities,
 	const CompressorNamesVec& compressors_groups,
 	WeightsGeneratorPtr weights_generator)
 {
@@ -126,45 +132,102 @@ void FormGroupForecasts(
 		{
 			auto group_concatenated_name = ToConcatenatedCompressorNames(group);
 			auto weights = weights_generator->Generate(group.size());
-			for (const auto& continuation : code_probabilities.GetIndex())
+			code_probabilities.AddFactor(group_concatenated_name);
+
+			std::vector<const Real*> columns(group.size());
+			for (size_t i = 0; i < group.size(); ++i)
 			{
-				code_probabilities(continuation, group_concatenated_name) = 0;
+				columns[i] = code_probabilities.Column(code_probabilities.FactorPosition(group[i]));
+			}
+			auto group_column = code_probabilities.Column(code_probabilities.FactorPosition(group_concatenated_name));
+			for (auto rank : code_probabilities.GetRanks())
+			{
+				group_column[rank] = 0;
 				for (size_t i = 0; i < group.size(); ++i)
 				{
-					code_probabilities(continuation, group_concatenated_name) += code_probabilities(
-																					 continuation,
-																					 group[i])
-						* weights[i];
+					group_column[rank] += columns[i][rank] * weights[i];
 				}
 			}
 		}
 	}
 }
 
-template<typename T>
-ContinuationsDistribution<T> ToProbabilities(ContinuationsDistribution<T> code_probabilities)
+template<typename T, typename Real>
+void FormGroupForecasts(
+	SymbolsDistributions<T, Real>& code_probabilities,
+	const CompressorNamesVec& compressors_groups,
+	WeightsGeneratorPtr weights_generator)
 {
-	Double cumulated_sum;
+	for (const auto& group : compressors_groups)
+	{
+		if (group.size() > 1)
+		{
+			auto group_concatenated_name = ToConcatenatedCompressorNames(group);
+			auto weights = weights_generator->Generate(group.size());
+			code_probabilities.AddFactor(group_concatenated_name);
+			for (auto symbol : code_probabilities.GetIndex())
+			{
+				auto& group_value = code_probabilities(symbol, group_concatenated_name);
+				group_value = 0;
+				for (size_t i = 0; i < group.size(); ++i)
+				{
+					group_value += code_probabilities(symbol, group[i]) * weights[i];
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Unlike the continuations case, the sums are computed in Real, because the code probabilities of symbols are not
+ * scaled and may be too small for Double.
+ */
+template<typename T, typename Real>
+SymbolsDistributions<T, Real> ToProbabilities(SymbolsDistributions<T, Real> code_probabilities)
+{
+	const auto symbols = code_probabilities.GetIndex();
 	for (const auto& compressor : code_probabilities.GetFactors())
 	{
+		Real cumulated_sum = 0;
+		for (auto symbol : symbols)
+		{
+			cumulated_sum += code_probabilities(symbol, compressor);
+		}
+
+		for (auto symbol : symbols)
+		{
+			code_probabilities(symbol, compressor) /= cumulated_sum;
+		}
+	}
+
+	return code_probabilities;
+}
+
+template<typename T, typename Real>
+ContinuationsDistribution<T, Real> ToProbabilities(ContinuationsDistribution<T, Real> code_probabilities)
+{
+	Double cumulated_sum;
+	for (size_t j = 0; j < code_probabilities.FactorsSize(); ++j)
+	{
+		auto column = code_probabilities.Column(j);
 		cumulated_sum = .0;
-		for (const auto& continuation : code_probabilities.GetIndex())
+		for (auto rank : code_probabilities.GetRanks())
 		{
-			cumulated_sum += static_cast<Double>(code_probabilities(continuation, compressor));
+			cumulated_sum += static_cast<Double>(column[rank]);
 		}
 
-		for (const auto& continuation : code_probabilities.GetIndex())
+		for (auto rank : code_probabilities.GetRanks())
 		{
-			code_probabilities(continuation, compressor) /= cumulated_sum;
+			column[rank] /= cumulated_sum;
 		}
 	}
 
 	return code_probabilities;
 }
 
-template<typename T>
-ContinuationsDistribution<T> Merge(
-	const std::vector<ContinuationsDistribution<T>>& tables,
+template<typename T, typename Real>
+ContinuationsDistribution<T, Real> Merge(
+	const std::vector<ContinuationsDistribution<T, Real>>& tables,
 	const std::vector<size_t>& alphabets,
 	const std::vector<Double>& weights)
 {
@@ -179,15 +242,39 @@ ContinuationsDistribution<T> Merge(
 		begin(steps),
 		[&maximal_alphabet](size_t item) { return maximal_alphabet / item; });
 
-	ContinuationsDistribution<T> result(tables[tables.size() - 1]);
-	for (const auto& continuation : result.GetIndex())
+	// Continuation c of the result corresponds to c / steps[i] in the i-th table, find the rows of the tables at once.
+	ContinuationsDistribution<T, Real> result(tables[tables.size() - 1]);
+	const auto& ranks = result.GetRanks();
+	std::vector<std::vector<size_t>> ranks_in_tables(tables.size(), std::vector<size_t>(ranks.size()));
+	for (size_t i = 0; i < tables.size(); ++i)
 	{
-		for (const auto& compressor : result.GetFactors())
+		for (size_t j = 0; j < ranks.size(); ++j)
 		{
-			result(continuation, compressor) = .0;
+			size_t multiplier = 1;
+			for (size_t k = 0, rank = ranks[j]; k < result.GetContinuationLength(); ++k)
+			{
+				ranks_in_tables[i][j] += rank % result.GetAlphabetSize() / steps[i] * multiplier;
+				rank /= result.GetAlphabetSize();
+				multiplier *= tables[i].GetAlphabetSize();
+			}
+		}
+	}
+
+	std::vector<const Real*> columns(tables.size());
+	for (const auto& compressor : result.GetFactors())
+	{
+		for (size_t i = 0; i < tables.size(); ++i)
+		{
+			columns[i] = tables[i].Column(tables[i].FactorPosition(compressor));
+		}
+
+		auto result_column = result.Column(result.FactorPosition(compressor));
+		for (size_t j = 0; j < ranks.size(); ++j)
+		{
+			result_column[ranks[j]] = .0;
 			for (size_t i = 0; i < tables.size(); ++i)
 			{
-				result(continuation, compressor) += tables[i](continuation / steps[i], compressor) * weights[i];
+				result_column[ranks[j]] += columns[i][ranks_in_tables[i][j]] * weights[i];
 			}
 		}
 	}
@@ -196,16 +283,16 @@ ContinuationsDistribution<T> Merge(
 	return result;
 }
 
-template<typename T>
+template<typename T, typename Real>
 Forecast<T> ToPointwiseForecasts(
-	const ContinuationsDistribution<T>& table,
+	const ContinuationsDistribution<T, Real>& table,
 	size_t h,
 	double confidence_probability = 0.95)
 {
 	Forecast<T> result;
 	for (size_t i = 0; i < h; ++i)
 	{
-		SymbolsDistributions<T> d = CumulatedForStep(table, i);
+		SymbolsDistributions<T, Real> d = CumulatedForStep(table, i);
 		for (auto compressor : d.GetFactors())
 		{
 			result(compressor, i).point = Mean(d, compressor);
@@ -216,25 +303,59 @@ Forecast<T> ToPointwiseForecasts(
 	return result;
 }
 
-template<typename T>
-SymbolsDistributions<T> CumulatedForStep(const ContinuationsDistribution<T>& table, std::size_t step)
+template<typename T, typename Real>
+SymbolsDistributions<T, Real> CumulatedForStep(const ContinuationsDistribution<T, Real>& table, std::size_t step)
 {
 	assert(step <= 1000);
 
-	SymbolsDistributions<T> result;
-	for (const auto& continuation : table.GetIndex())
+	SymbolsDistributions<T, Real> result;
+	if (table.IndexSize() == 0)
+	{
+		result.CopyPreprocessingInfoFrom(table);
+		return result;
+	}
+
+	if (table.GetContinuationLength() <= step)
+	{
+		throw std::range_error("Index out of range");
+	}
+
+	size_t divisor = 1;
+	for (size_t i = 0; i < step; ++i)
+	{
+		divisor *= table.GetAlphabetSize();
+	}
+
+	// The symbols go to the result in the order of their first occurrence, as if the continuations were enumerated.
+	std::vector<Symbol> symbols;
+	std::vector<bool> is_seen(table.GetAlphabetSize());
+	for (auto rank : table.GetRanks())
+	{
+		const auto symbol = rank / divisor % table.GetAlphabetSize();
+		if (!is_seen[symbol])
+		{
+			is_seen[symbol] = true;
+			symbols.push_back(static_cast<Symbol>(symbol));
+		}
+	}
+
+	std::vector<std::vector<Real>> sums(table.FactorsSize(), std::vector<Real>(table.GetAlphabetSize()));
+	for (size_t j = 0; j < table.FactorsSize(); ++j)
 	{
-		for (const auto& compressor : table.GetFactors())
+		std::fill(std::begin(sums[j]), std::end(sums[j]), 0);
+		const auto column = table.Column(j);
+		for (auto rank : table.GetRanks())
 		{
-			result(continuation[step], compressor) = 0;
+			sums[j][rank / divisor % table.GetAlphabetSize()] += column[rank];
 		}
 	}
 
-	for (const auto& continuation : table.GetIndex())
+	const auto compressors = table.GetFactors();
+	for (auto symbol : symbols)
 	{
-		for (const auto& compressor : table.GetFactors())
+		for (size_t j = 0; j < compressors.size(); ++j)
 		{
-			result(continuation[step], compressor) += table(continuation, compressor);
+			result(symbol, compressors[j]) = sums[j][symbol];
 		}
 	}
 	result.CopyPreprocessingInfoFrom(table);
@@ -58,6 +58,7 @@ public:
 
 	void push_back(const NewType&);
 	void push_back(NewType&&);
+	void reserve(size_t);
 
 	const PlainTimeSeries<NewType>& to_plain_tseries() const;
 
@@ -183,6 +184,12 @@ void itp::PreprocessedTimeSeries<OrigType, NewType>::push_back(NewType&& to_inse
 	series_.push_back(std::forward<NewType>(to_insert));
 }
 
+template<typename OrigType, typename NewType>
+void itp::PreprocessedTimeSeries<OrigType, NewType>::reserve(size_t new_capacity)
+{
+	series_.reserve(new_capacity);
+}
+
 template<typename OrigType, typename NewType>
 const itp::PlainTimeSeries<NewType>& itp::PreprocessedTimeSeries<OrigType, NewType>::to_plain_tseries() const
 {
@@ -3,6 +3,7 @@
 
 #include "Bignums.h"
 #include "Continuation.h"
+#include "LogDouble.h"
 #include "PreprocessedTable.h"
 #include "TimeSeries.h"
 
@@ -13,14 +14,26 @@ using HighPrecDouble = bignums::BigDouble<12, 24>;
 // using HighPrecDouble = boost::multiprecision::mpfr_float;
 // using HighPrecDouble = long double;
 
-template<typename T>
-using ContinuationsDistribution = TableWithPreprocInfo<Continuation<Symbol>, std::string, HighPrecDouble, T>;
+/**
+ * The type of code lengths and probabilities of continuations, which is used by default. The choice can be overridden
+ * at runtime (see NumericBackend).
+ */
+#ifdef ITP_LOG_DOMAIN_PROBABILITIES
+using CodeProbability = bignums::LogDouble;
+constexpr NumericBackend kDefaultNumericBackend = NumericBackend::LogDomain;
+#else
+using CodeProbability = HighPrecDouble;
+constexpr NumericBackend kDefaultNumericBackend = NumericBackend::HighPrecision;
+#endif
+
+template<typename T, typename Real = CodeProbability>
+using ContinuationsDistribution = TableWithPreprocInfo<Continuation<Symbol>, std::string, Real, T>;
 
 template<typename T>
 using Forecast = TableWithPreprocInfo<std::string, size_t, Forecast_point<T>, T>;
 
-template<typename T>
-using SymbolsDistributions = TableWithPreprocInfo<Symbol, std::string, HighPrecDouble, T>;
+template<typename T, typename Real = CodeProbability>
+using SymbolsDistributions = TableWithPreprocInfo<Symbol, std::string, Real, T>;
 
 } // namespace itp
 
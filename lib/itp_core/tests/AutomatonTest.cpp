@@ -120,7 +120,7 @@ public:
 
 private:
 	itp::AutomatonForTesting automaton_;
-	itp::HighPrecDouble evaluated_probability_;
+	itp::AutomatonProbability evaluated_probability_;
 };
 
 TEST(SdfaTest, PredictWordOfLength2)
@@ -547,3 +547,29 @@ TEST(SdfaTest, PredictWordOfLength20)
 		0,
 		0);
 }
+
+TEST(SdfaTest, ExtendedWordIsProcessedAsWholeOne)
+{
+	itp::PlainTimeSeries<itp::Symbol> word(200);
+	for (size_t i = 0; i < word.size(); ++i)
+	{
+		word[i] = static_cast<itp::Symbol>((i * i + i / 17) % 5);
+	}
+	itp::AutomatonForTesting whole_word_automaton{0, 4};
+	const auto expected_probability = whole_word_automaton.EvalProbability(word);
+
+	for (size_t prefix_size : {0, 1, 2, 50, 199})
+	{
+		itp::AutomatonForTesting automaton{0, 4};
+		automaton.EvalProbability(itp::PlainTimeSeries<itp::Symbol>(word.cbegin(), word.cbegin() + prefix_size));
+		auto probability = automaton.EvalProbabilityOfExtended(nullptr, 0);
+		for (size_t i = prefix_size; i < word.size(); ++i)
+		{
+			probability = automaton.EvalProbabilityOfExtended(&word[i], 1);
+		}
+
+		EXPECT_EQ(probability, expected_probability);
+		EXPECT_THAT(automaton.GetHeadHistory(), testing::ContainerEq(whole_word_automaton.GetHeadHistory()));
+		EXPECT_THAT(automaton.GetGuessHistory(), testing::ContainerEq(whole_word_automaton.GetGuessHistory()));
+	}
+}
@@ -1,7 +1,10 @@
 #include "../src/Bignums.h"
+#include "../src/LogDouble.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 using namespace bignums;
 
 TEST(BigNumsTest, Constructors)
@@ -32,3 +35,47 @@ TEST(BigNumsTest, Utilities)
 	EXPECT_DOUBLE_EQ(pow(b, -p), 1. / 25.);
 	EXPECT_EQ(abs(-p), p);
 }
+
+TEST(LogDoubleTest, ConvertsToAndFromDouble)
+{
+	EXPECT_DOUBLE_EQ(LogDouble{5}, 5.);
+	EXPECT_DOUBLE_EQ(LogDouble{-0.25}, -0.25);
+	EXPECT_DOUBLE_EQ(LogDouble{}, 0.);
+	EXPECT_TRUE(LogDouble{0}.IsZero());
+}
+
+TEST(LogDoubleTest, Arithmetic)
+{
+	const LogDouble a{6}, b{2}, c{-3};
+	EXPECT_DOUBLE_EQ(a + b, 8.);
+	EXPECT_DOUBLE_EQ(a - b, 4.);
+	EXPECT_DOUBLE_EQ(b - a, -4.);
+	EXPECT_DOUBLE_EQ(a + c, 3.);
+	EXPECT_DOUBLE_EQ(a * c, -18.);
+	EXPECT_DOUBLE_EQ(a / c, -2.);
+	EXPECT_TRUE((a - a).IsZero());
+	EXPECT_EQ(-(a - a), LogDouble{});
+}
+
+TEST(LogDoubleTest, Comparisons)
+{
+	const LogDouble a{6}, b{2}, c{-3}, d{-1};
+	EXPECT_LT(b, a);
+	EXPECT_LT(c, b);
+	EXPECT_LT(c, d);
+	EXPECT_LT(LogDouble{}, b);
+	EXPECT_LT(c, LogDouble{});
+	EXPECT_EQ(std::min({a, b, c, d}), c);
+}
+
+TEST(LogDoubleTest, RepresentsProbabilitiesBeyondRangeOfDouble)
+{
+	const LogDouble base{2};
+	const auto tiny = pow(base, LogDouble{-100000});
+	EXPECT_DOUBLE_EQ(tiny.Log2Abs(), -100000.);
+
+	const auto sum = tiny + tiny;
+	EXPECT_DOUBLE_EQ(sum.Log2Abs(), -99999.);
+	EXPECT_DOUBLE_EQ((tiny / sum), 0.5);
+	EXPECT_DOUBLE_EQ(log2(tiny * tiny), -200000.);
+}
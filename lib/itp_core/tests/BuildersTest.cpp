@@ -5,6 +5,10 @@
 
 #include "GtestExtensions.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 using itp::ConcatenatedCompressorNamesVec;
 using namespace testing;
 
@@ -93,6 +97,47 @@ TEST_F(BasicDataTest, PureCompressor)
 	EXPECT_EQ(std::size(res.at("zlib")), horizon_);
 }
 
+TEST_F(BasicDataTest, KeepsDiscardedProbabilityBoundOfEachThread)
+{
+	const std::vector<unsigned char> ts{1, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0};
+	const ConcatenatedCompressorNamesVec groups{"kt"};
+	predictor_.SetPruningSlack(0);
+	predictor_.ForecastDiscrete(ts, groups, horizon_, difference_, sparse_);
+	const auto bound = predictor_.GetDiscardedProbabilityBound();
+	ASSERT_GT(bound, 0.);
+
+	itp::Double other_thread_bound_before_forecasting = -1.;
+	std::thread other_thread{[&] {
+		other_thread_bound_before_forecasting = predictor_.GetDiscardedProbabilityBound();
+		predictor_.ForecastDiscrete({0, 0, 0, 0, 0, 0, 0, 0}, groups, 1, difference_, sparse_);
+	}};
+	other_thread.join();
+
+	EXPECT_EQ(other_thread_bound_before_forecasting, 0.);
+	EXPECT_EQ(predictor_.GetDiscardedProbabilityBound(), bound);
+}
+
+TEST_F(BasicDataTest, LogDomainBackendGivesSameForecastsAsHighPrecisionOne)
+{
+	const std::vector<double> ts{3.4, 2.5, 0.1, 0.5, 3.9, 4.0, 4.8, 2.8, 1.5, 1.3, 1.8, 2.1, 2, 3.5, 4.9, 5.0, 5.1, 4.5};
+	const ConcatenatedCompressorNamesVec groups{"zlib_rp_automaton", "ppmd"};
+
+	predictor_.SetNumericBackend(itp::NumericBackend::HighPrecision);
+	const auto expected = predictor_.ForecastMultialphabet(ts, groups, 3, 1, 8, -1);
+	predictor_.SetNumericBackend(itp::NumericBackend::LogDomain);
+	const auto result = predictor_.ForecastMultialphabet(ts, groups, 3, 1, 8, -1);
+
+	ASSERT_EQ(std::size(result), std::size(expected));
+	for (const auto& [name, forecast] : expected)
+	{
+		ASSERT_EQ(std::size(result.at(name)), std::size(forecast));
+		for (size_t i = 0; i < std::size(forecast); ++i)
+		{
+			EXPECT_NEAR(result.at(name)[i], forecast[i], 1e-9 * std::abs(forecast[i])) << name << ' ' << i;
+		}
+	}
+}
+
 TEST_F(BasicDataTest, AllowsToForecastMultivariateSeries)
 {
 	const std::vector<std::vector<double>> ts{
@@ -199,6 +244,103 @@ TEST_F(MakeForecastDiscreteTest, KIndexDataWithAutomataAndZlibSeparately)
 	EXPECT_EQ(std::size(res.at("zlib")), 24);
 }
 
+/**
+ * Guesses nothing and counts the calls, which are given the symbols out of the last alphabet set. It is slow to change
+ * the alphabet.
+ */
+class AlphabetCheckingAlgorithm : public itp::INonCompressionAlgorithm
+{
+public:
+	Guess GiveNextPrediction(const unsigned char* data, size_t size) override
+	{
+		if (std::any_of(data, data + size, [this](const auto symbol) { return symbol > max_symbol_; }))
+		{
+			++violations_count_;
+		}
+
+		return {0, itp::ConfidenceLevel::NotConfident};
+	}
+
+	void SetTsParams(itp::Symbol /*alphabet_min_symbol*/, itp::Symbol alphabet_max_symbol) override
+	{
+		// Lets a concurrent forecast wait for the algorithm while its alphabet is being changed.
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		max_symbol_ = alphabet_max_symbol;
+	}
+
+	size_t GetViolationsCount() const { return violations_count_; }
+
+private:
+	itp::Symbol max_symbol_ = 0;
+	size_t violations_count_ = 0;
+};
+
+class RegisteredAlgorithmTest : public Test
+{
+protected:
+	void SetUp() override { predictor_.RegisterNonCompressionAlgorithm("checker", &algorithm_); }
+
+	const ConcatenatedCompressorNamesVec compressor_groups_vec_{"checker"};
+
+	AlphabetCheckingAlgorithm algorithm_;
+	itp::InformationTheoreticPredictor predictor_;
+};
+
+TEST_F(RegisteredAlgorithmTest, ConcurrentForecastsWithDifferentAlphabets_GiveSameForecastsAsSequential)
+{
+	const std::vector<std::vector<unsigned char>> series{
+		{0, 1, 1, 0, 1, 0, 0, 1, 1, 1, 0, 1, 0, 0, 1, 1, 0, 1},
+		{0, 5, 3, 7, 2, 6, 1, 4, 7, 0, 3, 5, 6, 2, 4, 1, 7, 3}};
+	const size_t horizon = 2;
+
+	std::vector<std::map<std::string, std::vector<itp::Double>>> expected;
+	for (const auto& ts : series)
+	{
+		expected.push_back(predictor_.ForecastDiscrete(ts, compressor_groups_vec_, horizon, 0, -1));
+	}
+
+	// The continuations are compressed by chunks, so another forecast can change the alphabet between them.
+	predictor_.SetThreadsCount(2);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < std::size(series); ++i)
+	{
+		threads.emplace_back([&, i] {
+			for (size_t j = 0; j < 5; ++j)
+			{
+				EXPECT_EQ(
+					predictor_.ForecastDiscrete(series[i], compressor_groups_vec_, horizon, 0, -1),
+					expected[i]);
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	EXPECT_EQ(algorithm_.GetViolationsCount(), 0u);
+}
+
+TEST_F(RegisteredAlgorithmTest, ParallelSparsePassesWithDifferentAlphabets_GiveSameForecastsAsSequential)
+{
+	// The sub-series of the even points has the alphabet {0, 1}, the one of the odd points has {0, ..., 7}.
+	const std::vector<unsigned char> ts{
+		0, 5, 1, 3, 1, 7, 0, 2, 0, 6, 1, 1, 1, 4, 0, 7, 0, 0, 1, 3, 0, 5, 1, 6, 1, 2, 0, 4};
+	const size_t horizon = 4;
+	const int sparse = 2;
+
+	const auto expected = predictor_.ForecastDiscrete(ts, compressor_groups_vec_, horizon, 0, sparse);
+	// Two threads for each of the three passes, so the continuations of each pass are compressed by chunks.
+	predictor_.SetThreadsCount(6);
+	for (size_t i = 0; i < 2; ++i)
+	{
+		EXPECT_EQ(predictor_.ForecastDiscrete(ts, compressor_groups_vec_, horizon, 0, sparse), expected);
+	}
+
+	EXPECT_EQ(algorithm_.GetViolationsCount(), 0u);
+}
+
 TEST(ConvertorsOfMultivariateSeriesTest, ReturnsEmptySeriesOnEmptyInput)
 {
 	EXPECT_THAT(itp::Convert(std::vector<std::vector<double>>{}), IsEmpty());
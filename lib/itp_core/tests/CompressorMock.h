@@ -14,6 +14,9 @@ public:
 	MOCK_METHOD3(Compress, size_t(const unsigned char*, size_t, std::vector<unsigned char>*));
 	MOCK_METHOD2(CompressContinuations, std::vector<size_t>(const std::vector<Symbol>&, const Continuations&));
 	MOCK_METHOD2(SetTsParams, void(Symbol, Symbol));
+	MOCK_METHOD1(SetPruningSlack, void(std::optional<SizeInBits>));
+	MOCK_METHOD2(MakeCheckpoint, ICompressionCheckpointPtr(const unsigned char*, size_t));
+	MOCK_CONST_METHOD0(Clone, std::unique_ptr<ICompressor>());
 };
 
 } // namespace itp
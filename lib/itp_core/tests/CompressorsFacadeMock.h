@@ -22,7 +22,10 @@ public:
 			const std::string&,
 			const std::vector<Symbol>&,
 			const ICompressor::Continuations&));
+	MOCK_METHOD3(MakeCheckpoint, ICompressionCheckpointPtr(const std::string&, const unsigned char*, size_t));
 	MOCK_METHOD1(SetAlphabetDescription, void(AlphabetDescription));
+	MOCK_METHOD1(SetPruningSlack, void(std::optional<ICompressor::SizeInBits>));
+	MOCK_CONST_METHOD0(Clone, CompressorsFacadePtr());
 };
 
 } // namespace itp
@@ -1,3 +1,4 @@
+#include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "../src/Compressors.h"
@@ -5,10 +6,68 @@
 
 #include <array>
 #include <memory>
+#include <numeric>
+#include <set>
+#include <thread>
 
 using namespace itp;
 using namespace testing;
 
+namespace
+{
+
+/**
+ * Checks that the code lengths of the continuations of length 3, which are evaluated from a checkpoint of the history,
+ * are the same as the ones of the history compressed together with each continuation.
+ */
+void ExpectCheckpointMatchesCompression(ICompressor& compressor, size_t alphabet, size_t history_length)
+{
+	std::vector<unsigned char> data(history_length);
+	for (size_t i = 0; i < std::size(data); ++i)
+	{
+		data[i] = static_cast<unsigned char>(i * i % 7);
+	}
+	const ICompressor::Continuations continuations(alphabet, 3);
+
+	const auto result = compressor.CompressContinuations(data, continuations);
+
+	std::vector<unsigned char> output_buffer;
+	for (size_t i = 0; i < std::size(continuations); ++i)
+	{
+		auto continued = data;
+		const auto continuation = continuations[i];
+		continued.insert(std::end(continued), continuation.cbegin(), continuation.cbegin() + std::size(continuation));
+		EXPECT_EQ(result[i], compressor.Compress(continued.data(), std::size(continued), &output_buffer)) << i;
+	}
+}
+
+/**
+ * Checks that a compressor, which is reused for several series, gives the same code lengths as a new one.
+ *
+ * \param[in] series_sizes Pairs of sizes of series and sizes of their alphabets.
+ */
+template<typename Compressor>
+void ExpectReusedMatchesNew(const std::vector<std::pair<size_t, size_t>>& series_sizes)
+{
+	Compressor compressor;
+	std::vector<unsigned char> output_buffer;
+	for (const auto& [size, alphabet_size] : series_sizes)
+	{
+		std::vector<unsigned char> data(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = static_cast<unsigned char>(i * i * i % alphabet_size);
+		}
+
+		EXPECT_EQ(
+			compressor.Compress(data.data(), size, &output_buffer),
+			Compressor{}.Compress(data.data(), size, &output_buffer))
+			<< size << ' ' << alphabet_size;
+	}
+}
+
+} // namespace
+
 TEST(CompressorsPoolTest, InstanceCorrectlyCompressesSeveralTimes)
 {
 	unsigned char ts[]{0, 1, 1, 0, 1, 3, 0, 0, 0};
@@ -41,3 +100,421 @@ TEST(CompressorsPoolTest, PassesSpecifiedAlphabetToInternalCompressor)
 	pool->RegisterCompressor("test", std::move(compressor_mock));
 	pool->SetAlphabetDescription({10, 20});
 }
+
+TEST(CompressorsPoolTest, ClonedPoolGivesSameCodeLengths)
+{
+	unsigned char ts[]{0, 1, 1, 0, 1, 3, 0, 0, 0};
+	auto compressors = MakeStandardCompressorsPool();
+	compressors->SetAlphabetDescription({0, 3});
+	auto clone = compressors->Clone();
+	ASSERT_NE(clone, nullptr);
+
+	for (const auto& name : {"lcacomp", "rp", "zstd", "bzip2", "zlib", "ppmd", "automaton", "zpaq", "kt", "ctw", "sequitur"})
+	{
+		EXPECT_EQ(clone->Compress(name, ts, sizeof(ts)), compressors->Compress(name, ts, sizeof(ts))) << name;
+	}
+}
+
+TEST(CompressorsPoolTest, SharesCompressorsWhichCannotBeCloned_EachPoolCompressesWithItsOwnAlphabet)
+{
+	unsigned char ts[]{0, 1, 1, 0};
+	auto compressor_mock = std::make_unique<NiceMock<CompressorMock>>();
+	EXPECT_CALL(*compressor_mock, Clone()).WillOnce(Return(ByMove(nullptr)));
+	{
+		InSequence sequence;
+		EXPECT_CALL(*compressor_mock, SetTsParams(10, 20));
+		EXPECT_CALL(*compressor_mock, Compress(_, _, _)).WillOnce(Return(1));
+		EXPECT_CALL(*compressor_mock, SetTsParams(0, 5));
+		EXPECT_CALL(*compressor_mock, Compress(_, _, _)).Times(2).WillRepeatedly(Return(2));
+		EXPECT_CALL(*compressor_mock, SetTsParams(10, 20));
+		EXPECT_CALL(*compressor_mock, Compress(_, _, _)).WillOnce(Return(1));
+	}
+
+	auto pool = std::make_unique<CompressorsPool>();
+	pool->RegisterCompressor("test", std::move(compressor_mock));
+	auto clone = pool->Clone();
+	pool->SetAlphabetDescription({10, 20});
+	clone->SetAlphabetDescription({0, 5});
+
+	EXPECT_EQ(pool->Compress("test", ts, sizeof(ts)), 1u);
+	EXPECT_EQ(clone->Compress("test", ts, sizeof(ts)), 2u);
+	EXPECT_EQ(clone->Compress("test", ts, sizeof(ts)), 2u);
+	EXPECT_EQ(pool->Compress("test", ts, sizeof(ts)), 1u);
+}
+
+TEST(CompressorsLeasingPoolTest, ReusesReleasedFacades)
+{
+	CompressorsLeasingPool pool{MakeStandardCompressorsPool()};
+
+	auto first = pool.Lease();
+	auto second = pool.Lease();
+	EXPECT_NE(first, second);
+
+	auto* const released = first.get();
+	first.reset();
+	EXPECT_EQ(pool.Lease().get(), released);
+}
+
+TEST(CompressorsLeasingPoolTest, LeasesDifferentFacadesForWorkersAndReusesThem)
+{
+	CompressorsLeasingPool pool{MakeStandardCompressorsPool()};
+
+	auto workers_facades = pool.Lease(3);
+	ASSERT_EQ(std::size(workers_facades), 3u);
+	EXPECT_NE(workers_facades[0], workers_facades[1]);
+	EXPECT_NE(workers_facades[0], workers_facades[2]);
+	EXPECT_NE(workers_facades[1], workers_facades[2]);
+
+	std::set<CompressorsFacade*> released;
+	for (const auto& facade : workers_facades)
+	{
+		released.insert(facade.get());
+	}
+	workers_facades.clear();
+
+	for (const auto& facade : pool.Lease(3))
+	{
+		EXPECT_EQ(released.count(facade.get()), 1u);
+	}
+}
+
+TEST(CompressorsLeasingPoolTest, LeasesNewFacadesAfterRegistration)
+{
+	unsigned char ts[]{0, 1, 1, 0, 1, 3, 0, 0, 0};
+	CompressorsLeasingPool pool{std::make_shared<CompressorsPool>()};
+	auto leased = pool.Lease();
+
+	pool.RegisterCompressor("zlib", std::make_unique<ZlibCompressor>());
+	leased.reset();
+
+	auto facade = pool.Lease();
+	EXPECT_EQ(facade->Compress("zlib", ts, sizeof(ts)), BytesToBits(17));
+}
+
+TEST(CompressorsLeasingPoolTest, ConcurrentLeasesGiveSameCodeLengths)
+{
+	CompressorsLeasingPool pool{MakeStandardCompressorsPool()};
+	std::vector<Symbol> history(100);
+	for (size_t i = 0; i < std::size(history); ++i)
+	{
+		history[i] = static_cast<Symbol>(i * i % 5);
+	}
+	const ICompressor::Continuations continuations(5, 3);
+	const auto compress = [&pool, &history, &continuations] {
+		auto facade = pool.Lease();
+		facade->SetAlphabetDescription({0, 4});
+		return facade->CompressContinuations("ppmd", history, continuations);
+	};
+	const auto expected = compress();
+
+	std::vector<std::vector<ICompressor::SizeInBits>> results(4);
+	std::vector<std::thread> threads;
+	for (auto& result : results)
+	{
+		threads.emplace_back([&result, &compress] { result = compress(); });
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	for (const auto& result : results)
+	{
+		EXPECT_EQ(result, expected);
+	}
+}
+
+namespace
+{
+
+/**
+ * Code length is a sum of all symbols, so it can be easily computed incrementally.
+ */
+class SummingCompressor : public CompressorBase
+{
+public:
+	SizeInBits Compress(const unsigned char* data, size_t size, std::vector<unsigned char>*) override
+	{
+		++compress_calls_count;
+		return std::accumulate(data, data + size, SizeInBits{0});
+	}
+
+	ICompressionCheckpointPtr MakeCheckpoint(const unsigned char* data, size_t size) override
+	{
+		auto checkpoint = std::make_unique<Checkpoint>(&appended_symbols_count);
+		checkpoint->Append(data, size);
+		return checkpoint;
+	}
+
+	std::unique_ptr<ICompressor> Clone() const override { return std::make_unique<SummingCompressor>(); }
+
+	size_t compress_calls_count = 0;
+	size_t appended_symbols_count = 0;
+
+private:
+	class Checkpoint : public ICompressionCheckpoint
+	{
+	public:
+		explicit Checkpoint(size_t* appended_symbols_count)
+			: appended_symbols_count_{appended_symbols_count}
+		{
+			// DO NOTHING
+		}
+
+		ICompressionCheckpointPtr Fork() const override { return std::make_unique<Checkpoint>(*this); }
+
+		void Append(const unsigned char* data, size_t size) override
+		{
+			sum_ = std::accumulate(data, data + size, sum_);
+			*appended_symbols_count_ += size;
+		}
+
+		SizeInBits CodeLength() override { return sum_; }
+
+		bool HasMonotoneCodeLengths() const override { return true; }
+
+	private:
+		size_t* appended_symbols_count_;
+		SizeInBits sum_ = 0;
+	};
+};
+
+} // namespace
+
+TEST(CompressorBaseTest, UsesCheckpointToCompressContinuationsIfSupported)
+{
+	SummingCompressor compressor;
+	const std::vector<Symbol> history{1, 2, 3};
+	const ICompressor::Continuations continuations(2, 2);
+
+	const auto result = compressor.CompressContinuations(history, continuations);
+
+	EXPECT_THAT(result, ElementsAre(6, 7, 7, 8));
+	EXPECT_EQ(compressor.compress_calls_count, 0);
+}
+
+TEST(CompressorBaseTest, CheckpointsOfCommonPrefixesOfContinuationsAreReused)
+{
+	SummingCompressor compressor;
+	const std::vector<Symbol> history{1, 2, 3};
+
+	const auto result = compressor.CompressContinuations(history, ICompressor::Continuations(2, 3));
+
+	EXPECT_THAT(result, ElementsAre(6, 7, 7, 8, 7, 8, 8, 9));
+	EXPECT_EQ(compressor.appended_symbols_count, std::size(history) + 2 + 4 + 8);
+}
+
+TEST(CompressorBaseTest, CompressesOnlyContinuationsFromRange)
+{
+	SummingCompressor compressor;
+	const std::vector<Symbol> history{1, 2, 3};
+
+	const auto result = compressor.CompressContinuations(history, ICompressor::Continuations(3, 2, 2, 7));
+
+	EXPECT_THAT(result, ElementsAre(8, 7, 8, 9, 8));
+}
+
+TEST(CompressorBaseTest, PrunesContinuationsWhichAreLongerThanMinimalOneBySlack)
+{
+	SummingCompressor compressor;
+	compressor.SetPruningSlack(1);
+	const std::vector<Symbol> history{1, 2, 3};
+
+	const auto result = compressor.CompressContinuations(history, ICompressor::Continuations(2, 3));
+
+	constexpr auto kPruned = ICompressor::kPrunedCodeLength;
+	EXPECT_THAT(result, ElementsAre(6, 7, 7, kPruned, 7, kPruned, kPruned, kPruned));
+	EXPECT_LT(compressor.appended_symbols_count, std::size(history) + 2 + 4 + 8);
+}
+
+TEST(CompressorBaseTest, CompressesFromScratchIfCheckpointsAreNotSupported)
+{
+	auto compressors = MakeStandardCompressorsPool();
+	compressors->SetAlphabetDescription({0, 3});
+	const std::vector<Symbol> history{0, 1, 1, 0, 1, 3, 0};
+	const ICompressor::Continuations continuations(4, 2, 6, 8);
+
+	const auto result = compressors->CompressContinuations("zstd", history, continuations);
+
+	const unsigned char first[]{0, 1, 1, 0, 1, 3, 0, 2, 1};
+	const unsigned char second[]{0, 1, 1, 0, 1, 3, 0, 3, 1};
+	EXPECT_THAT(
+		result,
+		ElementsAre(compressors->Compress("zstd", first, sizeof(first)), compressors->Compress("zstd", second, sizeof(second))));
+}
+
+TEST(ZlibCompressorTest, CheckpointOfLongDataGivesSameCodeLengthsAsCompression)
+{
+	ZlibCompressor compressor;
+	ExpectCheckpointMatchesCompression(compressor, 3, ZlibCompressor::kMinCheckpointedSize + 10);
+}
+
+TEST(ZlibCompressorTest, DoesNotPruneContinuationsAsCodeLengthsAreNotMonotone)
+{
+	ZlibCompressor compressor;
+	compressor.SetPruningSlack(0);
+	ExpectCheckpointMatchesCompression(compressor, 3, ZlibCompressor::kMinCheckpointedSize + 10);
+}
+
+TEST(ZlibCompressorTest, DoesNotMakeCheckpointsOfShortData)
+{
+	ZlibCompressor compressor;
+	const unsigned char data[]{0, 1, 1, 0, 1, 3, 0};
+
+	EXPECT_EQ(compressor.MakeCheckpoint(data, sizeof(data)), nullptr);
+}
+
+TEST(CompressorsPoolTest, StandardPoolProvidesSeveralLevelsOfZstd)
+{
+	auto compressors = MakeStandardCompressorsPool();
+	const unsigned char ts[]{0, 1, 1, 0, 1, 3, 0, 2, 1, 0, 1, 1, 0, 1, 3, 0, 2, 1};
+	std::vector<unsigned char> output_buffer;
+
+	for (const int level : {1, 3, 6, 9, 12, 19})
+	{
+		ZstdCompressor compressor{level};
+		EXPECT_EQ(
+			compressors->Compress("zstd" + std::to_string(level), ts, sizeof(ts)),
+			compressor.Compress(ts, sizeof(ts), &output_buffer));
+	}
+	EXPECT_EQ(compressors->Compress("zstd", ts, sizeof(ts)), ZstdCompressor{}.Compress(ts, sizeof(ts), &output_buffer));
+}
+
+TEST(PpmCompressorTest, CheckpointGivesSameCodeLengthsAsCompression)
+{
+	PpmCompressor compressor;
+	ExpectCheckpointMatchesCompression(compressor, 3, 500);
+}
+
+TEST(Bzip2CompressorTest, GivesSameCodeLengthsAsMaximalBlockSize)
+{
+	Bzip2Compressor compressor;
+	std::vector<unsigned char> output_buffer;
+	std::vector<char> expected_output(200000);
+
+	for (const size_t size : {10, 150000, 20})
+	{
+		std::vector<unsigned char> data(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = static_cast<unsigned char>(i * i % 7);
+		}
+		std::vector<char> input(std::cbegin(data), std::cend(data));
+		auto expected_size = static_cast<unsigned int>(std::size(expected_output));
+		ASSERT_EQ(
+			BZ2_bzBuffToBuffCompress(
+				expected_output.data(),
+				&expected_size,
+				input.data(),
+				static_cast<unsigned int>(size),
+				9,
+				0,
+				30),
+			BZ_OK);
+
+		EXPECT_EQ(compressor.Compress(data.data(), size, &output_buffer), BytesToBits(expected_size));
+	}
+}
+
+TEST(RpCompressorTest, ReusedCompressorGivesSameCodeLengthsAsNewOne)
+{
+	ExpectReusedMatchesNew<RpCompressor>({{3000, 256}, {10, 2}, {500, 7}, {3000, 3}});
+}
+
+TEST(LcaCompressorTest, ReusedCompressorGivesSameCodeLengthsAsNewOne)
+{
+	ExpectReusedMatchesNew<LcaCompressor>({{100000, 256}, {10, 2}, {500, 7}});
+}
+
+TEST(ZpaqCompressorTest, CheckpointGivesSameCodeLengthsAsCompression)
+{
+	ZpaqCompressor compressor;
+	ExpectCheckpointMatchesCompression(compressor, 3, 500);
+}
+
+TEST(ZpaqCompressorTest, ReusedCompressorGivesSameCodeLengthsAsNewOne)
+{
+	ExpectReusedMatchesNew<ZpaqCompressor>({{5000, 256}, {10, 2}, {500, 7}, {500, 7}});
+}
+
+TEST(AutomatonCompressorTest, CheckpointGivesSameCodeLengthsAsCompression)
+{
+	AutomatonCompressor compressor;
+	compressor.SetTsParams(0, 6);
+	ExpectCheckpointMatchesCompression(compressor, 7, 300);
+}
+
+TEST(KtMixtureCompressorTest, GivesCodeLengthOfMixtureOfEstimates)
+{
+	const std::vector<unsigned char> data{0, 1, 0, 1, 0, 1};
+	std::vector<unsigned char> output_buffer;
+
+	// The estimate of order 0 is 1/2 * 1/4 * 1/2 * 3/8 * 1/2 * 5/12, i.e. 7.68 bits.
+	KtMixtureCompressor order_0_compressor{0};
+	order_0_compressor.SetTsParams(0, 1);
+	EXPECT_EQ(order_0_compressor.Compress(data.data(), std::size(data), &output_buffer), 8);
+
+	// The estimate of order 1 is 1/2 * 1/2 * 1/2 * 3/4 * 3/4 * 5/6, the weights of the orders are 1 - 1/log(3) and
+	// 1/log(3), so the mixture takes 4.38 bits.
+	KtMixtureCompressor order_1_compressor{1};
+	order_1_compressor.SetTsParams(0, 1);
+	EXPECT_EQ(order_1_compressor.Compress(data.data(), std::size(data), &output_buffer), 5);
+}
+
+TEST(KtMixtureCompressorTest, CheckpointGivesSameCodeLengthsAsCompression)
+{
+	KtMixtureCompressor compressor;
+	compressor.SetTsParams(0, 6);
+	ExpectCheckpointMatchesCompression(compressor, 7, 500);
+}
+
+TEST(KtMixtureCompressorTest, ThrowsOnSymbolOutOfAlphabet)
+{
+	KtMixtureCompressor compressor;
+	compressor.SetTsParams(1, 3);
+	const std::vector<unsigned char> data{1, 2, 4};
+	std::vector<unsigned char> output_buffer;
+
+	EXPECT_THROW(compressor.Compress(data.data(), std::size(data), &output_buffer), CompressorsError);
+}
+
+TEST(CtwCompressorTest, GivesCodeLengthOfWeightedContextTree)
+{
+	const std::vector<unsigned char> data{0, 1, 0, 1, 0, 1};
+	std::vector<unsigned char> output_buffer;
+
+	// The tree of depth 0 is the estimate 1/2 * 1/4 * 1/2 * 3/8 * 1/2 * 5/12, i.e. 7.68 bits.
+	CtwCompressor depth_0_compressor{0};
+	depth_0_compressor.SetTsParams(0, 1);
+	EXPECT_EQ(depth_0_compressor.Compress(data.data(), std::size(data), &output_buffer), 8);
+
+	// The symbols 0, 1, 1, 1 follow 0 (the first one follows the beginning), the symbols 0, 0 follow 1, so the tree of
+	// depth 1 gives (5/1024 + 5/128 * 3/8) / 2, i.e. 6.68 bits.
+	CtwCompressor depth_1_compressor{1};
+	depth_1_compressor.SetTsParams(0, 1);
+	EXPECT_EQ(depth_1_compressor.Compress(data.data(), std::size(data), &output_buffer), 7);
+}
+
+TEST(CtwCompressorTest, CheckpointGivesSameCodeLengthsAsCompression)
+{
+	CtwCompressor compressor;
+	compressor.SetTsParams(0, 6);
+	ExpectCheckpointMatchesCompression(compressor, 7, 500);
+}
+
+TEST(SequiturCompressorTest, GivesEncodedSizeOfGrammar)
+{
+	const std::vector<unsigned char> data{0, 1, 0, 1, 0, 1};
+	std::vector<unsigned char> output_buffer;
+
+	// The grammar is S -> A A A, A -> 0 1. Its right hands with the end markers are 7 symbols of 4 kinds, which occur
+	// 3, 1, 1 and 2 times, so their Krichevsky-Trofimov estimate takes 16.81 bits.
+	SequiturCompressor compressor;
+	EXPECT_EQ(compressor.Compress(data.data(), std::size(data), &output_buffer), 17);
+}
+
+TEST(SequiturCompressorTest, CheckpointGivesSameCodeLengthsAsCompression)
+{
+	SequiturCompressor compressor;
+	ExpectCheckpointMatchesCompression(compressor, 7, 500);
+}
@@ -231,7 +231,7 @@ bool GiveNextPredictionCallsChecker::AreSame(
 TEST_F(NonCompressionAlgorithmAdaptorTest, RequestsPredictionsPassingRightData)
 {
 	const std::vector<Symbol> test_data = {0, 1, 0};
-	const std::vector<Continuation<Symbol>> continuations = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+	const ICompressor::Continuations continuations(2, 2);
 
 	auto algorithm = GiveNextPredictionCallsChecker({
 		{},
@@ -239,11 +239,9 @@ TEST_F(NonCompressionAlgorithmAdaptorTest, RequestsPredictionsPassingRightData)
 		{0, 1},
 		{0, 1, 0},
 		{0, 1, 0, 0},
-		{0, 1, 0},
 		{0, 1, 0, 0},
 		{0, 1, 0},
 		{0, 1, 0, 1},
-		{0, 1, 0},
 		{0, 1, 0, 1},
 	});
 
@@ -254,3 +252,29 @@ TEST_F(NonCompressionAlgorithmAdaptorTest, RequestsPredictionsPassingRightData)
 
 	EXPECT_TRUE(algorithm.AllCallsAreAsExpected()) << algorithm.GetErrorsDescription();
 }
+
+TEST_F(NonCompressionAlgorithmAdaptorTest, CheckpointGivesSameCodeLengthsAsCompressionFromScratch)
+{
+	ON_CALL(*algorithm_, GiveNextPrediction(_, _))
+		.WillByDefault(Invoke(
+			[](const unsigned char* data, size_t size) -> INonCompressionAlgorithm::Guess
+			{
+				if (size == 0)
+				{
+					return {1, ConfidenceLevel::NotConfident};
+				}
+				return {data[size - 1], ConfidenceLevel::Confident};
+			}));
+	adaptor_->SetTsParams(1, 2);
+
+	const std::vector<Symbol> ending = {2, 1};
+	std::vector<Symbol> full_series(std::cbegin(data_), std::cend(data_));
+	full_series.insert(std::end(full_series), std::cbegin(ending), std::cend(ending));
+
+	const auto checkpoint = adaptor_->MakeCheckpoint(data_, size_);
+	const auto fork = checkpoint->Fork();
+	fork->Append(ending.data(), std::size(ending));
+
+	EXPECT_EQ(checkpoint->CodeLength(), adaptor_->Compress(data_, size_, &out_buffer_));
+	EXPECT_EQ(fork->CodeLength(), adaptor_->Compress(full_series.data(), std::size(full_series), &out_buffer_));
+}
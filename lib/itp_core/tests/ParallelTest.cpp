@@ -0,0 +1,69 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "../src/Parallel.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace itp;
+using namespace testing;
+
+TEST(RunInParallelTest, ExecutesEachTaskExactlyOnce)
+{
+	const size_t tasks_count = 1000;
+	std::vector<std::atomic<size_t>> calls_count(tasks_count);
+
+	RunInParallel(8, tasks_count, [&](size_t, size_t task) { ++calls_count[task]; });
+
+	for (const auto& count : calls_count)
+	{
+		EXPECT_EQ(count, 1u);
+	}
+}
+
+TEST(RunInParallelTest, PassesWorkerIndicesLessThanThreadsCount)
+{
+	std::mutex mutex;
+	std::set<size_t> workers;
+
+	RunInParallel(
+		4,
+		100,
+		[&](size_t worker, size_t)
+		{
+			std::lock_guard lock{mutex};
+			workers.insert(worker);
+		});
+
+	ASSERT_FALSE(workers.empty());
+	EXPECT_LT(*workers.rbegin(), 4u);
+}
+
+TEST(RunInParallelTest, ExecutesTasksInOrderInCallingThreadIfOneThreadIsRequested)
+{
+	std::vector<size_t> order;
+
+	RunInParallel(1, 5, [&](size_t worker, size_t task) { order.push_back(worker * 10 + task); });
+
+	EXPECT_THAT(order, ElementsAre(0, 1, 2, 3, 4));
+}
+
+TEST(RunInParallelTest, RethrowsExceptionFromTask)
+{
+	EXPECT_THROW(
+		RunInParallel(
+			4,
+			100,
+			[](size_t, size_t task)
+			{
+				if (task == 42)
+				{
+					throw std::runtime_error{"error"};
+				}
+			}),
+		std::runtime_error);
+}
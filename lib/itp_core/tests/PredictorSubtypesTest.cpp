@@ -1,8 +1,12 @@
 #include "../src/CompressionPrediction.h"
+#include "../src/MarginalPrediction.h"
+#include "../src/MonteCarloPrediction.h"
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "CompressorsFacadeMock.h"
+
 #include <iterator>
 
 using namespace itp;
@@ -255,6 +259,55 @@ TEST(DataFrameIteratorTest, main)
 	}
 }
 
+TEST(ContinuationsTableTest, RowsAreEnumeratedInOrderOfRanks)
+{
+	ContinuationsTable<std::string, int> table;
+	table(Continuation<Symbol>{1, 1}, "gzip") = 3;
+	table(Continuation<Symbol>{0, 0}, "gzip") = 0;
+	table(Continuation<Symbol>{0, 1}, "gzip") = 2;
+	table(Continuation<Symbol>{1, 0}, "gzip") = 1;
+
+	EXPECT_EQ(table.IndexSize(), 4);
+	EXPECT_EQ(table.GetRanks(), std::vector<size_t>({0, 1, 2, 3}));
+
+	Continuation<Symbol> c(2, 2);
+	for (const auto& continuation : table.GetIndex())
+	{
+		EXPECT_EQ(continuation, c++);
+	}
+
+	int i = 0;
+	for (const auto& value : table)
+	{
+		EXPECT_EQ(value, i++);
+	}
+}
+
+TEST(ContinuationsTableTest, ContinuationOutOfAlphabet_Inserted_ValuesKept)
+{
+	std::vector<std::string> compressors{"gzip", "zstd"};
+	ContinuationsTable<std::string, int> table(Continuations_generator<Symbol>(2, 2), 4);
+	table.AddFactor(begin(compressors), end(compressors));
+	table(Continuation<Symbol>{1, 1}, "zstd") = 5;
+
+	table(Continuation<Symbol>{2, 0}, "gzip") = 7;
+
+	EXPECT_EQ(table.GetAlphabetSize(), 3);
+	EXPECT_EQ(table.IndexSize(), 5);
+	EXPECT_EQ(table(Continuation<Symbol>{1, 1}, "zstd"), 5);
+	EXPECT_EQ(table(Continuation<Symbol>{2, 0}, "gzip"), 7);
+	EXPECT_EQ(table.Column(table.FactorPosition("zstd"))[4], 5);
+}
+
+TEST(ContinuationsTableTest, AbsentCell_ConstAccess_Throws)
+{
+	const ContinuationsTable<std::string, int> table(Continuations_generator<Symbol>(2, 2), 3);
+
+	EXPECT_THROW(table(Continuation<Symbol>{1, 1}, "gzip"), std::range_error);
+	EXPECT_THROW(table(Continuation<Symbol>{0, 0}, "gzip"), std::range_error);
+	EXPECT_THROW(table(Continuation<Symbol>{2, 0}, "gzip"), std::range_error);
+}
+
 TEST(ContinuationTest, main)
 {
 	Continuation<Symbol> c(2, 4);
@@ -309,6 +362,50 @@ TEST(ContinuationTest, main)
 	}
 }
 
+TEST(ContinuationTest, LongerThanMaxSize_Constructed_Throws)
+{
+	EXPECT_NO_THROW(Continuation<Symbol>(2, Continuation<Symbol>::kMaxSize));
+	EXPECT_THROW(Continuation<Symbol>(2, Continuation<Symbol>::kMaxSize + 1), std::length_error);
+
+	Continuation<Symbol> c(2, Continuation<Symbol>::kMaxSize);
+	EXPECT_THROW(c.push_back(1), std::length_error);
+}
+
+TEST(ContinuationsRangeTest, GivesContinuationsInOrderOfIncrement)
+{
+	const ContinuationsRange range(3, 2);
+	ASSERT_EQ(range.size(), 9);
+
+	Continuation<Symbol> c(3, 2);
+	size_t i = 0;
+	for (const auto& continuation : range)
+	{
+		EXPECT_EQ(continuation, c);
+		EXPECT_EQ(range[i++], c++);
+	}
+	EXPECT_EQ(i, 9);
+}
+
+TEST(ContinuationsRangeTest, SubRange_Iterated_GivesContinuationsWithRanksFromSubRange)
+{
+	const auto range = ContinuationsRange(2, 3).SubRange(2, 5);
+	ASSERT_EQ(range.size(), 3);
+	EXPECT_EQ(range.GetFirstRank(), 2);
+	EXPECT_EQ(range.GetLastRank(), 5);
+
+	const std::vector<Continuation<Symbol>> expected{{0, 1, 0}, {1, 1, 0}, {0, 0, 1}};
+	EXPECT_TRUE(std::equal(std::begin(range), std::end(range), std::begin(expected), std::end(expected)));
+
+	EXPECT_THROW(range.SubRange(1, 4), std::range_error);
+}
+
+TEST(ContinuationsRangeTest, TooManyContinuations_Constructed_Throws)
+{
+	EXPECT_THROW(ContinuationsRange(256, 8), std::overflow_error);
+	EXPECT_THROW(ContinuationsRange(16, 16), std::overflow_error);
+	EXPECT_EQ(ContinuationsRange(16, 15).size(), size_t{1} << 60);
+}
+
 TEST(CodesLengthsComputerTest, ComputeLengthsForAllContinuations_ComputeContinuationsDistribution_ComputedCorrectly)
 {
 	auto history = PreprocessedTimeSeries<Symbol, Symbol>{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1};
@@ -355,6 +452,137 @@ TEST(CodesLengthsComputerTest, ComputeLengthsForAllContinuations_ComputeContinua
 	EXPECT_DOUBLE_EQ(static_cast<Double>(result(c, "ppmd")), 104.);
 }
 
+TEST(CodesLengthsComputerTest, SeveralThreads_ComputeContinuationsDistribution_SameResultAsInOneThread)
+{
+	auto history = PreprocessedTimeSeries<Symbol, Symbol>{0, 2, 1, 0, 3, 3, 1, 0, 2, 2, 1, 3, 0};
+	history.SetSamplingAlphabet(4);
+
+	size_t length_of_continuation{3};
+	const CompressorNames compressor_names = {"zstd", "ppmd", "automaton", "rp"};
+
+	CodeLengthsComputer<Symbol> sequential_computer{MakeStandardCompressorsPool()};
+	CodeLengthsComputer<Symbol> parallel_computer{MakeStandardCompressorsPool(), 5};
+	const auto expected = sequential_computer.ComputeContinuationsDistribution(
+		history,
+		length_of_continuation,
+		compressor_names);
+	const auto result = parallel_computer.ComputeContinuationsDistribution(
+		history,
+		length_of_continuation,
+		compressor_names);
+
+	ASSERT_EQ(result.IndexSize(), expected.IndexSize());
+	Continuation<Symbol> c(history.GetSamplingAlphabet(), length_of_continuation);
+	for (size_t i = 0; i < expected.IndexSize(); ++i, ++c)
+	{
+		for (const auto& name : compressor_names)
+		{
+			EXPECT_EQ(result(c, name), expected(c, name));
+		}
+	}
+}
+
+TEST(CodesLengthsComputerTest, PruningEnabled_ComputeContinuationsDistribution_PrunedContinuationsAreDiscarded)
+{
+	auto history = PreprocessedTimeSeries<Symbol, Symbol>{0, 1, 0, 1};
+	history.SetSamplingAlphabet(2);
+
+	auto compressors = std::make_shared<NiceMock<CompressorsFacadeMock>>();
+	constexpr auto kPruned = ICompressor::kPrunedCodeLength;
+	EXPECT_CALL(*compressors, SetPruningSlack(std::optional<ICompressor::SizeInBits>{8}));
+	ON_CALL(*compressors, CompressContinuations(_, _, _))
+		.WillByDefault(Return(std::vector<ICompressor::SizeInBits>{10, 12, kPruned, kPruned}));
+
+	CodeLengthsComputer<Symbol> computer{compressors};
+	EXPECT_EQ(computer.GetDiscardedProbabilityBound(), 0.);
+	computer.SetPruningSlack(8);
+	const auto result = computer.ComputeContinuationsDistribution(history, 2, {"zstd"});
+
+	ASSERT_EQ(result.IndexSize(), 4);
+	const std::vector<Double> expected{10., 12., 10. + 8. + 1100., 10. + 8. + 1100.};
+	Continuation<Symbol> c(history.GetSamplingAlphabet(), 2);
+	for (size_t i = 0; i < std::size(expected); ++i, ++c)
+	{
+		EXPECT_DOUBLE_EQ(static_cast<Double>(result(c, "zstd")), expected[i]);
+	}
+	EXPECT_DOUBLE_EQ(computer.GetDiscardedProbabilityBound(), 2. / 256.);
+}
+
+TEST(CodesLengthsComputerTest, ComputeStepsDistributions_CodeProbabilitiesAreSummedForEachStep)
+{
+	auto history = PreprocessedTimeSeries<Symbol, Symbol>{0, 1, 0, 1};
+	history.SetSamplingAlphabet(2);
+
+	auto compressors = std::make_shared<NiceMock<CompressorsFacadeMock>>();
+	ON_CALL(*compressors, CompressContinuations(_, _, _))
+		.WillByDefault(Return(std::vector<ICompressor::SizeInBits>{1, 2, 2, 3}));
+
+	CodeLengthsComputer<Symbol> computer{compressors};
+	const auto result = computer.ComputeStepsDistributions(history, 2, {"zstd"});
+
+	ASSERT_EQ(result.size(), 2);
+	for (const auto& distribution : result)
+	{
+		ASSERT_EQ(distribution.IndexSize(), 2);
+		EXPECT_DOUBLE_EQ(static_cast<Double>(distribution(0, "zstd")), 0.75);
+		EXPECT_DOUBLE_EQ(static_cast<Double>(distribution(1, "zstd")), 0.375);
+	}
+}
+
+TEST(CodesLengthsComputerTest, EqualCodeLengths_SampleContinuations_WeightsAreEqualAndSamplesAreReproducible)
+{
+	auto history = PreprocessedTimeSeries<Symbol, Symbol>{0, 1, 0, 1};
+	history.SetSamplingAlphabet(2);
+
+	auto compressors = std::make_shared<NiceMock<CompressorsFacadeMock>>();
+	ON_CALL(*compressors, CompressContinuations(_, _, _))
+		.WillByDefault(Return(std::vector<ICompressor::SizeInBits>{10, 10}));
+
+	CodeLengthsComputer<Symbol> computer{compressors};
+	const auto samples = computer.SampleContinuations(history, 3, {"zstd"}, 16, 1);
+
+	ASSERT_EQ(samples.size(), 1);
+	const auto& zstd_samples = samples.at("zstd");
+	ASSERT_EQ(zstd_samples.continuations.size(), 16);
+	for (size_t i = 0; i < zstd_samples.continuations.size(); ++i)
+	{
+		EXPECT_EQ(zstd_samples.continuations[i].size(), 3);
+
+		// Every continuation has the code length 10 and is drawn with the probability 2^(-3).
+		EXPECT_DOUBLE_EQ(zstd_samples.log2_weights[i], -7.);
+	}
+	const auto same_seed_samples = computer.SampleContinuations(history, 3, {"zstd"}, 16, 1);
+	EXPECT_EQ(same_seed_samples.at("zstd").continuations, zstd_samples.continuations);
+}
+
+TEST(CodesLengthsComputerTest, SampleContinuations_CheckpointsGiveSameSamplesAsCompression)
+{
+	auto history = PreprocessedTimeSeries<Symbol, Symbol>{0, 1, 0, 1, 2, 1, 0, 1, 2, 2, 1, 0};
+	history.SetSamplingAlphabet(3);
+	const CompressorNames compressor_names{"kt", "automaton"};
+
+	auto compressors = MakeStandardCompressorsPool();
+	auto compressors_without_checkpoints = std::make_shared<NiceMock<CompressorsFacadeMock>>();
+	ON_CALL(*compressors_without_checkpoints, SetAlphabetDescription(_))
+		.WillByDefault(Invoke(compressors.get(), &CompressorsFacade::SetAlphabetDescription));
+	ON_CALL(*compressors_without_checkpoints, CompressContinuations(_, _, _))
+		.WillByDefault(Invoke(compressors.get(), &CompressorsFacade::CompressContinuations));
+
+	const auto expected = CodeLengthsComputer<Symbol>{compressors_without_checkpoints}.SampleContinuations(
+		history,
+		4,
+		compressor_names,
+		8,
+		1);
+	const auto result = CodeLengthsComputer<Symbol>{compressors}.SampleContinuations(history, 4, compressor_names, 8, 1);
+
+	for (const auto& name : compressor_names)
+	{
+		EXPECT_EQ(result.at(name).continuations, expected.at(name).continuations) << name;
+		EXPECT_EQ(result.at(name).log2_weights, expected.at(name).log2_weights) << name;
+	}
+}
+
 class TablesConvertersTest : public ::testing::Test
 {
 protected:
@@ -692,6 +920,66 @@ TEST(DiscretePointwisePredictorTest, DiscreteTsWithZeroDifferenceOneStepForecast
 	EXPECT_NEAR(forecast("ppmd", 0).point, expected_forecast[0], 1e-5);
 }
 
+TEST(MarginalPointwisePredictorTest, RealTsWithFirstDifference_predict_SameForecastAsFromContinuationsDistribution)
+{
+	PlainTimeSeries<Double> ts{3.4, 0.1, 3.9, 4.8, 1.5, 1.8, 2.0, 4.9, 5.1, 2.1};
+	auto computer = std::make_shared<CodeLengthsComputer<Double>>(MakeStandardCompressorsPool());
+	auto sampler = std::make_shared<Sampler<Double>>();
+	const size_t partition_cardinality = 4;
+	const size_t horizont = 3;
+	const size_t difference = 1;
+	const CompressorNamesVec compressor_groups{{"zlib"}, {"ppmd"}, {"zlib", "ppmd"}};
+	auto dpredictor = std::make_shared<RealDistributionPredictor<Double>>(computer, sampler, partition_cardinality);
+	dpredictor->SetDifferenceOrder(difference);
+	BasicPointwisePredictor<Double, Double> expected_predictor{dpredictor};
+	RealMarginalPointwisePredictor<Double> predictor{computer, sampler, partition_cardinality, difference};
+
+	const auto expected = expected_predictor.Predict(InitPreprocessedTs(ts), horizont, compressor_groups);
+	const auto forecast = predictor.Predict(InitPreprocessedTs(ts), horizont, compressor_groups);
+
+	ASSERT_EQ(forecast.GetIndex(), expected.GetIndex());
+	for (const auto& compressor : expected.GetIndex())
+	{
+		for (size_t i = 0; i < horizont; ++i)
+		{
+			EXPECT_NEAR(forecast(compressor, i).point, expected(compressor, i).point, 1e-9) << compressor << ' ' << i;
+		}
+	}
+}
+
+TEST(MarginalPointwisePredictorTest, DiscreteTsWithZeroDifferenceTwoStepsForecast_predict_PredictionIsCorrect)
+{
+	std::vector<unsigned char> ts{2, 0, 2, 3, 1, 1, 1, 3, 3, 1};
+	auto computer = std::make_shared<CodeLengthsComputer<Double>>(MakeStandardCompressorsPool(), 3);
+	auto sampler = std::make_shared<Sampler<Symbol>>();
+	size_t horizont = 2u;
+	const CompressorNamesVec compressor_groups{{"zlib", "rp"}};
+	DiscreteMarginalPointwisePredictor<Double, Symbol> predictor{computer, sampler};
+	const auto forecast = predictor.Predict(itp::InitPreprocessedTs(ts), horizont, compressor_groups);
+	std::vector<double> expected_forecast{1.0264274976, 1.0151519618};
+	EXPECT_NEAR(forecast("zlib_rp", 0).point, expected_forecast[0], 1e-5);
+	EXPECT_NEAR(forecast("zlib_rp", 1).point, expected_forecast[1], 1e-5);
+}
+
+TEST(MonteCarloPredictorTest, DiscreteTsWithZeroDifferenceTwoStepsForecast_predict_ExactForecastIsInConfidenceInterval)
+{
+	std::vector<unsigned char> ts{2, 0, 2, 3, 1, 1, 1, 3, 3, 1};
+	auto computer = std::make_shared<CodeLengthsComputer<Double>>(MakeStandardCompressorsPool());
+	auto sampler = std::make_shared<Sampler<Symbol>>();
+	size_t horizont = 2u;
+	const CompressorNamesVec compressor_groups{{"zlib", "rp"}};
+	DiscreteMonteCarloPredictor<Double, Symbol> predictor{computer, sampler, 400, 0};
+	const auto forecast = predictor.Predict(itp::InitPreprocessedTs(ts), horizont, compressor_groups);
+
+	std::vector<double> exact_forecast{1.0264274976, 1.0151519618};
+	for (size_t i = 0; i < horizont; ++i)
+	{
+		EXPECT_LE(forecast("zlib_rp", i).left_border, exact_forecast[i]);
+		EXPECT_LE(exact_forecast[i], forecast("zlib_rp", i).right_border);
+	}
+	EXPECT_EQ(forecast.IndexSize(), 3);
+}
+
 TEST(MultialphabetSparsePredictorTest, RealTsWithZeroDifferenceAndTwoPartitions_predict_PredictionIsCorrect)
 {
 	std::vector<Double> ts{3.4, 0.1, 3.9, 4.8, 1.5, 1.8, 2.0, 4.9, 5.1, 2.1};
@@ -777,6 +1065,38 @@ TEST(SparseMultialphabetPredictorTest, SparseM3CYear_predict_PredictionIsCorrect
 	EXPECT_NEAR(forecast("zlib_rp", 5).point, expected_forecast[5], 1e-5);
 }
 
+TEST(SparseMultialphabetPredictorTest, SeveralPredictors_predict_SameForecastAsWithOnePredictor)
+{
+	PlainTimeSeries<Double> ts{3.4, 2.5, 0.1, 0.5, 3.9, 4.0, 4.8, 2.8, 1.5, 1.3, 1.8, 2.1, 2, 3.5, 4.9, 5.0, 5.1, 4.5};
+	const size_t horizont = 7;
+	const size_t sparse = 3;
+	const CompressorNamesVec compressor_groups{{"zlib", "rp"}};
+	auto make_predictor = [] {
+		auto computer = std::make_shared<CodeLengthsComputer<Double>>(MakeStandardCompressorsPool());
+		auto sampler = std::make_shared<Sampler<Double>>();
+		auto dpredictor = std::make_shared<MultialphabetDistributionPredictor<Double>>(computer, sampler, 4);
+		dpredictor->SetDifferenceOrder(1);
+		return std::make_shared<BasicPointwisePredictor<Double, Double>>(dpredictor);
+	};
+
+	SparsePredictor<Double, Double> sequential_predictor{make_predictor(), sparse};
+	SparsePredictor<Double, Double> parallel_predictor{{make_predictor(), make_predictor()}, sparse};
+	const auto expected_forecast = sequential_predictor.Predict(InitPreprocessedTs(ts), horizont, compressor_groups);
+	const auto forecast = parallel_predictor.Predict(InitPreprocessedTs(ts), horizont, compressor_groups);
+	for (size_t i = 0; i < horizont; ++i)
+	{
+		EXPECT_EQ(forecast("zlib_rp", i).point, expected_forecast("zlib_rp", i).point);
+	}
+}
+
+TEST(SparseMultialphabetPredictorTest, CountPasses_SubSeriesCoveredByFullHistoryForecastAreSkipped)
+{
+	EXPECT_EQ((SparsePredictor<Double, Double>::CountPasses(1, 6)), 1u);
+	EXPECT_EQ((SparsePredictor<Double, Double>::CountPasses(2, 6)), 3u);
+	EXPECT_EQ((SparsePredictor<Double, Double>::CountPasses(3, 2)), 2u);
+	EXPECT_EQ((SparsePredictor<Double, Double>::CountPasses(4, 5)), 4u);
+}
+
 TEST(RealMultialphabetVectorisedPredictorTest, WorksOnCorrectData)
 {
 	PlainTimeSeries<itp::VectorDouble> ts{
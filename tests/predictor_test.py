@@ -23,6 +23,22 @@ class TestPredictor(unittest.TestCase):
         np.testing.assert_array_almost_equal(np.array(forecast["zlib_rp"]),
                                              np.array([1.0264274976, 1.0151519618]))
 
+    def test_batch_forecast_equals_single_forecasts(self):
+        batch = [[2, 0, 2, 3, 1, 1, 1, 3, 3, 1], [1, 1, 0, 1, 1, 0, 1, 1, 0], [3, 2, 1, 0, 3, 2, 1, 0]]
+        self._itp.set_threads_count(2)
+        forecasts = self._itp.forecast_discrete_batch(batch, groups=["zlib_rp"], h=2, difference=0)
+        self.assertEqual(len(forecasts), len(batch))
+        for ts, forecast in zip(batch, forecasts):
+            expected = self._itp.forecast_discrete(ts, groups=["zlib_rp"], h=2, difference=0)
+            np.testing.assert_array_almost_equal(np.array(forecast["zlib_rp"]), np.array(expected["zlib_rp"]))
+
+    def test_array_forecast_equals_list_forecast(self):
+        ts = np.array([2, 0, 2, 3, 1, 1, 1, 3, 3, 1], dtype=np.uint8)
+        forecast = self._itp.forecast_discrete(ts, groups=["zlib_rp"], h=2, difference=0)
+        self.assertIsInstance(forecast["zlib_rp"], np.ndarray)
+        expected = self._itp.forecast_discrete(ts.tolist(), groups=["zlib_rp"], h=2, difference=0)
+        np.testing.assert_array_almost_equal(forecast["zlib_rp"], np.array(expected["zlib_rp"]))
+
     def test_m3c_year(self):
         ts = np.array([940.66, 1084.86, 1244.98, 1445.02, 1683.17, 2038.15, 2342.52, 2602.45,
                        2927.87, 3103.96, 3360.27, 3807.63, 4387.88, 4936.99])
@@ -1,4 +1,5 @@
 from itp import DiscreteUnivariateElemetaryTask, BasicTask, TrainingTask, TimeSeries
+from itp.task import ItpAccessor
 
 import unittest
 from unittest.mock import MagicMock
@@ -56,5 +57,14 @@ class TestComplexTask(unittest.TestCase):
                          self._statistics_handler)
 
 
+class TestItpAccessor(unittest.TestCase):
+    def test_raises_if_discrete_series_has_non_integral_values(self):
+        self.assertRaises(ValueError, ItpAccessor._to_symbols, TimeSeries([1, 2.7, 3], dtype=float))
+
+    def test_converts_integral_values_to_symbols(self):
+        self.assertEqual(ItpAccessor._to_symbols(TimeSeries([1., 2., 3.], dtype=float)).tolist(), [1, 2, 3])
+
+
 if __name__ == '__main__':
     unittest.main()
+